@@ -0,0 +1,467 @@
+#pragma once
+#include <RAP/Serdes.h>
+#include <RTF/RTF.h>
+#include <YALF/YALF.h>
+#include "AsyncTransports.h"
+#include "CheckedDecode.h"
+#include "GatherScatter.h"
+#include "RapMetrics.h"
+#include "SerdesTypes.h"
+#include <asio.hpp>
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <limits>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace RAP::RTF {
+
+// Awaitable counterpart of ::RTF::IRegisterTarget.
+// Spans passed in must stay valid until the returned awaitable completes, which is always the case for `co_await target.xAsync(...)`.
+template <typename AddressType, typename DataType>
+class IAsyncRegisterTarget
+{
+public:
+    explicit IAsyncRegisterTarget(std::string_view name)
+        : name(name)
+    {}
+    virtual ~IAsyncRegisterTarget() = default;
+
+    virtual std::string_view getDomain() const = 0;
+    std::string_view getName() const { return this->name; }
+
+    virtual asio::awaitable<void> writeAsync(AddressType addr, DataType data) = 0;
+    virtual asio::awaitable<DataType> readAsync(AddressType addr) = 0;
+    virtual asio::awaitable<void> readModifyWriteAsync(AddressType addr, DataType new_data, DataType mask) = 0;
+    virtual asio::awaitable<void> seqWriteAsync(AddressType start_addr, std::span<DataType const> data, size_t increment = sizeof(DataType)) = 0;
+    virtual asio::awaitable<void> seqReadAsync(AddressType start_addr, std::span<DataType> out_data, size_t increment = sizeof(DataType)) = 0;
+    virtual asio::awaitable<void> fifoWriteAsync(AddressType fifo_addr, std::span<DataType const> data) = 0;
+    virtual asio::awaitable<void> fifoReadAsync(AddressType fifo_addr, std::span<DataType> out_data) = 0;
+    virtual asio::awaitable<void> compWriteAsync(std::span<std::pair<AddressType, DataType> const> addr_data) = 0;
+    virtual asio::awaitable<void> compReadAsync(std::span<AddressType const> addresses, std::span<DataType> out_data) = 0;
+
+    // Arbitrary address lists. Targets that know their wire format split these into the cheapest mix of
+    // single/seq/FIFO/comp operations; the default is simply a comp operation.
+    virtual asio::awaitable<void> gatherReadAsync(std::span<AddressType const> addresses, std::span<DataType> out_data)
+    {
+        co_await this->compReadAsync(addresses, out_data);
+    }
+    virtual asio::awaitable<void> scatterWriteAsync(std::span<std::pair<AddressType, DataType> const> addr_data)
+    {
+        co_await this->compWriteAsync(addr_data);
+    }
+
+private:
+    std::string name;
+};
+
+// Lets an existing blocking target be awaited.
+// The wrapped call runs inline on the awaiting thread, so this is only appropriate for targets that don't block for long (dummies, simulations).
+template <typename AddressType, typename DataType>
+class SyncRegisterTargetAwaitAdapter : public IAsyncRegisterTarget<AddressType, DataType>
+{
+public:
+    using SyncTargetType = ::RTF::IRegisterTarget<AddressType, DataType>;
+
+    explicit SyncRegisterTargetAwaitAdapter(std::shared_ptr<SyncTargetType> target)
+        : IAsyncRegisterTarget<AddressType, DataType>(target->getName())
+        , target(std::move(target))
+    {}
+    virtual std::string_view getDomain() const override { return this->target->getDomain(); }
+
+    virtual asio::awaitable<void> writeAsync(AddressType addr, DataType data) override
+    {
+        this->target->write(addr, data);
+        co_return;
+    }
+    virtual asio::awaitable<DataType> readAsync(AddressType addr) override
+    {
+        co_return this->target->read(addr);
+    }
+    virtual asio::awaitable<void> readModifyWriteAsync(AddressType addr, DataType new_data, DataType mask) override
+    {
+        this->target->readModifyWrite(addr, new_data, mask);
+        co_return;
+    }
+    virtual asio::awaitable<void> seqWriteAsync(AddressType start_addr, std::span<DataType const> data, size_t increment = sizeof(DataType)) override
+    {
+        this->target->seqWrite(start_addr, data, increment);
+        co_return;
+    }
+    virtual asio::awaitable<void> seqReadAsync(AddressType start_addr, std::span<DataType> out_data, size_t increment = sizeof(DataType)) override
+    {
+        this->target->seqRead(start_addr, out_data, increment);
+        co_return;
+    }
+    virtual asio::awaitable<void> fifoWriteAsync(AddressType fifo_addr, std::span<DataType const> data) override
+    {
+        this->target->fifoWrite(fifo_addr, data);
+        co_return;
+    }
+    virtual asio::awaitable<void> fifoReadAsync(AddressType fifo_addr, std::span<DataType> out_data) override
+    {
+        this->target->fifoRead(fifo_addr, out_data);
+        co_return;
+    }
+    virtual asio::awaitable<void> compWriteAsync(std::span<std::pair<AddressType, DataType> const> addr_data) override
+    {
+        this->target->compWrite(addr_data);
+        co_return;
+    }
+    virtual asio::awaitable<void> compReadAsync(std::span<AddressType const> addresses, std::span<DataType> out_data) override
+    {
+        this->target->compRead(addresses, out_data);
+        co_return;
+    }
+
+private:
+    std::shared_ptr<SyncTargetType> target;
+};
+
+template <typename AddressType, typename DataType>
+static inline
+std::shared_ptr<IAsyncRegisterTarget<AddressType, DataType>> makeAwaitable(std::shared_ptr<::RTF::IRegisterTarget<AddressType, DataType>> target)
+{
+    return std::make_shared<SyncRegisterTargetAwaitAdapter<AddressType, DataType>>(std::move(target));
+}
+
+// Native async RAP client.
+// Any number of operations may be in flight at once (bounded by the transaction ID space); responses are matched by transaction_id
+// in a single receive loop running on the transport's executor.
+template <IsConfigurationType Cfg>
+class AsyncRapRegisterTarget : public IAsyncRegisterTarget<typename Cfg::AddressType, typename Cfg::DataType>
+{
+public:
+    using AddressType = typename Cfg::AddressType;
+    using DataType = typename Cfg::DataType;
+
+    AsyncRapRegisterTarget(std::string_view name, std::unique_ptr<Transport::IAsyncTransport> xport, size_t max_message_size = 4096)
+        : IAsyncRegisterTarget<AddressType, DataType>(name)
+        , chan(std::make_shared<Channel>(std::move(xport), max_message_size))
+        , planner(max_message_size)
+    {
+        asio::co_spawn(this->chan->xport->getExecutor(), receiveLoop(this->chan), asio::detached);
+    }
+    ~AsyncRapRegisterTarget()
+    {
+        this->chan->xport->close();
+    }
+    AsyncRapRegisterTarget(AsyncRapRegisterTarget const&) = delete;
+    AsyncRapRegisterTarget& operator=(AsyncRapRegisterTarget const&) = delete;
+
+    virtual std::string_view getDomain() const override { return "AsyncRapRegisterTarget"; }
+
+    void setTimeout(std::chrono::steady_clock::duration timeout) { this->chan->timeout = timeout; }
+    // Number of times a command is re-sent (with the same transaction_id) after a timeout before giving up
+    void setRetries(unsigned retries) { this->chan->retries = retries; }
+
+    virtual asio::awaitable<void> writeAsync(AddressType addr, DataType data) override
+    {
+        co_await this->transact(Serdes::WriteSingleCommand<Cfg>{ .posted = false, .addr = addr, .data = data });
+    }
+    virtual asio::awaitable<DataType> readAsync(AddressType addr) override
+    {
+        auto const ack = co_await this->transact(Serdes::ReadSingleCommand<Cfg>{ .addr = addr });
+        co_return ack.data;
+    }
+    virtual asio::awaitable<void> readModifyWriteAsync(AddressType addr, DataType new_data, DataType mask) override
+    {
+        if constexpr (Cfg::FeatureReadModifyWrite) {
+            co_await this->transact(Serdes::ReadModifyWriteCommand<Cfg>{ .posted = false, .addr = addr, .data = new_data, .mask = mask });
+        }
+        else {
+            DataType v = co_await this->readAsync(addr);
+            v &= ~mask;
+            v |= new_data & mask;
+            co_await this->writeAsync(addr, v);
+        }
+    }
+    virtual asio::awaitable<void> seqWriteAsync(AddressType start_addr, std::span<DataType const> data, size_t increment = sizeof(DataType)) override
+    {
+        if (!canUseSeq(increment)) {
+            for (size_t i = 0; i < data.size(); i++)
+                co_await this->writeAsync(static_cast<AddressType>(start_addr + (increment * i)), data[i]);
+            co_return;
+        }
+        size_t const max_count = this->chan->decoder.getSerdes().getMaxSeqWriteCount();
+        for (size_t done = 0; done < data.size(); ) {
+            auto const chunk = data.subspan(done, std::min(max_count, data.size() - done));
+            auto cmd = Serdes::WriteSeqCommand<Cfg>{ .posted = false, .start_addr = static_cast<AddressType>(start_addr + (increment * done)) };
+            cmd.increment = static_cast<decltype(cmd.increment)>(increment);
+            cmd.data.assign(chunk.begin(), chunk.end());
+            co_await this->transact(std::move(cmd));
+            done += chunk.size();
+        }
+    }
+    virtual asio::awaitable<void> seqReadAsync(AddressType start_addr, std::span<DataType> out_data, size_t increment = sizeof(DataType)) override
+    {
+        if (!canUseSeq(increment)) {
+            for (size_t i = 0; i < out_data.size(); i++)
+                out_data[i] = co_await this->readAsync(static_cast<AddressType>(start_addr + (increment * i)));
+            co_return;
+        }
+        size_t const max_count = this->chan->decoder.getSerdes().getMaxSeqReadCount();
+        for (size_t done = 0; done < out_data.size(); ) {
+            auto const chunk = out_data.subspan(done, std::min(max_count, out_data.size() - done));
+            auto cmd = Serdes::ReadSeqCommand<Cfg>{ .start_addr = static_cast<AddressType>(start_addr + (increment * done)) };
+            cmd.increment = static_cast<decltype(cmd.increment)>(increment);
+            cmd.count = static_cast<decltype(cmd.count)>(chunk.size());
+            auto const ack = co_await this->transact(std::move(cmd));
+            if (ack.data.size() != chunk.size())
+                throw std::runtime_error(std::format("seqRead: expected {} words, device returned {}", chunk.size(), ack.data.size()));
+            std::copy(ack.data.begin(), ack.data.end(), chunk.begin());
+            done += chunk.size();
+        }
+    }
+    virtual asio::awaitable<void> fifoWriteAsync(AddressType fifo_addr, std::span<DataType const> data) override
+    {
+        co_await this->seqWriteAsync(fifo_addr, data, 0);
+    }
+    virtual asio::awaitable<void> fifoReadAsync(AddressType fifo_addr, std::span<DataType> out_data) override
+    {
+        co_await this->seqReadAsync(fifo_addr, out_data, 0);
+    }
+    virtual asio::awaitable<void> compWriteAsync(std::span<std::pair<AddressType, DataType> const> addr_data) override
+    {
+        if constexpr (!Cfg::FeatureCompressed) {
+            for (auto const& ad : addr_data)
+                co_await this->writeAsync(ad.first, ad.second);
+        }
+        else {
+            size_t const max_count = this->chan->decoder.getSerdes().getMaxCompWriteCount();
+            for (size_t done = 0; done < addr_data.size(); ) {
+                auto const chunk = addr_data.subspan(done, std::min(max_count, addr_data.size() - done));
+                auto cmd = Serdes::WriteCompCommand<Cfg>{ .posted = false };
+                cmd.addr_data.assign(chunk.begin(), chunk.end());
+                co_await this->transact(std::move(cmd));
+                done += chunk.size();
+            }
+        }
+    }
+    virtual asio::awaitable<void> compReadAsync(std::span<AddressType const> addresses, std::span<DataType> out_data) override
+    {
+        if (addresses.size() != out_data.size())
+            throw std::invalid_argument("compRead: addresses and out_data must be the same size");
+        if constexpr (!Cfg::FeatureCompressed) {
+            for (size_t i = 0; i < addresses.size(); i++)
+                out_data[i] = co_await this->readAsync(addresses[i]);
+        }
+        else {
+            size_t const max_count = this->chan->decoder.getSerdes().getMaxCompReadCount();
+            for (size_t done = 0; done < addresses.size(); ) {
+                auto const chunk = addresses.subspan(done, std::min(max_count, addresses.size() - done));
+                auto cmd = Serdes::ReadCompCommand<Cfg>{};
+                cmd.addresses.assign(chunk.begin(), chunk.end());
+                auto const ack = co_await this->transact(std::move(cmd));
+                if (ack.data.size() != chunk.size())
+                    throw std::runtime_error(std::format("compRead: expected {} words, device returned {}", chunk.size(), ack.data.size()));
+                std::copy(ack.data.begin(), ack.data.end(), out_data.begin() + done);
+                done += chunk.size();
+            }
+        }
+    }
+    virtual asio::awaitable<void> gatherReadAsync(std::span<AddressType const> addresses, std::span<DataType> out_data) override
+    {
+        if (addresses.size() != out_data.size())
+            throw std::invalid_argument("gatherRead: addresses and out_data must be the same size");
+        for (auto const& run : this->planner.planReads(addresses)) {
+            auto const out = out_data.subspan(run.first, run.count);
+            switch (run.kind) {
+            case RunKind::Single: out[0] = co_await this->readAsync(run.start_addr); break;
+            case RunKind::Seq: co_await this->seqReadAsync(run.start_addr, out, run.increment); break;
+            case RunKind::Fifo: co_await this->fifoReadAsync(run.start_addr, out); break;
+            case RunKind::Comp: co_await this->compReadAsync(addresses.subspan(run.first, run.count), out); break;
+            }
+        }
+    }
+    virtual asio::awaitable<void> scatterWriteAsync(std::span<std::pair<AddressType, DataType> const> addr_data) override
+    {
+        std::vector<DataType> data;
+        for (auto const& run : this->planner.planWrites(addr_data)) {
+            auto const pairs = addr_data.subspan(run.first, run.count);
+            switch (run.kind) {
+            case RunKind::Single:
+                co_await this->writeAsync(run.start_addr, pairs[0].second);
+                break;
+            case RunKind::Seq:
+            case RunKind::Fifo:
+                data.clear();
+                for (auto const& ad : pairs)
+                    data.push_back(ad.second);
+                if (run.kind == RunKind::Seq)
+                    co_await this->seqWriteAsync(run.start_addr, data, run.increment);
+                else
+                    co_await this->fifoWriteAsync(run.start_addr, data);
+                break;
+            case RunKind::Comp:
+                co_await this->compWriteAsync(pairs);
+                break;
+            }
+        }
+    }
+
+private:
+    using ResponseType = typename Serdes::SerdesTypes<Cfg>::ResponseType;
+    using TransactionIdType = typename Serdes::SerdesTypes<Cfg>::TransactionIdType;
+
+    struct Pending
+    {
+        asio::steady_timer timer;
+        std::optional<ResponseType> response;
+        std::chrono::steady_clock::time_point received_at;
+        std::chrono::steady_clock::duration decode_time;
+    };
+
+    // Everything the receive loop touches lives here so the loop can outlive the target until its pending receive is cancelled.
+    struct Channel
+    {
+        Channel(std::unique_ptr<Transport::IAsyncTransport> xport, size_t max_message_size)
+            : xport(std::move(xport))
+            , decoder(max_message_size)
+            , max_message_size(max_message_size)
+        {}
+
+        std::unique_ptr<Transport::IAsyncTransport> xport;
+        // Its Serdes encodes commands too
+        Serdes::CheckedDecoder<Cfg> decoder;
+        size_t max_message_size;
+        std::chrono::steady_clock::duration timeout = std::chrono::seconds(1);
+        unsigned retries = 0;
+        // Every transaction inserts and erases a node; recycling them per connection keeps that off the shared heap
+        std::pmr::unsynchronized_pool_resource pending_pool;
+        std::pmr::map<TransactionIdType, Pending*> pending{ &this->pending_pool };
+        TransactionIdType next_txn_id = 0;
+
+        TransactionIdType allocateTransactionId()
+        {
+            for (size_t tries = 0; tries <= std::numeric_limits<TransactionIdType>::max(); tries++) {
+                auto const id = this->next_txn_id++;
+                if (!this->pending.contains(id))
+                    return id;
+            }
+            throw std::runtime_error("No free transaction IDs; too many operations in flight");
+        }
+    };
+
+    static
+    bool canUseSeq(size_t increment)
+    {
+        if (increment == 0)
+            return Cfg::FeatureFifo;
+        if (increment == sizeof(DataType))
+            return Cfg::FeatureSequential;
+        return Cfg::FeatureIncrement;
+    }
+
+    static
+    asio::awaitable<void> receiveLoop(std::shared_ptr<Channel> chan)
+    {
+        auto buf = std::vector<std::byte>(chan->max_message_size);
+        while (true) {
+            size_t n = 0;
+            try {
+                n = co_await chan->xport->recvAsync(buf);
+            }
+            catch (asio::system_error const& ex) {
+                // Only the transport going away ends the loop. Anything else, such as an ICMP port unreachable surfacing
+                // as connection_refused on UDP, affects one datagram; stopping here would time out every later request.
+                if (ex.code() == asio::error::operation_aborted || ex.code() == asio::error::bad_descriptor)
+                    break;
+                LOG_WARN("AsyncRapRegisterTarget", "Receive failed, still listening: {}", ex.what());
+                continue;
+            }
+            auto const received_at = std::chrono::steady_clock::now();
+            Metrics::addCounter(Metrics::Side::Client, Metrics::Counter::BytesReceived, n);
+
+            auto resp = ResponseType();
+            auto const status = chan->decoder.tryDecodeResponse(std::span{ buf }.first(n), resp);
+            if (status != Serdes::DecodeStatus::Ok) {
+                Metrics::addCounter(Metrics::Side::Client, status == Serdes::DecodeStatus::BadCrc ? Metrics::Counter::CrcFailures : Metrics::Counter::DecodeFailures);
+                LOG_WARN("AsyncRapRegisterTarget", "Dropping {} response ({} bytes)", Serdes::toString(status), n);
+                continue;
+            }
+            auto const decode_time = std::chrono::steady_clock::now() - received_at;
+            auto const txn_id = std::visit([](auto const& r) { return r.transaction_id; }, resp);
+            auto const itr = chan->pending.find(txn_id);
+            if (itr == chan->pending.end()) {
+                LOG_WARN("AsyncRapRegisterTarget", "Dropping response with unknown transaction_id {}", txn_id);
+                continue;
+            }
+            itr->second->response = std::move(resp);
+            itr->second->received_at = received_at;
+            itr->second->decode_time = decode_time;
+            itr->second->timer.cancel();
+        }
+        for (auto& [id, p] : chan->pending)
+            p->timer.cancel();
+    }
+
+    template <typename CmdType>
+    asio::awaitable<typename Serdes::CommandResponseRelationshipTrait<CmdType>::AckResponseType> transact(CmdType cmd)
+    {
+        using AckType = typename Serdes::CommandResponseRelationshipTrait<CmdType>::AckResponseType;
+        using NakType = typename Serdes::CommandResponseRelationshipTrait<CmdType>::NakResponseType;
+
+        constexpr auto kind = Metrics::message_kind_v<CmdType>;
+
+        auto const chan = this->chan;
+        cmd.transaction_id = chan->allocateTransactionId();
+        Pending pending{ asio::steady_timer(chan->xport->getExecutor()), std::nullopt, {}, {} };
+        chan->pending.emplace(cmd.transaction_id, &pending);
+        struct Unregister
+        {
+            Channel& chan;
+            TransactionIdType id;
+            ~Unregister() { chan.pending.erase(id); }
+        } const unregister{ *chan, cmd.transaction_id };
+
+        auto const encode_start = std::chrono::steady_clock::now();
+        auto const buf = chan->decoder.getSerdes().encodeCommand(cmd);
+        auto sent_at = std::chrono::steady_clock::now();
+        Metrics::recordLatency(Metrics::Side::Client, kind, Metrics::Phase::Encode, sent_at - encode_start);
+
+        for (unsigned attempt = 0; attempt <= chan->retries && !pending.response.has_value(); attempt++) {
+            if (attempt != 0) {
+                Metrics::addCounter(Metrics::Side::Client, Metrics::Counter::Retries);
+                LOG_DEBUG("AsyncRapRegisterTarget", "Retrying transaction {} (attempt {})", cmd.transaction_id, attempt + 1);
+                sent_at = std::chrono::steady_clock::now();
+            }
+            pending.timer.expires_after(chan->timeout);
+            co_await chan->xport->sendAsync(std::as_bytes(std::span{ buf }));
+            Metrics::addCounter(Metrics::Side::Client, Metrics::Counter::BytesSent, buf.size());
+
+            // The response may already have been routed while the send was suspended.
+            if (!pending.response.has_value()) {
+                asio::error_code ec;
+                co_await pending.timer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+            }
+        }
+        if (!pending.response.has_value()) {
+            Metrics::addCounter(Metrics::Side::Client, Metrics::Counter::Timeouts);
+            throw std::runtime_error(std::format("Timed out waiting for response to transaction {}", cmd.transaction_id));
+        }
+        Metrics::recordLatency(Metrics::Side::Client, kind, Metrics::Phase::Wire, pending.received_at - sent_at);
+        Metrics::recordLatency(Metrics::Side::Client, kind, Metrics::Phase::Decode, pending.decode_time);
+
+        if (auto* ack = std::get_if<AckType>(&pending.response.value()))
+            co_return std::move(*ack);
+        if (auto* nak = std::get_if<NakType>(&pending.response.value())) {
+            Metrics::recordNak(Metrics::Side::Client, kind, static_cast<uint64_t>(nak->status));
+            throw std::runtime_error(std::format("Transaction {} NAK'd with status 0x{:x}", cmd.transaction_id, nak->status));
+        }
+        throw std::runtime_error(std::format("Transaction {} got an unexpected response type (index {})", cmd.transaction_id, pending.response->index()));
+    }
+
+    std::shared_ptr<Channel> chan;
+    AccessPlanner<Cfg> planner;
+};
+
+}
@@ -0,0 +1,212 @@
+#include <RAP/ServerAdapter.h>
+#include "AdvDummyRegisterTarget.h"
+#include "AsyncRegisterTarget.h"
+#include "AsyncUdpMultiplexer.h"
+#include "BatchingServerAdapter.h"
+#include "InstrumentedRegisterTarget.h"
+#include <YALF/YALF.h>
+#include <catch2/catch_test_macros.hpp>
+
+// Rethrows out of io_context::run() so failures inside a spawned sequence fail the test instead of vanishing
+static constexpr auto rethrow = [](std::exception_ptr ex) {
+    if (ex)
+        std::rethrow_exception(ex);
+};
+
+template <typename AddressType, typename DataType>
+static
+asio::awaitable<void> exerciseTarget(RAP::RTF::IAsyncRegisterTarget<AddressType, DataType>& target, AddressType base)
+{
+    co_await target.writeAsync(base + 0x1, 0x2);
+    auto const single = co_await target.readAsync(base + 0x1);
+    CHECK(single == 0x2);
+
+    co_await target.readModifyWriteAsync(base + 0x1, 0xA5, 0x0F);
+    auto const modified = co_await target.readAsync(base + 0x1);
+    CHECK(modified == 0x05);
+
+    std::vector<DataType> const data{ 0x11, 0x22, 0x33 };
+    std::vector<DataType> out_data(data.size());
+    co_await target.seqWriteAsync(base + 0x10, data);
+    co_await target.seqReadAsync(base + 0x10, out_data);
+    CHECK(out_data == data);
+
+    co_await target.fifoWriteAsync(base + 0x20, data);
+    auto const fifo_last = co_await target.readAsync(base + 0x20);
+    CHECK(fifo_last == data.back());
+
+    std::vector<std::pair<AddressType, DataType>> const addr_data{ { base + 0x30, 0x44 }, { base + 0x38, 0x55 } };
+    std::vector<AddressType> const addresses{ base + 0x30, base + 0x38 };
+    std::vector<DataType> comp_out(addresses.size());
+    co_await target.compWriteAsync(addr_data);
+    co_await target.compReadAsync(addresses, comp_out);
+    CHECK(comp_out == std::vector<DataType>{ 0x44, 0x55 });
+
+    std::vector<std::pair<AddressType, DataType>> const scatter{ { base + 0x40, 0x66 }, { base + 0x44, 0x77 }, { base + 0x48, 0x88 }, { base + 0x30, 0x99 } };
+    std::vector<AddressType> const gather{ base + 0x30, base + 0x40, base + 0x44, base + 0x48, base + 0x38 };
+    std::vector<DataType> gather_out(gather.size());
+    co_await target.scatterWriteAsync(scatter);
+    co_await target.gatherReadAsync(gather, gather_out);
+    CHECK(gather_out == std::vector<DataType>{ 0x99, 0x66, 0x77, 0x88, 0x55 });
+}
+
+TEST_CASE("Await adapter drives many targets from one thread", "[RRT][Async]")
+{
+    using AddressType = uint32_t;
+    using DataType = uint16_t;
+    asio::io_context ioc;
+
+    std::vector<std::shared_ptr<AdvDummyRegisterTarget<AddressType, DataType>>> sync_targets;
+    std::vector<std::shared_ptr<RAP::RTF::IAsyncRegisterTarget<AddressType, DataType>>> targets;
+    for (int i = 0; i < 8; i++) {
+        sync_targets.push_back(std::make_shared<AdvDummyRegisterTarget<AddressType, DataType>>(std::format("Adv Dummy {}", i)));
+        targets.push_back(RAP::RTF::makeAwaitable<AddressType, DataType>(sync_targets.back()));
+    }
+
+    for (auto& target : targets)
+        asio::co_spawn(ioc, exerciseTarget<AddressType, DataType>(*target, 0x100), rethrow);
+    REQUIRE_NOTHROW(ioc.run());
+
+    for (auto& sync_target : sync_targets)
+        CHECK(sync_target->read(0x101) == 0x05);
+}
+
+TEST_CASE("Explore AsyncRapRegisterTarget", "[Explore][RRT][Async]")
+{
+    using CFG = RAP::ExampleRapCfg;
+    asio::io_context ioc;
+
+    auto server_xport = RAP::Transport::makeSyncUdpTransport("localhost", 4322, "localhost", 1235, false);
+    auto simple_target = std::make_shared<AdvDummyRegisterTarget<CFG::AddressType, CFG::DataType>>("Adv Dummy");
+    auto instrumented_target = std::make_shared<InstrumentedRegisterTarget<CFG::AddressType, CFG::DataType>>(simple_target);
+    auto rap_server_adapter = RAP::RTF::RapServerAdapter<CFG>(std::move(server_xport), instrumented_target);
+
+    auto client_xport = RAP::Transport::makeAsyncUdpTransport(ioc.get_executor(), "localhost", 1235, "localhost", 4322);
+    auto rap_target = RAP::RTF::AsyncRapRegisterTarget<CFG>("Async Rap Target", std::move(client_xport));
+    rap_target.setTimeout(std::chrono::seconds(1));
+
+    // Several independent sequences in flight on one thread, interleaved on the wire.
+    // The receive loop keeps the io_context busy, so stop it once the last sequence finishes.
+    std::vector<CFG::AddressType> const bases{ 0x000, 0x100, 0x200, 0x300 };
+    size_t remaining = bases.size();
+    for (auto const base : bases) {
+        asio::co_spawn(ioc, exerciseTarget<CFG::AddressType, CFG::DataType>(rap_target, base), [&](std::exception_ptr ex) {
+            if (--remaining == 0)
+                ioc.stop();
+            rethrow(ex);
+        });
+    }
+    REQUIRE_NOTHROW(ioc.run());
+    CHECK(remaining == 0);
+
+    RAP::Metrics::dumpToLog(RAP::Metrics::takeSnapshot());
+}
+
+TEST_CASE("Explore multiplexed AsyncRapRegisterTargets", "[Explore][RRT][Async]")
+{
+    using CFG = RAP::ExampleRapCfg;
+    constexpr size_t device_count = 4;
+    constexpr uint16_t first_server_port = 4340;
+    asio::io_context ioc;
+
+    std::vector<std::shared_ptr<AdvDummyRegisterTarget<CFG::AddressType, CFG::DataType>>> simple_targets;
+    // Each adapter runs a thread holding a pointer to it, so they must never move
+    std::vector<std::unique_ptr<RAP::RTF::RapServerAdapter<CFG>>> server_adapters;
+    for (size_t i = 0; i < device_count; i++) {
+        auto const port = static_cast<uint16_t>(first_server_port + i);
+        simple_targets.push_back(std::make_shared<AdvDummyRegisterTarget<CFG::AddressType, CFG::DataType>>(std::format("Adv Dummy {}", i)));
+        server_adapters.push_back(std::make_unique<RAP::RTF::RapServerAdapter<CFG>>(RAP::Transport::makeSyncUdpTransport("localhost", port, "localhost", 1250, false), simple_targets.back()));
+    }
+
+    // One socket, one receive loop, many devices
+    auto mux = RAP::Transport::AsyncUdpMultiplexer(ioc.get_executor(), "localhost", 1250);
+    std::vector<std::unique_ptr<RAP::RTF::AsyncRapRegisterTarget<CFG>>> rap_targets;
+    for (size_t i = 0; i < device_count; i++) {
+        auto const port = static_cast<uint16_t>(first_server_port + i);
+        rap_targets.push_back(std::make_unique<RAP::RTF::AsyncRapRegisterTarget<CFG>>(std::format("Rap Target {}", i), mux.makeDeviceTransport("localhost", port)));
+    }
+    CHECK(mux.deviceCount() == device_count);
+
+    size_t remaining = rap_targets.size();
+    for (auto& rap_target : rap_targets) {
+        asio::co_spawn(ioc, exerciseTarget<CFG::AddressType, CFG::DataType>(*rap_target, 0x100), [&](std::exception_ptr ex) {
+            if (--remaining == 0)
+                ioc.stop();
+            rethrow(ex);
+        });
+    }
+    REQUIRE_NOTHROW(ioc.run());
+    CHECK(remaining == 0);
+    for (auto& simple_target : simple_targets)
+        CHECK(simple_target->read(0x101) == 0x05);
+}
+
+TEST_CASE("Multiplexer keeps receiving after sending to an unreachable device", "[RRT][Async]")
+{
+    using CFG = RAP::ExampleRapCfg;
+    asio::io_context ioc;
+
+    auto simple_target = std::make_shared<AdvDummyRegisterTarget<CFG::AddressType, CFG::DataType>>("Adv Dummy");
+    auto server_adapter = RAP::RTF::RapServerAdapter<CFG>(RAP::Transport::makeSyncUdpTransport("localhost", 4345, "localhost", 1251, false), simple_target);
+
+    auto mux = RAP::Transport::AsyncUdpMultiplexer(ioc.get_executor(), "localhost", 1251);
+    // Nothing listens on 4346; on Windows the ICMP port unreachable this draws fails the shared socket's next receive
+    auto dead_target = RAP::RTF::AsyncRapRegisterTarget<CFG>("Dead Target", mux.makeDeviceTransport("localhost", 4346));
+    dead_target.setTimeout(std::chrono::milliseconds(100));
+    auto live_target = RAP::RTF::AsyncRapRegisterTarget<CFG>("Live Target", mux.makeDeviceTransport("localhost", 4345));
+    live_target.setTimeout(std::chrono::seconds(1));
+
+    bool dead_timed_out = false;
+    asio::co_spawn(ioc, [&]() -> asio::awaitable<void> {
+        try {
+            co_await dead_target.readAsync(0x10);
+        }
+        catch (std::runtime_error const&) {
+            dead_timed_out = true;
+        }
+        co_await exerciseTarget<CFG::AddressType, CFG::DataType>(live_target, 0x100);
+    }, [&](std::exception_ptr ex) {
+        ioc.stop();
+        rethrow(ex);
+    });
+    REQUIRE_NOTHROW(ioc.run());
+    CHECK(dead_timed_out);
+    CHECK(simple_target->read(0x101) == 0x05);
+}
+
+TEST_CASE("Explore BatchingServerAdapter with pipelined commands", "[Explore][RRT][Async]")
+{
+    using CFG = RAP::ExampleRapCfg;
+    constexpr size_t in_flight = 256;
+    asio::io_context ioc;
+
+    auto simple_target = std::make_shared<AdvDummyRegisterTarget<CFG::AddressType, CFG::DataType>>("Adv Dummy");
+    auto server = RAP::RTF::BatchingServerAdapter<CFG>("localhost", 4350, simple_target);
+
+    auto client_xport = RAP::Transport::makeAsyncUdpTransport(ioc.get_executor(), "localhost", 1255, "localhost", 4350);
+    auto rap_target = RAP::RTF::AsyncRapRegisterTarget<CFG>("Async Rap Target", std::move(client_xport));
+    rap_target.setTimeout(std::chrono::seconds(1));
+
+    // Every write is on the wire before the first ack comes back, so the server sees a full receive queue
+    size_t remaining = in_flight;
+    for (size_t i = 0; i < in_flight; i++) {
+        auto const addr = static_cast<CFG::AddressType>(i * sizeof(CFG::DataType));
+        asio::co_spawn(ioc, [&rap_target, addr, i]() -> asio::awaitable<void> {
+            co_await rap_target.writeAsync(addr, static_cast<CFG::DataType>(i));
+            auto const readback = co_await rap_target.readAsync(addr);
+            CHECK(readback == static_cast<CFG::DataType>(i));
+        }, [&](std::exception_ptr ex) {
+            if (--remaining == 0)
+                ioc.stop();
+            rethrow(ex);
+        });
+    }
+    REQUIRE_NOTHROW(ioc.run());
+    CHECK(remaining == 0);
+
+    auto const& stats = server.stats();
+    CHECK(stats.commands == in_flight * 2);
+    CHECK(stats.responses == in_flight * 2);
+    CHECK(stats.send_syscalls <= stats.responses);
+    LOG_INFO("Test", "{} commands answered in {} batches with {} send syscalls", stats.commands.load(), stats.batches.load(), stats.send_syscalls.load());
+}
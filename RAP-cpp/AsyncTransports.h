@@ -0,0 +1,30 @@
+#pragma once
+#include <asio.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+
+namespace RAP::Transport {
+
+// Event-loop counterpart of the sync transports.
+// All operations complete on the transport's executor; a single io_context thread can service any number of transports.
+class IAsyncTransport
+{
+public:
+    virtual ~IAsyncTransport() = default;
+
+    virtual asio::any_io_executor getExecutor() = 0;
+
+    virtual asio::awaitable<void> sendAsync(std::span<std::byte const> buf) = 0;
+    // Receives one whole message into buf and returns its length.
+    virtual asio::awaitable<size_t> recvAsync(std::span<std::byte> buf) = 0;
+
+    // Cancels any outstanding operations; they complete with asio::error::operation_aborted.
+    virtual void close() = 0;
+};
+
+std::unique_ptr<IAsyncTransport> makeAsyncUdpTransport(asio::any_io_executor executor, std::string_view local_host, uint16_t local_port, std::string_view remote_host, uint16_t remote_port);
+
+}
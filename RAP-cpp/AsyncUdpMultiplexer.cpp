@@ -0,0 +1,191 @@
+#include "AsyncUdpMultiplexer.h"
+#include <YALF/YALF.h>
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <map>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace RAP::Transport {
+
+struct MultiplexedDeviceRoute
+{
+    explicit MultiplexedDeviceRoute(asio::any_io_executor executor, size_t queue_depth)
+        : signal(executor, asio::steady_timer::time_point::max())
+        , queue_depth(queue_depth)
+    {}
+
+    std::deque<std::vector<std::byte>> queued;
+    asio::steady_timer signal;
+    size_t queue_depth;
+    // Set while a recvAsync is parked waiting for this device
+    std::span<std::byte> waiting_buf;
+    std::optional<size_t> delivered;
+    bool closed = false;
+
+    void deliver(std::span<std::byte const> msg)
+    {
+        if (!this->waiting_buf.empty() && !this->delivered.has_value()) {
+            auto const n = std::min(msg.size(), this->waiting_buf.size());
+            std::memcpy(this->waiting_buf.data(), msg.data(), n);
+            this->delivered = n;
+            this->signal.cancel();
+            return;
+        }
+        if (this->queued.size() >= this->queue_depth) {
+            LOG_WARN("AsyncUdpMultiplexer", "Device receive queue full ({}), dropping oldest datagram", this->queue_depth);
+            this->queued.pop_front();
+        }
+        this->queued.emplace_back(msg.begin(), msg.end());
+    }
+};
+
+struct AsyncUdpMultiplexer::Shared
+{
+    Shared(asio::any_io_executor executor, asio::ip::udp::endpoint local_ep, size_t max_message_size)
+        : socket(executor, local_ep)
+        , max_message_size(max_message_size)
+    {}
+
+    asio::ip::udp::socket socket;
+    size_t max_message_size;
+    std::map<asio::ip::udp::endpoint, MultiplexedDeviceRoute*> routes;
+};
+
+static
+asio::ip::udp::endpoint resolveEndpoint(asio::any_io_executor executor, std::string_view host, uint16_t port)
+{
+    auto resolver = asio::ip::udp::resolver(executor);
+    return resolver.resolve(asio::ip::udp::v4(), std::string{ host }, std::to_string(port)).begin()->endpoint();
+}
+
+static
+asio::awaitable<void> multiplexerReceiveLoop(std::shared_ptr<AsyncUdpMultiplexer::Shared> shared)
+{
+    auto buf = std::vector<std::byte>(shared->max_message_size);
+    while (true) {
+        asio::ip::udp::endpoint sender_ep;
+        size_t n = 0;
+        try {
+            n = co_await shared->socket.async_receive_from(asio::buffer(buf), sender_ep, asio::use_awaitable);
+        }
+        catch (asio::system_error const& ex) {
+            // Only the socket going away ends the loop. Anything else affects one datagram: on Windows, one powered-off board's
+            // ICMP port unreachable fails the next receive with connection_refused, and stopping would cut off every device.
+            if (ex.code() == asio::error::operation_aborted || ex.code() == asio::error::bad_descriptor)
+                break;
+            LOG_WARN("AsyncUdpMultiplexer", "Receive failed, still listening: {}", ex.what());
+            continue;
+        }
+        auto const itr = shared->routes.find(sender_ep);
+        if (itr == shared->routes.end()) {
+            LOG_DEBUG("AsyncUdpMultiplexer", "Dropping {} bytes from unknown sender {}:{}", n, sender_ep.address().to_string(), sender_ep.port());
+            continue;
+        }
+        itr->second->deliver(std::span{ buf }.first(n));
+    }
+    for (auto& [ep, route] : shared->routes) {
+        route->closed = true;
+        route->signal.cancel();
+    }
+}
+
+class MultiplexedDeviceTransport : public IAsyncTransport
+{
+public:
+    MultiplexedDeviceTransport(std::shared_ptr<AsyncUdpMultiplexer::Shared> shared, asio::ip::udp::endpoint remote_ep, size_t queue_depth)
+        : IAsyncTransport()
+        , shared(std::move(shared))
+        , remote_ep(remote_ep)
+        , route(this->shared->socket.get_executor(), queue_depth)
+    {
+        auto const [itr, inserted] = this->shared->routes.emplace(remote_ep, &this->route);
+        if (!inserted)
+            throw std::runtime_error(std::format("A device at {}:{} is already attached to this multiplexer", remote_ep.address().to_string(), remote_ep.port()));
+    }
+    ~MultiplexedDeviceTransport()
+    {
+        this->shared->routes.erase(this->remote_ep);
+    }
+
+    virtual asio::any_io_executor getExecutor() override
+    {
+        return this->shared->socket.get_executor();
+    }
+
+    virtual asio::awaitable<void> sendAsync(std::span<std::byte const> buf) override
+    {
+        co_await this->shared->socket.async_send_to(asio::buffer(buf.data(), buf.size()), this->remote_ep, asio::use_awaitable);
+    }
+
+    virtual asio::awaitable<size_t> recvAsync(std::span<std::byte> buf) override
+    {
+        if (!this->route.queued.empty()) {
+            auto const msg = std::move(this->route.queued.front());
+            this->route.queued.pop_front();
+            auto const n = std::min(msg.size(), buf.size());
+            std::memcpy(buf.data(), msg.data(), n);
+            co_return n;
+        }
+        if (this->route.closed)
+            throw asio::system_error(asio::error::operation_aborted);
+
+        this->route.waiting_buf = buf;
+        this->route.delivered.reset();
+        this->route.signal.expires_at(asio::steady_timer::time_point::max());
+        asio::error_code ec;
+        co_await this->route.signal.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+        this->route.waiting_buf = {};
+        if (!this->route.delivered.has_value())
+            throw asio::system_error(asio::error::operation_aborted);
+        co_return this->route.delivered.value();
+    }
+
+    virtual void close() override
+    {
+        this->route.closed = true;
+        this->route.signal.cancel();
+    }
+
+private:
+    std::shared_ptr<AsyncUdpMultiplexer::Shared> shared;
+    asio::ip::udp::endpoint remote_ep;
+    MultiplexedDeviceRoute route;
+};
+
+AsyncUdpMultiplexer::AsyncUdpMultiplexer(asio::any_io_executor executor, std::string_view local_host, uint16_t local_port, size_t max_message_size)
+    : shared(std::make_shared<Shared>(executor, resolveEndpoint(executor, local_host, local_port), max_message_size))
+{
+    LOG_DEBUG("AsyncUdpMultiplexer", "Bound to {}:{}", local_host, local_port);
+    asio::co_spawn(executor, multiplexerReceiveLoop(this->shared), asio::detached);
+}
+
+AsyncUdpMultiplexer::~AsyncUdpMultiplexer()
+{
+    this->close();
+}
+
+std::unique_ptr<IAsyncTransport> AsyncUdpMultiplexer::makeDeviceTransport(std::string_view remote_host, uint16_t remote_port, size_t queue_depth)
+{
+    auto const remote_ep = resolveEndpoint(this->shared->socket.get_executor(), remote_host, remote_port);
+    return std::make_unique<MultiplexedDeviceTransport>(this->shared, remote_ep, queue_depth);
+}
+
+size_t AsyncUdpMultiplexer::deviceCount() const
+{
+    return this->shared->routes.size();
+}
+
+void AsyncUdpMultiplexer::close()
+{
+    asio::error_code ec;
+    this->shared->socket.cancel(ec);
+    this->shared->socket.close(ec);
+}
+
+}
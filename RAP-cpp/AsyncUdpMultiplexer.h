@@ -0,0 +1,36 @@
+#pragma once
+#include "AsyncTransports.h"
+#include <asio.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace RAP::Transport {
+
+// One UDP socket and one receive loop shared by many devices.
+// Each device gets its own IAsyncTransport, so each AsyncRapRegisterTarget keeps its own transaction ID space;
+// incoming datagrams are routed to the right device by source endpoint, then by transaction_id inside the target.
+// Talking to a rack of 64 boards costs one file descriptor and one pending receive instead of 64 of each.
+// Not thread-safe: use a single-threaded io_context (or a strand) for the multiplexer and all its devices.
+class AsyncUdpMultiplexer
+{
+public:
+    AsyncUdpMultiplexer(asio::any_io_executor executor, std::string_view local_host, uint16_t local_port, size_t max_message_size = 4096);
+    ~AsyncUdpMultiplexer();
+    AsyncUdpMultiplexer(AsyncUdpMultiplexer const&) = delete;
+    AsyncUdpMultiplexer& operator=(AsyncUdpMultiplexer const&) = delete;
+
+    // queue_depth bounds how many unclaimed datagrams are held for a device before the oldest is dropped
+    std::unique_ptr<IAsyncTransport> makeDeviceTransport(std::string_view remote_host, uint16_t remote_port, size_t queue_depth = 64);
+
+    size_t deviceCount() const;
+    void close();
+
+    struct Shared;
+
+private:
+    std::shared_ptr<Shared> shared;
+};
+
+}
@@ -0,0 +1,66 @@
+#include "AsyncTransports.h"
+#include <YALF/YALF.h>
+#include <string>
+
+namespace RAP::Transport {
+
+class AsyncUdpTransport : public IAsyncTransport
+{
+public:
+    AsyncUdpTransport(asio::any_io_executor executor, asio::ip::udp::endpoint local_ep, asio::ip::udp::endpoint remote_ep)
+        : IAsyncTransport()
+        , socket(executor, local_ep)
+        , remote_ep(remote_ep)
+    {
+        LOG_DEBUG("AsyncUdpTransport", "Bound to {}:{}, remote is {}:{}", local_ep.address().to_string(), local_ep.port(), remote_ep.address().to_string(), remote_ep.port());
+    }
+
+    virtual asio::any_io_executor getExecutor() override
+    {
+        return this->socket.get_executor();
+    }
+
+    virtual asio::awaitable<void> sendAsync(std::span<std::byte const> buf) override
+    {
+        co_await this->socket.async_send_to(asio::buffer(buf.data(), buf.size()), this->remote_ep, asio::use_awaitable);
+    }
+
+    virtual asio::awaitable<size_t> recvAsync(std::span<std::byte> buf) override
+    {
+        while (true) {
+            asio::ip::udp::endpoint sender_ep;
+            auto const n = co_await this->socket.async_receive_from(asio::buffer(buf.data(), buf.size()), sender_ep, asio::use_awaitable);
+            if (sender_ep == this->remote_ep)
+                co_return n;
+            LOG_WARN("AsyncUdpTransport", "Dropping {} bytes from unexpected sender {}:{}", n, sender_ep.address().to_string(), sender_ep.port());
+        }
+    }
+
+    virtual void close() override
+    {
+        asio::error_code ec;
+        this->socket.cancel(ec);
+        this->socket.close(ec);
+    }
+
+private:
+    asio::ip::udp::socket socket;
+    asio::ip::udp::endpoint remote_ep;
+};
+
+static
+asio::ip::udp::endpoint resolveUdpEndpoint(asio::any_io_executor executor, std::string_view host, uint16_t port)
+{
+    auto resolver = asio::ip::udp::resolver(executor);
+    auto const results = resolver.resolve(asio::ip::udp::v4(), std::string{ host }, std::to_string(port));
+    return results.begin()->endpoint();
+}
+
+std::unique_ptr<IAsyncTransport> makeAsyncUdpTransport(asio::any_io_executor executor, std::string_view local_host, uint16_t local_port, std::string_view remote_host, uint16_t remote_port)
+{
+    auto const local_ep = resolveUdpEndpoint(executor, local_host, local_port);
+    auto const remote_ep = resolveUdpEndpoint(executor, remote_host, remote_port);
+    return std::make_unique<AsyncUdpTransport>(executor, local_ep, remote_ep);
+}
+
+}
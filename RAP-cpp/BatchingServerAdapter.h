@@ -0,0 +1,184 @@
+#pragma once
+#include <RAP/Serdes.h>
+#include <RTF/RTF.h>
+#include <YALF/YALF.h>
+#include "CheckedDecode.h"
+#include "DispatchArena.h"
+#include "LinkEncoding.h"
+#include "RapMetrics.h"
+#include "SerdesTypes.h"
+#include "ServerDispatch.h"
+#include "ThreadPlacement.h"
+#include "UdpBatchSend.h"
+#include <asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace RAP::RTF {
+
+struct BatchingOptions
+{
+    // Most commands drained and answered in one go
+    size_t max_batch = 64;
+    // Upper bound on how long the first command of a batch can wait for its response because later ones are being drained.
+    // Nothing is ever waited for: a batch only holds what was already queued on the socket.
+    std::chrono::microseconds max_added_latency{ 200 };
+    size_t max_message_size = 4096;
+    // Speak link framing (see LinkEncoding.h). Each response is encoded with whatever its command's frame advertised,
+    // so clients with and without encodings enabled can share the server, but all of them must use link framing.
+    // A word_size of 0 means the Cfg's DataBytes.
+    std::optional<Transport::LinkEncodingOptions> link_encoding;
+};
+
+struct BatchingStats
+{
+    std::atomic<uint64_t> commands = 0;
+    std::atomic<uint64_t> responses = 0;
+    std::atomic<uint64_t> batches = 0;
+    std::atomic<uint64_t> send_syscalls = 0; // Can trail the others by the batch being sent
+};
+
+// UDP RAP server that answers pipelined commands in batches.
+// RapServerAdapter does one receive, one encodeResponse and one send per command. This drains every command already waiting on the socket
+// (up to BatchingOptions::max_batch / max_added_latency), executes them in order, encodes every response back to back into one arena,
+// and hands the lot to UdpBatchSender, so a burst of N small commands costs ~1 send syscall instead of N.
+// Responses go back to whichever endpoint sent the command. Runs its own thread until destroyed.
+template <IsConfigurationType Cfg>
+class BatchingServerAdapter
+{
+public:
+    using TargetType = ::RTF::IRegisterTarget<typename Cfg::AddressType, typename Cfg::DataType>;
+
+    BatchingServerAdapter(std::string_view local_host, uint16_t local_port, std::shared_ptr<TargetType> target, BatchingOptions options = {})
+        : target(std::move(target))
+        , options(options)
+        , socket(this->ioc)
+    {
+        if (auto& link = this->options.link_encoding; link && link->word_size == 0)
+            link->word_size = Cfg::DataBytes;
+        auto resolver = asio::ip::udp::resolver(this->ioc);
+        auto const local_ep = resolver.resolve(asio::ip::udp::v4(), std::string{ local_host }, std::to_string(local_port)).begin()->endpoint();
+        this->socket.open(local_ep.protocol());
+        this->socket.bind(local_ep);
+        LOG_DEBUG("BatchingServerAdapter", "Serving {} on {}:{}", this->target->getName(), local_host, local_port);
+        asio::co_spawn(this->ioc, this->serve(), asio::detached);
+        // serve() first runs on this thread, after it is placed, so its receive buffer and arena are NUMA-local
+        this->thread = std::jthread([this]() {
+            Threads::placeCurrentThread(Threads::Role::ServerWorker, "RapBatchServer");
+            this->ioc.run();
+        });
+    }
+    ~BatchingServerAdapter()
+    {
+        this->ioc.stop();
+    }
+    BatchingServerAdapter(BatchingServerAdapter const&) = delete;
+    BatchingServerAdapter& operator=(BatchingServerAdapter const&) = delete;
+
+    BatchingStats const& stats() const { return this->batch_stats; }
+
+private:
+    asio::awaitable<void> serve()
+    {
+        // Garbage floods are rejected through status codes rather than exceptions wherever possible
+        auto decoder = Serdes::CheckedDecoder<Cfg>(this->options.max_message_size);
+        auto sender = Transport::UdpBatchSender(this->socket);
+        auto rx = std::vector<std::byte>(this->options.max_message_size + 1);
+        auto plain = std::vector<std::byte>(this->options.link_encoding ? this->options.max_message_size : 0);
+        // Sized for a full batch of maximum-size responses, so the steady state never leaves it
+        auto dispatch_arena = Memory::DispatchArena(this->options.max_batch * (this->options.max_message_size + 1 + sizeof(Transport::DatagramSlice)));
+
+        while (true) {
+            asio::error_code ec;
+            co_await this->socket.async_wait(asio::ip::udp::socket::wait_read, asio::redirect_error(asio::use_awaitable, ec));
+            if (ec)
+                co_return;
+            this->dispatchBatch(decoder, sender, rx, plain, dispatch_arena);
+            dispatch_arena.reset();
+        }
+    }
+
+    // Drains, executes and answers whatever is queued on the socket right now; all per-batch memory comes from dispatch_arena
+    void dispatchBatch(Serdes::CheckedDecoder<Cfg>& decoder, Transport::UdpBatchSender& sender, std::span<std::byte> rx, std::span<std::byte> plain, Memory::DispatchArena& dispatch_arena)
+    {
+        auto const batch_start = std::chrono::steady_clock::now();
+        auto arena = std::pmr::vector<std::byte>(dispatch_arena.resource());
+        arena.reserve(this->options.max_batch * (this->options.max_message_size + 1));
+        auto slices = std::pmr::vector<Transport::DatagramSlice>(dispatch_arena.resource());
+        slices.reserve(this->options.max_batch);
+        size_t commands = 0;
+        asio::error_code ec;
+        typename Serdes::SerdesTypes<Cfg>::CommandType cmd;
+        // available() is non-zero while another datagram is queued, so draining never blocks
+        do {
+            asio::ip::udp::endpoint sender_ep;
+            auto const n = this->socket.receive_from(asio::buffer(rx.data(), rx.size()), sender_ep, 0, ec);
+            if (ec)
+                break;
+            commands++;
+            Metrics::addCounter(Metrics::Side::Server, Metrics::Counter::BytesReceived, n);
+            auto message = rx.first(n);
+            uint8_t peer_capabilities = 0;
+            if (auto const& link = this->options.link_encoding) {
+                auto const size = Transport::decodeLinkFrame(message, link.value(), plain, peer_capabilities);
+                if (!size) {
+                    Metrics::addCounter(Metrics::Side::Server, Metrics::Counter::DecodeFailures);
+                    continue;
+                }
+                message = plain.first(size.value());
+            }
+            auto const decode_start = std::chrono::steady_clock::now();
+            auto const status = decoder.tryDecodeCommand(message, cmd);
+            if (status != Serdes::DecodeStatus::Ok) {
+                Metrics::addCounter(Metrics::Side::Server, status == Serdes::DecodeStatus::BadCrc ? Metrics::Counter::CrcFailures : Metrics::Counter::DecodeFailures);
+                LOG_DEBUG("BatchingServerAdapter", "Dropping {} command ({} bytes) from {}:{}", Serdes::toString(status), n, sender_ep.address().to_string(), sender_ep.port());
+                continue;
+            }
+            auto const kind = std::visit([](auto const& c) { return Metrics::message_kind_v<std::remove_cvref_t<decltype(c)>>; }, cmd);
+            Metrics::recordLatency(Metrics::Side::Server, kind, Metrics::Phase::Decode, std::chrono::steady_clock::now() - decode_start);
+            if (auto const resp = executeCommand<Cfg>(*this->target, cmd)) {
+                auto const encode_start = std::chrono::steady_clock::now();
+                auto const encoded = decoder.getSerdes().encodeResponse(resp.value());
+                auto const out = std::as_bytes(std::span{ encoded });
+                auto const offset = arena.size();
+                if (auto const& link = this->options.link_encoding) {
+                    arena.resize(offset + out.size() + 1);
+                    arena.resize(offset + Transport::encodeLinkFrame(out, peer_capabilities, link.value(), std::span{ arena }.subspan(offset)));
+                } else {
+                    arena.insert(arena.end(), out.begin(), out.end());
+                }
+                slices.push_back({ .offset = offset, .size = arena.size() - offset, .destination = sender_ep });
+                Metrics::recordLatency(Metrics::Side::Server, kind, Metrics::Phase::Encode, std::chrono::steady_clock::now() - encode_start);
+            }
+        } while (commands < this->options.max_batch
+            && std::chrono::steady_clock::now() - batch_start < this->options.max_added_latency
+            && this->socket.available(ec) > 0);
+
+        // Counted before sending: a client that has its last response has to be able to see its commands in the stats
+        this->batch_stats.commands += commands;
+        this->batch_stats.responses += slices.size();
+        this->batch_stats.batches++;
+        if (!slices.empty()) {
+            Metrics::addCounter(Metrics::Side::Server, Metrics::Counter::BytesSent, arena.size());
+            this->batch_stats.send_syscalls += sender.send(arena, slices);
+        }
+    }
+
+    std::shared_ptr<TargetType> target;
+    BatchingOptions options;
+    BatchingStats batch_stats;
+    asio::io_context ioc;
+    asio::ip::udp::socket socket;
+    std::jthread thread;
+};
+
+}
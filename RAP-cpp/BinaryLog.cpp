@@ -0,0 +1,513 @@
+#include "BinaryLog.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace RAP::BinaryLog {
+
+namespace {
+    constexpr char FileMagic[8] = { 'R', 'A', 'P', 'B', 'L', 'O', 'G', '1' };
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t header_size;
+        uint32_t segment_index;
+        int64_t start_unix_ns;
+    };
+    static_assert(sizeof(FileHeader) == 24);
+
+    // Every record starts with three LEB128 fields: format ID, domain ID and ns since the previous entry in the segment.
+    // Format ID 0 marks a control record; its other two fields are the RecordKind and the payload size.
+    struct EntryHeader
+    {
+        uint64_t format_id;
+        uint64_t domain_id;
+        uint64_t delta_ns;
+    };
+    constexpr size_t MaxEntryHeaderSize = 3 + 3 + 10;
+
+    enum class RecordKind : uint16_t
+    {
+        FormatDefinition = 1, // u16 id, u8 level, u8 arg count, u32 line, string format, string file, u8 arg types[]
+        DomainDefinition = 2, // u16 id, string name
+    };
+
+    std::byte* putHeader(std::byte* p, EntryHeader const& eh)
+    {
+        p = detail::putVarint(p, eh.format_id);
+        p = detail::putVarint(p, eh.domain_id);
+        return detail::putVarint(p, eh.delta_ns);
+    }
+
+    std::byte* putRaw(std::byte* p, void const* src, size_t n)
+    {
+        std::memcpy(p, src, n);
+        return p + n;
+    }
+    std::byte* putString(std::byte* p, std::string_view s)
+    {
+        p = detail::putVarint(p, s.size());
+        return putRaw(p, s.data(), s.size());
+    }
+    size_t stringSize(std::string_view s)
+    {
+        return detail::varintSize(s.size()) + s.size();
+    }
+    size_t formatDefinitionSize(FormatSite const& site, size_t arg_count)
+    {
+        return 2 + 1 + 1 + 4 + stringSize(site.format) + stringSize(site.file) + arg_count;
+    }
+    size_t domainDefinitionSize(std::string_view domain)
+    {
+        return 2 + stringSize(domain);
+    }
+
+    std::filesystem::path segmentFilename(std::filesystem::path const& base, size_t index)
+    {
+        auto name = base.stem();
+        name += std::format(".{}", index);
+        name += base.extension();
+        return base.parent_path() / name;
+    }
+
+    class Cursor
+    {
+    public:
+        explicit Cursor(std::span<std::byte const> bytes) : bytes(bytes) {}
+
+        bool empty() const { return this->offset >= this->bytes.size(); }
+        size_t position() const { return this->offset; }
+
+        template <typename T>
+        T raw()
+        {
+            this->require(sizeof(T));
+            T v{};
+            std::memcpy(&v, this->bytes.data() + this->offset, sizeof(T));
+            this->offset += sizeof(T);
+            return v;
+        }
+        uint64_t varint()
+        {
+            uint64_t v = 0;
+            for (unsigned shift = 0; shift < 64; shift += 7) {
+                auto const b = std::to_integer<uint64_t>(this->raw<std::byte>());
+                v |= (b & 0x7F) << shift;
+                if (!(b & 0x80))
+                    return v;
+            }
+            throw std::runtime_error("Overlong varint");
+        }
+        std::string_view string()
+        {
+            auto const n = this->varint();
+            this->require(n);
+            auto const s = std::string_view{ reinterpret_cast<char const*>(this->bytes.data() + this->offset), n };
+            this->offset += n;
+            return s;
+        }
+
+    private:
+        void require(size_t n)
+        {
+            if (this->bytes.size() - this->offset < n)
+                throw std::runtime_error("Truncated record");
+        }
+
+        std::span<std::byte const> bytes;
+        size_t offset = 0;
+    };
+
+    std::mutex global_sink_mutex;
+    std::vector<std::unique_ptr<BinaryLogSink>> global_sinks; // Every sink ever installed, the current one last
+    std::atomic<BinaryLogSink*> global_sink{ nullptr };
+}
+
+BinaryLogSink::BinaryLogSink(std::filesystem::path const& filename, SinkOptions options)
+    : base_filename(filename)
+    , options(options)
+    , max_level(static_cast<int>(YALF::LogLevel::Info))
+    , default_level(static_cast<int>(YALF::LogLevel::Info))
+{
+    this->options.segment_size = std::max<size_t>(this->options.segment_size, 64 * 1024);
+    this->options.max_segments = std::max<size_t>(this->options.max_segments, 1);
+    this->openSegment();
+}
+
+BinaryLogSink::~BinaryLogSink()
+{
+    auto const lock = std::scoped_lock(this->mutex);
+    this->closeSegment();
+}
+
+void BinaryLogSink::setDefaultLogLevel(YALF::LogLevel level)
+{
+    auto const lock = std::scoped_lock(this->mutex);
+    this->default_level = static_cast<int>(level);
+    this->recomputeMaxLevel();
+}
+
+void BinaryLogSink::setDomainLogLevel(std::string_view domain, YALF::LogLevel level)
+{
+    auto const lock = std::scoped_lock(this->mutex);
+    auto itr = this->domains.find(domain);
+    if (itr == this->domains.end())
+        itr = this->domains.emplace(std::string{ domain }, DomainInfo{ static_cast<uint16_t>(this->domains.size() + 1), std::nullopt }).first;
+    itr->second.level = static_cast<int>(level);
+    this->recomputeMaxLevel();
+}
+
+void BinaryLogSink::recomputeMaxLevel()
+{
+    auto max_level = this->default_level;
+    for (auto const& [name, info] : this->domains)
+        if (info.level.has_value())
+            max_level = std::max(max_level, info.level.value());
+    this->max_level.store(max_level, std::memory_order_relaxed);
+}
+
+std::byte* BinaryLogSink::beginEntry(FormatSite const& site, std::span<ArgType const> arg_types, std::string_view domain, std::chrono::steady_clock::time_point now, size_t args_size)
+{
+    if (!this->file.isOpen())
+        return nullptr;
+    auto domain_itr = this->domains.find(domain);
+    if (domain_itr == this->domains.end()) {
+        if (this->domains.size() >= std::numeric_limits<uint16_t>::max())
+            return nullptr;
+        domain_itr = this->domains.emplace(std::string{ domain }, DomainInfo{ static_cast<uint16_t>(this->domains.size() + 1), std::nullopt }).first;
+    }
+    auto const& domain_info = domain_itr->second;
+    if (static_cast<int>(site.level) > domain_info.level.value_or(this->default_level))
+        return nullptr;
+
+    auto format_itr = this->format_ids.find(&site);
+    if (format_itr == this->format_ids.end()) {
+        if (this->format_ids.size() >= std::numeric_limits<uint16_t>::max())
+            return nullptr;
+        format_itr = this->format_ids.emplace(&site, static_cast<uint16_t>(this->format_ids.size() + 1)).first;
+    }
+    auto const format_id = format_itr->second;
+    auto const domain_id = domain_info.id;
+
+    // Worst case, so that a rotation can't separate an entry from its definitions
+    auto const worst_case = 3 * MaxEntryHeaderSize + formatDefinitionSize(site, arg_types.size()) + domainDefinitionSize(domain) + args_size;
+    if (this->used + worst_case > this->file.size()) {
+        if (this->used > sizeof(FileHeader)) {
+            this->closeSegment();
+            this->openSegment();
+        }
+        if (this->used + worst_case > this->file.size())
+            this->file.resize(this->used + worst_case);
+    }
+    if (this->formats_defined.size() <= format_id)
+        this->formats_defined.resize(format_id + 1);
+    if (this->domains_defined.size() <= domain_id)
+        this->domains_defined.resize(domain_id + 1);
+
+    auto* const start = this->file.data().data() + this->used;
+    auto* p = start;
+    if (!this->formats_defined[format_id]) {
+        auto const size = formatDefinitionSize(site, arg_types.size());
+        auto const level = static_cast<uint8_t>(site.level);
+        auto const arg_count = static_cast<uint8_t>(arg_types.size());
+        p = putHeader(p, { 0, static_cast<uint64_t>(RecordKind::FormatDefinition), size });
+        p = putRaw(p, &format_id, sizeof(format_id));
+        p = putRaw(p, &level, sizeof(level));
+        p = putRaw(p, &arg_count, sizeof(arg_count));
+        p = putRaw(p, &site.line, sizeof(site.line));
+        p = putString(p, site.format);
+        p = putString(p, site.file);
+        p = putRaw(p, arg_types.data(), arg_types.size());
+        this->formats_defined[format_id] = true;
+    }
+    if (!this->domains_defined[domain_id]) {
+        auto const size = domainDefinitionSize(domain);
+        p = putHeader(p, { 0, static_cast<uint64_t>(RecordKind::DomainDefinition), size });
+        p = putRaw(p, &domain_id, sizeof(domain_id));
+        p = putString(p, domain);
+        this->domains_defined[domain_id] = true;
+    }
+
+    // Another thread can take the lock between its clock read and ours; clamp so deltas never go negative
+    now = std::max(now, this->last_timestamp);
+    auto const delta = std::chrono::duration_cast<std::chrono::nanoseconds>(now - this->last_timestamp).count();
+    this->last_timestamp = now;
+    p = putHeader(p, { format_id, domain_id, static_cast<uint64_t>(delta) });
+    auto const written = static_cast<size_t>(p - start) + args_size;
+    this->used += written;
+    this->total_bytes += written;
+    this->entries++;
+    return p;
+}
+
+void BinaryLogSink::openSegment()
+{
+    this->segment_filename = segmentFilename(this->base_filename, this->segment_index);
+    this->file = MappedFile::create(this->segment_filename, this->options.segment_size);
+    this->segments.push_back(this->segment_filename);
+    while (this->segments.size() > this->options.max_segments) {
+        std::error_code ec;
+        std::filesystem::remove(this->segments.front(), ec);
+        this->segments.erase(this->segments.begin());
+    }
+
+    auto const now_sys = std::chrono::system_clock::now();
+    this->last_timestamp = std::chrono::steady_clock::now();
+    FileHeader hdr{};
+    std::memcpy(hdr.magic, FileMagic, sizeof(FileMagic));
+    hdr.header_size = sizeof(FileHeader);
+    hdr.segment_index = static_cast<uint32_t>(this->segment_index);
+    hdr.start_unix_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now_sys.time_since_epoch()).count();
+    std::memcpy(this->file.data().data(), &hdr, sizeof(hdr));
+    this->used = sizeof(hdr);
+    this->total_bytes += sizeof(hdr);
+    this->formats_defined.assign(this->formats_defined.size(), false);
+    this->domains_defined.assign(this->domains_defined.size(), false);
+    this->segment_index++;
+}
+
+void BinaryLogSink::closeSegment()
+{
+    if (this->file.isOpen())
+        this->file.close(this->used);
+}
+
+std::filesystem::path BinaryLogSink::currentSegment() const
+{
+    auto const lock = std::scoped_lock(this->mutex);
+    return this->segment_filename;
+}
+
+size_t BinaryLogSink::segmentCount() const
+{
+    auto const lock = std::scoped_lock(this->mutex);
+    return this->segments.size();
+}
+
+uint64_t BinaryLogSink::entryCount() const
+{
+    auto const lock = std::scoped_lock(this->mutex);
+    return this->entries;
+}
+
+uint64_t BinaryLogSink::bytesWritten() const
+{
+    auto const lock = std::scoped_lock(this->mutex);
+    return this->total_bytes;
+}
+
+void BinaryLogSink::flush()
+{
+    auto const lock = std::scoped_lock(this->mutex);
+    this->file.flush();
+}
+
+void BinaryLogSink::close()
+{
+    auto const lock = std::scoped_lock(this->mutex);
+    this->closeSegment();
+    this->max_level.store(-1, std::memory_order_relaxed);
+}
+
+void setGlobalSink(std::unique_ptr<BinaryLogSink> sink)
+{
+    auto const lock = std::scoped_lock(global_sink_mutex);
+    auto* const previous = global_sink.exchange(sink.get(), std::memory_order_acq_rel);
+    // A BLOG_* call that loaded the old pointer may still be in its log(), so it is only closed: that finishes its last
+    // segment, and anything logged to it afterwards is dropped under its lock
+    if (previous)
+        previous->close();
+    if (sink)
+        global_sinks.push_back(std::move(sink));
+}
+
+BinaryLogSink* getGlobalSink()
+{
+    return global_sink.load(std::memory_order_acquire);
+}
+
+SegmentReader::SegmentReader(std::filesystem::path const& filename)
+{
+    auto const file = MappedFile::openRead(filename);
+    auto const bytes = file.data();
+    FileHeader hdr{};
+    if (bytes.size() < sizeof(hdr))
+        throw std::runtime_error(std::format("{} is too small to be a binary log segment", filename.string()));
+    std::memcpy(&hdr, bytes.data(), sizeof(hdr));
+    if (std::memcmp(hdr.magic, FileMagic, sizeof(FileMagic)) != 0)
+        throw std::runtime_error(std::format("{} is not a binary log segment (or is from an incompatible version)", filename.string()));
+    this->start_time = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(hdr.start_unix_ns)));
+
+    auto cursor = Cursor(bytes.subspan(hdr.header_size));
+    auto timestamp = this->start_time;
+    try {
+        while (!cursor.empty()) {
+            auto const eh = EntryHeader{ cursor.varint(), cursor.varint(), cursor.varint() };
+            if (eh.format_id == 0) {
+                switch (static_cast<RecordKind>(eh.domain_id)) {
+                case RecordKind::FormatDefinition: {
+                    auto def = std::make_unique<FormatDefinition>();
+                    auto const id = cursor.raw<uint16_t>();
+                    def->level = static_cast<YALF::LogLevel>(cursor.raw<uint8_t>());
+                    auto const arg_count = cursor.raw<uint8_t>();
+                    def->line = cursor.raw<uint32_t>();
+                    def->format = cursor.string();
+                    def->file = cursor.string();
+                    for (size_t i = 0; i < arg_count; i++)
+                        def->arg_types.push_back(static_cast<ArgType>(cursor.raw<uint8_t>()));
+                    this->formats[id] = std::move(def);
+                    break;
+                }
+                case RecordKind::DomainDefinition: {
+                    auto const id = cursor.raw<uint16_t>();
+                    this->domains[id] = std::make_unique<std::string>(cursor.string());
+                    break;
+                }
+                default:
+                    throw std::runtime_error(std::format("Unknown control record {}", eh.domain_id));
+                }
+                continue;
+            }
+
+            timestamp += std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(eh.delta_ns));
+            auto const format_itr = this->formats.find(eh.format_id);
+            auto const domain_itr = this->domains.find(eh.domain_id);
+            if (format_itr == this->formats.end() || domain_itr == this->domains.end())
+                throw std::runtime_error(std::format("Entry refers to undefined format {} or domain {}", eh.format_id, eh.domain_id));
+
+            auto entry = Entry{ timestamp, format_itr->second.get(), *domain_itr->second, {} };
+            entry.args.reserve(entry.format->arg_types.size());
+            for (auto const type : entry.format->arg_types) {
+                switch (type) {
+                case ArgType::Bool: entry.args.push_back({ cursor.raw<uint8_t>() != 0 }); break;
+                case ArgType::Char: entry.args.push_back({ cursor.raw<char>() }); break;
+                case ArgType::Signed: {
+                    auto const z = cursor.varint();
+                    entry.args.push_back({ static_cast<int64_t>((z >> 1) ^ (~(z & 1) + 1)) });
+                    break;
+                }
+                case ArgType::Unsigned: entry.args.push_back({ cursor.varint() }); break;
+                case ArgType::Double: entry.args.push_back({ cursor.raw<double>() }); break;
+                case ArgType::String: entry.args.push_back({ std::string{ cursor.string() } }); break;
+                case ArgType::Pointer: entry.args.push_back({ reinterpret_cast<void const*>(static_cast<uintptr_t>(cursor.varint())) }); break;
+                default: throw std::runtime_error(std::format("Unknown argument type {}", static_cast<int>(type)));
+                }
+            }
+            this->all_entries.push_back(std::move(entry));
+        }
+    }
+    catch (std::runtime_error const& ex) {
+        // A segment that was being written when the process died ends in zeroes or a partial entry
+        LOG_WARN("BinaryLog", "{}: {} at offset {}, ignoring the rest", filename.string(), ex.what(), hdr.header_size + cursor.position());
+    }
+}
+
+static
+std::string formatOne(DecodedArg const& arg, std::string_view spec)
+{
+    auto const fmt = std::format("{{:{}}}", spec);
+    try {
+        return std::visit([&](auto const& v) { return std::vformat(fmt, std::make_format_args(v)); }, arg.value);
+    }
+    catch (std::format_error const&) {
+        return std::format("{{?{}}}", spec);
+    }
+}
+
+static
+std::optional<int64_t> integerValue(DecodedArg const& arg)
+{
+    if (auto const* v = std::get_if<int64_t>(&arg.value)) return *v;
+    if (auto const* v = std::get_if<uint64_t>(&arg.value)) return static_cast<int64_t>(*v);
+    return std::nullopt;
+}
+
+std::string formatMessage(Entry const& entry)
+{
+    // std::format needs its arguments' types at compile time, so walk the replacement fields here and format each
+    // argument on its own; nested width/precision fields ("{:0{}x}") are substituted first, in std::format's order
+    auto const& fmt = entry.format->format;
+    auto const& args = entry.args;
+    size_t next_arg = 0;
+    auto const argAt = [&](std::string_view id) -> DecodedArg const* {
+        size_t index = next_arg;
+        if (id.empty())
+            next_arg++;
+        else
+            index = static_cast<size_t>(std::stoul(std::string{ id }));
+        return index < args.size() ? &args[index] : nullptr;
+    };
+
+    std::string out;
+    for (size_t i = 0; i < fmt.size(); i++) {
+        auto const c = fmt[i];
+        if (c == '}') {
+            out += c;
+            if (i + 1 < fmt.size() && fmt[i + 1] == '}')
+                i++;
+            continue;
+        }
+        if (c != '{') {
+            out += c;
+            continue;
+        }
+        if (i + 1 < fmt.size() && fmt[i + 1] == '{') {
+            out += '{';
+            i++;
+            continue;
+        }
+
+        size_t end = i + 1;
+        for (int depth = 1; end < fmt.size(); end++) {
+            if (fmt[end] == '{') depth++;
+            else if (fmt[end] == '}' && --depth == 0) break;
+        }
+        auto const field = std::string_view{ fmt }.substr(i + 1, end - i - 1);
+        i = end;
+        auto const colon = field.find(':');
+        auto const* const arg = argAt(field.substr(0, colon));
+        std::string spec;
+        if (colon != std::string_view::npos) {
+            auto const raw_spec = field.substr(colon + 1);
+            for (size_t j = 0; j < raw_spec.size(); j++) {
+                if (raw_spec[j] != '{') {
+                    spec += raw_spec[j];
+                    continue;
+                }
+                auto const close = raw_spec.find('}', j);
+                auto const* const nested = argAt(raw_spec.substr(j + 1, close - j - 1));
+                auto const value = nested ? integerValue(*nested) : std::nullopt;
+                spec += value ? std::to_string(value.value()) : "0";
+                j = close;
+            }
+        }
+        out += arg ? formatOne(*arg, spec) : "{?}";
+    }
+    return out;
+}
+
+std::vector<std::filesystem::path> findSegments(std::filesystem::path const& filename)
+{
+    auto const parent = filename.has_parent_path() ? filename.parent_path() : std::filesystem::path(".");
+    auto const stem = filename.stem().string();
+    auto const extension = filename.extension().string();
+    std::vector<std::pair<size_t, std::filesystem::path>> found;
+    std::error_code ec;
+    for (auto const& de : std::filesystem::directory_iterator(parent, ec)) {
+        auto const name = de.path().filename().string();
+        if (name.size() <= stem.size() + extension.size() + 1 || !name.starts_with(stem + ".") || !name.ends_with(extension))
+            continue;
+        auto const index = std::string_view{ name }.substr(stem.size() + 1, name.size() - stem.size() - 1 - extension.size());
+        if (index.empty() || !std::all_of(index.begin(), index.end(), [](char ch) { return ch >= '0' && ch <= '9'; }))
+            continue;
+        found.emplace_back(std::stoul(std::string{ index }), de.path());
+    }
+    std::sort(found.begin(), found.end());
+    std::vector<std::filesystem::path> rv;
+    for (auto& [index, path] : found)
+        rv.push_back(std::move(path));
+    return rv;
+}
+
+}
@@ -0,0 +1,331 @@
+#pragma once
+#include "MappedFile.h"
+#include <YALF/YALF.h>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+// Binary log: records the format string ID, domain ID, a timestamp and the raw arguments of each log call, and leaves
+// the formatting to the offline decoder (Tools/BinaryLogDump.cpp).
+// A segment is a small file header followed by back-to-back entries: format ID, domain ID and time delta as LEB128
+// (typically 3-4 bytes together), then the encoded arguments. Format strings (with file, line and argument types) and domain names are written once per segment as
+// definition records, so every segment decodes on its own. Segments are written through a memory mapping and rotated
+// when full; the oldest are deleted once there are more than max_segments.
+namespace RAP::BinaryLog {
+
+enum class ArgType : uint8_t
+{
+    Bool,
+    Char,
+    Signed,   // Zigzag LEB128
+    Unsigned, // LEB128
+    Double,   // 8 raw bytes
+    String,   // LEB128 length, then the bytes
+    Pointer,  // LEB128
+};
+
+// One per BLOG_* call site
+struct FormatSite
+{
+    std::string_view format;
+    std::string_view file;
+    uint32_t line;
+    YALF::LogLevel level;
+};
+
+struct SinkOptions
+{
+    size_t segment_size = 64 * 1024 * 1024;
+    size_t max_segments = 8;
+};
+
+namespace detail {
+    template <typename T>
+    using Decayed = std::remove_cvref_t<T>;
+
+    template <typename T>
+    concept StringLike = std::convertible_to<T const&, std::string_view>;
+
+    template <typename T>
+    constexpr ArgType argTypeOf()
+    {
+        using D = Decayed<T>;
+        if constexpr (std::same_as<D, bool>) return ArgType::Bool;
+        else if constexpr (std::same_as<D, char>) return ArgType::Char;
+        else if constexpr (std::signed_integral<D>) return ArgType::Signed;
+        else if constexpr (std::unsigned_integral<D>) return ArgType::Unsigned;
+        else if constexpr (std::floating_point<D>) return ArgType::Double;
+        else if constexpr (StringLike<D>) return ArgType::String;
+        else if constexpr (std::is_pointer_v<D>) return ArgType::Pointer;
+        else return ArgType::String; // Anything else is formatted with "{}" up front
+    }
+
+    constexpr size_t varintSize(uint64_t v)
+    {
+        return v < 0x80 ? 1 : (std::bit_width(v) + 6) / 7;
+    }
+    constexpr uint64_t zigzag(int64_t v)
+    {
+        return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    }
+    inline std::byte* putVarint(std::byte* p, uint64_t v)
+    {
+        while (v >= 0x80) {
+            *p++ = static_cast<std::byte>(v | 0x80);
+            v >>= 7;
+        }
+        *p++ = static_cast<std::byte>(v);
+        return p;
+    }
+
+    // Arguments that aren't stored raw are formatted once into one of these
+    struct Preformatted
+    {
+        std::string text;
+    };
+
+    template <typename T>
+    auto toEncodable(T const& v)
+    {
+        using D = Decayed<T>;
+        if constexpr (argTypeOf<T>() != ArgType::String || StringLike<D>)
+            return std::cref(v);
+        else
+            return Preformatted{ std::format("{}", v) };
+    }
+
+    template <typename T>
+    size_t encodedSize(T const& v)
+    {
+        using D = Decayed<T>;
+        if constexpr (std::same_as<D, Preformatted>) return varintSize(v.text.size()) + v.text.size();
+        else if constexpr (std::same_as<D, bool> || std::same_as<D, char>) return 1;
+        else if constexpr (std::signed_integral<D>) return varintSize(zigzag(static_cast<int64_t>(v)));
+        else if constexpr (std::unsigned_integral<D>) return varintSize(static_cast<uint64_t>(v));
+        else if constexpr (std::floating_point<D>) return sizeof(double);
+        else if constexpr (StringLike<D>) {
+            auto const sv = std::string_view{ v };
+            return varintSize(sv.size()) + sv.size();
+        }
+        else return varintSize(std::bit_cast<uintptr_t>(static_cast<void const*>(v)));
+    }
+
+    template <typename T>
+    std::byte* encode(std::byte* p, T const& v)
+    {
+        using D = Decayed<T>;
+        if constexpr (std::same_as<D, Preformatted>) {
+            p = putVarint(p, v.text.size());
+            std::memcpy(p, v.text.data(), v.text.size());
+            return p + v.text.size();
+        }
+        else if constexpr (std::same_as<D, bool> || std::same_as<D, char>) {
+            *p = static_cast<std::byte>(v);
+            return p + 1;
+        }
+        else if constexpr (std::signed_integral<D>) return putVarint(p, zigzag(static_cast<int64_t>(v)));
+        else if constexpr (std::unsigned_integral<D>) return putVarint(p, static_cast<uint64_t>(v));
+        else if constexpr (std::floating_point<D>) {
+            auto const d = static_cast<double>(v);
+            std::memcpy(p, &d, sizeof(d));
+            return p + sizeof(d);
+        }
+        else if constexpr (StringLike<D>) {
+            auto const sv = std::string_view{ v };
+            p = putVarint(p, sv.size());
+            std::memcpy(p, sv.data(), sv.size());
+            return p + sv.size();
+        }
+        else return putVarint(p, std::bit_cast<uintptr_t>(static_cast<void const*>(v)));
+    }
+
+    template <typename T>
+    decltype(auto) unwrap(T const& v)
+    {
+        if constexpr (std::same_as<T, Preformatted>)
+            return (v);
+        else
+            return v.get();
+    }
+
+    template <typename T>
+    concept HasDomain = requires(T const* t) { { t->getDomain() } -> std::convertible_to<std::string_view>; };
+}
+
+inline std::string_view domainOf(std::string_view domain) { return domain; }
+template <typename T> requires detail::HasDomain<T>
+std::string_view domainOf(T const* object) { return object->getDomain(); }
+
+class BinaryLogSink
+{
+public:
+    // Segments are named <stem>.<n><extension>, e.g. Logs/Demo_2024.pbin -> Logs/Demo_2024.0.pbin, Logs/Demo_2024.1.pbin, ...
+    explicit BinaryLogSink(std::filesystem::path const& filename, SinkOptions options = {});
+    ~BinaryLogSink();
+    BinaryLogSink(BinaryLogSink const&) = delete;
+    BinaryLogSink& operator=(BinaryLogSink const&) = delete;
+
+    void setDefaultLogLevel(YALF::LogLevel level);
+    void setDomainLogLevel(std::string_view domain, YALF::LogLevel level);
+    bool isEnabled(YALF::LogLevel level) const
+    {
+        return static_cast<int>(level) <= this->max_level.load(std::memory_order_relaxed);
+    }
+
+    template <typename... Args>
+    void log(FormatSite const& site, std::string_view domain, Args const&... args)
+    {
+        static constexpr ArgType arg_types[] = { detail::argTypeOf<Args>()..., ArgType::Bool };
+        auto const now = std::chrono::steady_clock::now();
+        auto const encodables = std::tuple{ detail::toEncodable(args)... };
+        auto const args_size = std::apply([](auto const&... e) { return (size_t{ 0 } + ... + detail::encodedSize(detail::unwrap(e))); }, encodables);
+
+        auto const lock = std::scoped_lock(this->mutex);
+        auto* p = this->beginEntry(site, std::span{ arg_types, sizeof...(Args) }, domain, now, args_size);
+        if (!p)
+            return;
+        std::apply([&](auto const&... e) { ((p = detail::encode(p, detail::unwrap(e))), ...); }, encodables);
+    }
+
+    std::filesystem::path currentSegment() const;
+    size_t segmentCount() const;
+    uint64_t entryCount() const;
+    uint64_t bytesWritten() const;
+    void flush();
+    // Finishes the current segment; log calls made after this are dropped
+    void close();
+
+private:
+    struct DomainInfo
+    {
+        uint16_t id;
+        std::optional<int> level;
+    };
+    struct StringHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+
+    // Returns where the arguments go, or nullptr if the domain is filtered out
+    std::byte* beginEntry(FormatSite const& site, std::span<ArgType const> arg_types, std::string_view domain, std::chrono::steady_clock::time_point now, size_t args_size);
+    std::byte* reserve(size_t n);
+    void openSegment();
+    void closeSegment();
+    void recomputeMaxLevel();
+
+    mutable std::mutex mutex;
+    std::filesystem::path base_filename;
+    SinkOptions options;
+    std::atomic<int> max_level;
+    int default_level;
+
+    MappedFile file;
+    std::filesystem::path segment_filename;
+    std::vector<std::filesystem::path> segments;
+    size_t segment_index = 0;
+    size_t used = 0;
+    std::chrono::steady_clock::time_point last_timestamp;
+
+    std::unordered_map<FormatSite const*, uint16_t> format_ids;
+    std::unordered_map<std::string, DomainInfo, StringHash, std::equal_to<>> domains;
+    std::vector<bool> formats_defined; // In the current segment, by ID
+    std::vector<bool> domains_defined;
+
+    uint64_t entries = 0;
+    uint64_t total_bytes = 0;
+};
+
+// The sink the BLOG_* macros record into, besides logging through YALF; nullptr stops the recording.
+// A sink that is replaced is closed but not destroyed until exit, since other threads may still be inside its log().
+void setGlobalSink(std::unique_ptr<BinaryLogSink> sink);
+BinaryLogSink* getGlobalSink();
+
+// ---- Reading ----
+
+struct DecodedArg
+{
+    std::variant<bool, char, int64_t, uint64_t, double, std::string, void const*> value;
+};
+
+struct FormatDefinition
+{
+    std::string format;
+    std::string file;
+    uint32_t line = 0;
+    YALF::LogLevel level{};
+    std::vector<ArgType> arg_types;
+};
+
+struct Entry
+{
+    std::chrono::system_clock::time_point timestamp;
+    FormatDefinition const* format;
+    std::string_view domain;
+    std::vector<DecodedArg> args;
+};
+
+class SegmentReader
+{
+public:
+    explicit SegmentReader(std::filesystem::path const& filename);
+
+    // Entries point into the reader's definitions and stay valid for its lifetime
+    std::vector<Entry> const& entries() const { return this->all_entries; }
+    std::chrono::system_clock::time_point startTime() const { return this->start_time; }
+
+private:
+    std::chrono::system_clock::time_point start_time;
+    std::unordered_map<uint16_t, std::unique_ptr<FormatDefinition>> formats;
+    std::unordered_map<uint16_t, std::unique_ptr<std::string>> domains;
+    std::vector<Entry> all_entries;
+};
+
+// Applies the entry's arguments to its format string, as the original LOG_* call would have
+std::string formatMessage(Entry const& entry);
+
+// All segments written for a given BinaryLogSink filename, oldest first
+std::vector<std::filesystem::path> findSegments(std::filesystem::path const& filename);
+
+}
+
+// Same shape as LOG_*: BLOG_NOISE(domain, "fmt {}", args...), where domain is a string or an object with getDomain().
+// It is always the LOG_* call, so the YALF Logger's sinks see it as before; with a global BinaryLogSink installed it is
+// also recorded raw, to be formatted offline. Each destination applies its own levels.
+// The domain and arguments are evaluated once, as a LOG_* call would, and both destinations get the same values.
+#define BLOG_GEN(level_, yalf_macro_, domain_, fmt_, ...) \
+    do { \
+        [&](auto const& blog_domain_ __VA_OPT__(, auto const&... blog_args_)) { \
+            if (auto* const blog_sink_ = ::RAP::BinaryLog::getGlobalSink()) { \
+                if (blog_sink_->isEnabled(level_)) { \
+                    static constexpr ::RAP::BinaryLog::FormatSite blog_site_{ fmt_, __FILE__, __LINE__, level_ }; \
+                    blog_sink_->log(blog_site_, ::RAP::BinaryLog::domainOf(blog_domain_) __VA_OPT__(, blog_args_...)); \
+                } \
+            } \
+            yalf_macro_(blog_domain_, fmt_ __VA_OPT__(, blog_args_...)); \
+        }(domain_ __VA_OPT__(,) __VA_ARGS__); \
+    } while (0)
+
+#define BLOG_ERROR(domain_, fmt_, ...) BLOG_GEN(::YALF::LogLevel::Error, LOG_ERROR, domain_, fmt_ __VA_OPT__(,) __VA_ARGS__)
+#define BLOG_WARN(domain_, fmt_, ...) BLOG_GEN(::YALF::LogLevel::Warning, LOG_WARN, domain_, fmt_ __VA_OPT__(,) __VA_ARGS__)
+#define BLOG_INFO(domain_, fmt_, ...) BLOG_GEN(::YALF::LogLevel::Info, LOG_INFO, domain_, fmt_ __VA_OPT__(,) __VA_ARGS__)
+#define BLOG_DEBUG(domain_, fmt_, ...) BLOG_GEN(::YALF::LogLevel::Debug, LOG_DEBUG, domain_, fmt_ __VA_OPT__(,) __VA_ARGS__)
+#define BLOG_NOISE(domain_, fmt_, ...) BLOG_GEN(::YALF::LogLevel::Noise, LOG_NOISE, domain_, fmt_ __VA_OPT__(,) __VA_ARGS__)
@@ -0,0 +1,171 @@
+#include "AdvDummyRegisterTarget.h"
+#include "BinaryLog.h"
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <string>
+
+using namespace RAP::BinaryLog;
+
+static
+std::vector<Entry> readAll(std::vector<std::unique_ptr<SegmentReader>>& readers, std::filesystem::path const& filename)
+{
+    std::vector<Entry> rv;
+    for (auto const& segment : findSegments(filename)) {
+        readers.push_back(std::make_unique<SegmentReader>(segment));
+        rv.insert(rv.end(), readers.back()->entries().begin(), readers.back()->entries().end());
+    }
+    return rv;
+}
+
+TEST_CASE("Binary log round trip", "[blog]")
+{
+    auto const dir = std::filesystem::temp_directory_path() / "RAP-cpp_blog_test";
+    std::filesystem::remove_all(dir);
+    auto const filename = dir / "roundtrip.pbin";
+
+    {
+        auto sink = std::make_unique<BinaryLogSink>(filename);
+        sink->setDefaultLogLevel(YALF::LogLevel::Noise);
+        sink->setDomainLogLevel("Quiet", YALF::LogLevel::Info);
+        setGlobalSink(std::move(sink));
+
+        BLOG_NOISE("Test", "write(0x{:0{}x}, 0x{:0{}x})", uint32_t{ 0x1234 }, sizeof(uint32_t) * 2, uint16_t{ 0xAB }, sizeof(uint16_t) * 2);
+        BLOG_INFO("Test", "{} {} {} {:.2f} {} {{literal}}", true, 'c', -5, 2.5, std::string{ "str" });
+        BLOG_NOISE("Quiet", "Filtered out by the domain level {}", 1);
+        BLOG_INFO("Quiet", "Kept by the domain level {}", 2);
+        BLOG_DEBUG("Test", "No arguments");
+
+        AdvDummyRegisterTarget<uint32_t, uint16_t> target("Blog Target");
+        target.write(0x10, 0x55);
+
+        auto* const retired = getGlobalSink();
+        CHECK(retired->entryCount() == 5);
+        setGlobalSink(nullptr);
+
+        // A thread that fetched the sink before it was replaced can still call it; the entry is dropped
+        static constexpr FormatSite late_site{ "Too late {}", __FILE__, __LINE__, YALF::LogLevel::Error };
+        retired->log(late_site, "Test", 3);
+        CHECK(retired->entryCount() == 5);
+    }
+
+    std::vector<std::unique_ptr<SegmentReader>> readers;
+    auto const entries = readAll(readers, filename);
+    REQUIRE(entries.size() == 5);
+    CHECK(formatMessage(entries[0]) == "write(0x00001234, 0x00ab)");
+    CHECK(entries[0].domain == "Test");
+    CHECK(entries[0].format->level == YALF::LogLevel::Noise);
+    CHECK(entries[0].format->file.ends_with("BinaryLogTests.cpp"));
+    CHECK(formatMessage(entries[1]) == "true c -5 2.50 str {literal}");
+    CHECK(formatMessage(entries[2]) == "Kept by the domain level 2");
+    CHECK(formatMessage(entries[3]) == "No arguments");
+    CHECK(entries[4].domain == "AdvDummyRegisterTarget");
+    CHECK(formatMessage(entries[4]) == "write(0x00000010, 0x0055)");
+    for (size_t i = 1; i < entries.size(); i++)
+        CHECK(entries[i - 1].timestamp <= entries[i].timestamp);
+
+    readers.clear();
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Binary log macros evaluate their arguments once", "[blog]")
+{
+    auto const dir = std::filesystem::temp_directory_path() / "RAP-cpp_blog_once_test";
+    std::filesystem::remove_all(dir);
+    auto const filename = dir / "once.pbin";
+
+    {
+        auto sink = std::make_unique<BinaryLogSink>(filename);
+        sink->setDefaultLogLevel(YALF::LogLevel::Noise);
+        setGlobalSink(std::move(sink));
+
+        int domain_calls = 0;
+        int value = 0;
+        auto const domain = [&] { domain_calls++; return "Test"; };
+        BLOG_INFO(domain(), "Value {}", ++value);
+        CHECK(domain_calls == 1);
+        CHECK(value == 1);
+        setGlobalSink(nullptr);
+    }
+
+    std::vector<std::unique_ptr<SegmentReader>> readers;
+    auto const entries = readAll(readers, filename);
+    REQUIRE(entries.size() == 1);
+    CHECK(formatMessage(entries[0]) == "Value 1");
+
+    readers.clear();
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Binary log rotation keeps every segment decodable", "[blog]")
+{
+    auto const dir = std::filesystem::temp_directory_path() / "RAP-cpp_blog_rotation_test";
+    std::filesystem::remove_all(dir);
+    auto const filename = dir / "rotation.pbin";
+    auto constexpr entry_count = 20000;
+
+    {
+        auto sink = BinaryLogSink(filename, SinkOptions{ .segment_size = 64 * 1024, .max_segments = 3 });
+        sink.setDefaultLogLevel(YALF::LogLevel::Noise);
+        static constexpr FormatSite site{ "entry {} of {}", __FILE__, __LINE__, YALF::LogLevel::Noise };
+        for (int i = 0; i < entry_count; i++)
+            sink.log(site, "Rotation", i, entry_count);
+        CHECK(sink.entryCount() == entry_count);
+        CHECK(sink.segmentCount() == 3);
+    }
+
+    auto const segments = findSegments(filename);
+    REQUIRE(segments.size() == 3);
+    int expected = -1;
+    for (auto const& segment : segments) {
+        auto const reader = SegmentReader(segment);
+        REQUIRE(!reader.entries().empty());
+        for (auto const& entry : reader.entries()) {
+            auto const message = formatMessage(entry);
+            if (expected < 0)
+                expected = std::stoi(message.substr(6));
+            CHECK(message == std::format("entry {} of {}", expected++, entry_count));
+        }
+    }
+    CHECK(expected == entry_count);
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Measure binary log size and cost against text formatting", "[Explore][blog]")
+{
+    auto const dir = std::filesystem::temp_directory_path() / "RAP-cpp_blog_explore";
+    std::filesystem::remove_all(dir);
+    auto constexpr entry_count = 1'000'000;
+    static constexpr FormatSite site{ "write(0x{:0{}x}, 0x{:0{}x})", __FILE__, __LINE__, YALF::LogLevel::Noise };
+
+    // Roughly what the FileSink writes for the same call with Config.txt's Format (%F is the full __FILE__ path)
+    size_t text_bytes = 0;
+    auto const text_start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < entry_count; i++) {
+        auto const now = std::chrono::system_clock::now();
+        auto const message = std::format("write(0x{:0{}x}, 0x{:0{}x})", i * 4, 8, static_cast<uint16_t>(i), 4);
+        auto const line = std::format("{:%y/%m/%d %H:%M:%S} {}:{} {}[{}] {}:  {}\n", now, __FILE__, __LINE__, "AdvDummyRegisterTarget", "Explore Target", "Noise", message);
+        text_bytes += line.size();
+    }
+    auto const text_elapsed = std::chrono::steady_clock::now() - text_start;
+
+    size_t binary_bytes = 0;
+    std::chrono::nanoseconds binary_elapsed{};
+    {
+        auto sink = BinaryLogSink(dir / "explore.pbin", SinkOptions{ .segment_size = 256 * 1024 * 1024, .max_segments = 2 });
+        sink.setDefaultLogLevel(YALF::LogLevel::Noise);
+        auto const binary_start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < entry_count; i++)
+            sink.log(site, "AdvDummyRegisterTarget", i * 4, size_t{ 8 }, static_cast<uint16_t>(i), size_t{ 4 });
+        binary_elapsed = std::chrono::steady_clock::now() - binary_start;
+        binary_bytes = sink.bytesWritten();
+    }
+
+    LOG_INFO("Explore", "Text:   {} bytes ({:.1f} B/entry), {:.1f} ns/entry (formatting only, no I/O)",
+        text_bytes, double(text_bytes) / entry_count, double(std::chrono::duration_cast<std::chrono::nanoseconds>(text_elapsed).count()) / entry_count);
+    LOG_INFO("Explore", "Binary: {} bytes ({:.1f} B/entry), {:.1f} ns/entry (including the mapped write); {:.1f}x smaller",
+        binary_bytes, double(binary_bytes) / entry_count, double(binary_elapsed.count()) / entry_count, double(text_bytes) / binary_bytes);
+    CHECK(binary_bytes * 5 < text_bytes);
+    std::filesystem::remove_all(dir);
+}
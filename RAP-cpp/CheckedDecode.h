@@ -0,0 +1,102 @@
+#pragma once
+#include <RAP/Serdes.h>
+#include "MessageSizes.h"
+#include "SerdesTypes.h"
+#include "WireFormat.h"
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace RAP::Serdes {
+
+enum class DecodeStatus : uint8_t
+{
+    Ok,
+    Empty,
+    Truncated, // Shorter than the smallest message this Cfg can encode
+    Oversized, // Longer than max_message_size
+    BadLength, // Its size disagrees with its type and count field
+    BadCrc,
+    Malformed, // Serdes rejected it (unknown type, field out of range, ...)
+};
+
+constexpr std::string_view toString(DecodeStatus status)
+{
+    switch (status) {
+    case DecodeStatus::Ok: return "Ok";
+    case DecodeStatus::Empty: return "Empty";
+    case DecodeStatus::Truncated: return "Truncated";
+    case DecodeStatus::Oversized: return "Oversized";
+    case DecodeStatus::BadLength: return "BadLength";
+    case DecodeStatus::BadCrc: return "BadCrc";
+    case DecodeStatus::Malformed: return "Malformed";
+    }
+    return "Unknown";
+}
+
+// Non-throwing front end to Serdes<Cfg>::decodeCommand/decodeResponse for receive paths that face untrusted input.
+// Frames that are empty, shorter than any message MessageSizes allows, or longer than max_message_size are rejected up
+// front without constructing an exception. So are frames whose size or CRC disagrees with the Cfg's FrameDefinition, where
+// it states one (see WireFormat.h). Serdes reports anything else by throwing, which is caught here and reported as Malformed.
+template <IsConfigurationType Cfg>
+class CheckedDecoder
+{
+public:
+    using BufferType = typename SerdesTypes<Cfg>::BufferType;
+    using CommandType = typename SerdesTypes<Cfg>::CommandType;
+    using ResponseType = typename SerdesTypes<Cfg>::ResponseType;
+
+    explicit CheckedDecoder(size_t max_message_size)
+        : serdes(max_message_size)
+        , max_message_size(max_message_size)
+    {}
+
+    DecodeStatus tryDecodeCommand(std::span<std::byte const> frame, CommandType& out) noexcept
+    {
+        return this->tryDecode(frame, minCommandSize(), WireFormat<Cfg>::expectedCommandSize(frame), [&](BufferType const& buf) { out = this->serdes.decodeCommand(buf); });
+    }
+    DecodeStatus tryDecodeResponse(std::span<std::byte const> frame, ResponseType& out) noexcept
+    {
+        return this->tryDecode(frame, minResponseSize(), WireFormat<Cfg>::expectedResponseSize(frame), [&](BufferType const& buf) { out = this->serdes.decodeResponse(buf); });
+    }
+
+    static constexpr size_t minCommandSize() { return MessageSizes<Cfg>::smallest_command; }
+    static constexpr size_t minResponseSize() { return MessageSizes<Cfg>::smallest_response; }
+    Serdes<Cfg>& getSerdes() { return this->serdes; }
+
+private:
+    using ElementType = typename BufferType::value_type;
+
+    template <typename Decode>
+    DecodeStatus tryDecode(std::span<std::byte const> frame, size_t min_size, std::optional<size_t> expected_size, Decode decode) noexcept
+    {
+        if (frame.empty())
+            return DecodeStatus::Empty;
+        if (frame.size() < min_size)
+            return DecodeStatus::Truncated;
+        if (frame.size() > this->max_message_size)
+            return DecodeStatus::Oversized;
+        if (expected_size && expected_size.value() != frame.size())
+            return DecodeStatus::BadLength;
+        if (!WireFormat<Cfg>::crcMatches(frame))
+            return DecodeStatus::BadCrc;
+        try {
+            auto const* const p = reinterpret_cast<ElementType const*>(frame.data());
+            this->scratch.assign(p, p + frame.size() / sizeof(ElementType));
+            decode(this->scratch);
+            return DecodeStatus::Ok;
+        }
+        catch (std::exception const&) {
+            return DecodeStatus::Malformed;
+        }
+    }
+
+    Serdes<Cfg> serdes;
+    size_t max_message_size;
+    BufferType scratch;
+};
+
+}
@@ -1,3 +1,5 @@
+#include "BinaryLog.h"
+#include "ThreadPlacement.h"
 #include <ACFP/ACFP.h>
 #include <YALF/YALF.h>
 #include <YALF/YALF_DeferredSink.h>
@@ -35,8 +37,11 @@ void configureLogger(ACFP::SectionGroup const& config_group, ACFP::SectionGroup
     };
 
     auto logger = std::make_unique<YALF::Logger>();
+    std::unique_ptr<RAP::BinaryLog::BinaryLogSink> binary_sink;
     auto addSink = [&](std::string_view name, std::unique_ptr<YALF::Sink> sink, bool defer) {
         if (defer) {
+            // The writer thread starts with the sink
+            auto const placement = RAP::Threads::ScopedPlacement(RAP::Threads::Role::Logger);
             auto deferred_sink = std::make_unique<YALF::DeferredSink>(std::move(sink));
             logger->addSink(std::string{ name }, std::move(deferred_sink));
         }
@@ -72,26 +77,35 @@ void configureLogger(ACFP::SectionGroup const& config_group, ACFP::SectionGroup
             addSink("FileSink", std::move(file_sink), ACFP::parse<bool>(getConfigValue("Deferred")).value_or(true));
         }
     }
-    #if 0
-    { // Configure PB File sink
+    { // Configure binary (PB) File sink. It captures BLOG_* call sites only; plain LOG_* traffic never reaches it
         auto getConfigValue = getConfigValueMaker(config_group, "PbFileSink");
         auto const enabled = ACFP::parse<bool>(getConfigValue("Enabled")).value_or(false);
         if (enabled) {
             auto const log_filename_template = getConfigValue("FilenameTemplate").value_or("Logs/TSW_{0:%Y.%m.%d_%H.%M.%S}.pbin");
             auto const now = std::chrono::system_clock::now();
             auto const log_filename = std::vformat(log_filename_template, std::make_format_args(now));
-            auto pbfile_sink = YALF::makePbFileSink(log_filename);
+            auto options = RAP::BinaryLog::SinkOptions{};
+            options.segment_size = ACFP::parse<size_t>(getConfigValue("SegmentSizeMiB")).value_or(options.segment_size >> 20) << 20;
+            options.max_segments = ACFP::parse<size_t>(getConfigValue("MaxSegments")).value_or(options.max_segments);
+            binary_sink = std::make_unique<RAP::BinaryLog::BinaryLogSink>(log_filename, options);
 
             if (auto default_log_level = getConfigValue("LogLevel"))
                 if (auto default_log_level_enum = YALF::parseLogLevelString(default_log_level.value()))
-                    pbfile_sink->setDefaultLogLevel(default_log_level_enum.value());
+                    binary_sink->setDefaultLogLevel(default_log_level_enum.value());
 
-            configureDomainLogLevels(dll_config_group["PbFileSink"], *pbfile_sink);
-
-            addSink("PbFileSink", std::move(pbfile_sink), ACFP::parse<bool>(getConfigValue("Deferred")).value_or(true));
+            dll_config_group["PbFileSink"].iterate([&](std::string_view domain, std::string_view level_str) {
+                if (auto const level_maybe = YALF::parseLogLevelString(level_str))
+                    binary_sink->setDomainLogLevel(domain, level_maybe.value());
+            });
         }
     }
-    #endif
 
     YALF::setGlobalLogger(std::move(logger));
+
+    // Not a YALF sink, which would only ever see formatted text: BLOG_* call sites record into it directly, on top of
+    // their usual LOG_* call through the Logger
+    if (binary_sink) {
+        LOG_INFO("BinaryLog", "Writing binary log to {}", binary_sink->currentSegment().string());
+        RAP::BinaryLog::setGlobalSink(std::move(binary_sink));
+    }
 }
@@ -0,0 +1,13 @@
+#include "RapMetrics.h"
+#include <YALF/YALF.h>
+#include <ACFP/ACFP.h>
+
+void configureMetrics(ACFP::Section const& config)
+{
+    auto const enabled = ACFP::parse<bool>(config["PeriodicDump"]).value_or(false);
+    if (!enabled)
+        return;
+
+    auto const interval_ms = ACFP::parse<unsigned>(config["DumpIntervalMs"]).value_or(10000);
+    RAP::Metrics::startPeriodicDump(std::chrono::milliseconds(interval_ms));
+}
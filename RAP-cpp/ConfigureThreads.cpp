@@ -0,0 +1,24 @@
+#include "ThreadPlacement.h"
+#include <ACFP/ACFP.h>
+#include <format>
+#include <stdexcept>
+
+// Runs before configureLogger, so the Logger role is in place when the deferred sinks start their threads; nothing
+// here may log.
+void configureThreads(ACFP::SectionGroup const& config_group)
+{
+    using namespace RAP::Threads;
+    for (size_t i = 0; i < RoleCount; i++) {
+        auto const role = static_cast<Role>(i);
+        auto const& section = config_group[getRoleString(role)];
+        Placement placement;
+        if (auto const cpus = section["Cpus"]) {
+            auto parsed = parseCpuList(cpus.value());
+            if (!parsed)
+                throw std::invalid_argument(std::format("[ThreadPlacement \"{}\"] Cpus = {} is not a CPU list like 0-3,8", getRoleString(role), cpus.value()));
+            placement.cpus = std::move(parsed.value());
+        }
+        placement.numa_node = ACFP::parse<unsigned>(section["NumaNode"]);
+        setPlacement(role, std::move(placement));
+    }
+}
@@ -0,0 +1,41 @@
+#include "DispatchArena.h"
+#include <YALF/YALF.h>
+
+namespace RAP::Memory {
+
+void* DispatchArena::CountingResource::do_allocate(size_t bytes, size_t alignment)
+{
+    this->allocations++;
+    this->bytes_since_reset += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void DispatchArena::CountingResource::do_deallocate(void* p, size_t bytes, size_t alignment)
+{
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+DispatchArena::DispatchArena(size_t initial_capacity)
+    : buffer(std::make_unique<std::byte[]>(initial_capacity))
+    , buffer_size(initial_capacity)
+{
+    this->monotonic.emplace(this->buffer.get(), this->buffer_size, &this->upstream);
+}
+
+void DispatchArena::reset()
+{
+    if (this->upstream.bytes_since_reset == 0) {
+        this->monotonic->release();
+        return;
+    }
+    // Overflowed: re-home on a buffer big enough for what this dispatch used
+    auto const new_size = this->buffer_size + this->upstream.bytes_since_reset;
+    LOG_DEBUG("DispatchArena", "Growing dispatch arena from {} to {} bytes", this->buffer_size, new_size);
+    this->monotonic.reset();
+    this->upstream.bytes_since_reset = 0;
+    this->buffer = std::make_unique<std::byte[]>(new_size);
+    this->buffer_size = new_size;
+    this->monotonic.emplace(this->buffer.get(), this->buffer_size, &this->upstream);
+}
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+namespace RAP::Memory {
+
+// Per-connection bump allocator for everything a single dispatch needs (one command, or one batch of them).
+// Allocation is a pointer bump into a buffer owned by the arena; reset() drops it all at once.
+// If a dispatch outgrows the buffer the overflow comes from the heap, and the next reset() grows the buffer to the high-water mark,
+// so after warm-up a connection stops touching the global heap (and its lock) entirely.
+// Not thread-safe: one arena per connection/thread. Containers using resource() must be gone before reset().
+// Only containers built on resource() live here; the vectors inside Serdes' decoded messages use std::allocator until Serdes takes one.
+class DispatchArena
+{
+public:
+    explicit DispatchArena(size_t initial_capacity = 64 * 1024);
+    DispatchArena(DispatchArena const&) = delete;
+    DispatchArena& operator=(DispatchArena const&) = delete;
+
+    std::pmr::memory_resource* resource() { return &this->monotonic.value(); }
+    void reset();
+
+    size_t capacity() const { return this->buffer_size; }
+    // Heap allocations made because a dispatch overflowed the buffer; stays flat in steady state
+    size_t upstreamAllocations() const { return this->upstream.allocations; }
+
+private:
+    // Forwards to the default resource, counting and sizing what goes past the buffer
+    struct CountingResource : std::pmr::memory_resource
+    {
+        size_t allocations = 0;
+        size_t bytes_since_reset = 0;
+
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override { return this == &other; }
+    };
+
+    CountingResource upstream;
+    std::unique_ptr<std::byte[]> buffer;
+    size_t buffer_size;
+    std::optional<std::pmr::monotonic_buffer_resource> monotonic;
+};
+
+}
@@ -0,0 +1,39 @@
+#include "DispatchArena.h"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <vector>
+
+TEST_CASE("Dispatch arena stops allocating after warm-up", "[memory]")
+{
+    RAP::Memory::DispatchArena arena(256);
+    auto const dispatch = [&](size_t words) {
+        auto data = std::pmr::vector<uint32_t>(arena.resource());
+        for (size_t i = 0; i < words; i++)
+            data.push_back(static_cast<uint32_t>(i));
+        CHECK(data.back() == words - 1);
+    };
+
+    SECTION("Fits in the initial buffer")
+    {
+        for (int i = 0; i < 100; i++) {
+            dispatch(16);
+            arena.reset();
+        }
+        CHECK(arena.upstreamAllocations() == 0);
+        CHECK(arena.capacity() == 256);
+    }
+
+    SECTION("Grows once to the high-water mark")
+    {
+        dispatch(1000);
+        arena.reset();
+        auto const after_warm_up = arena.upstreamAllocations();
+        CHECK(after_warm_up > 0);
+        CHECK(arena.capacity() > 256);
+        for (int i = 0; i < 100; i++) {
+            dispatch(1000);
+            arena.reset();
+        }
+        CHECK(arena.upstreamAllocations() == after_warm_up);
+    }
+}
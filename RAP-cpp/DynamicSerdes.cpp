@@ -0,0 +1,384 @@
+#include "DynamicSerdes.h"
+#include <YALF/YALF.h>
+#include <format>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace RAP::Serdes {
+
+namespace {
+
+template <uint8_t Bytes>
+using UintForBytes = std::conditional_t<(Bytes <= 1), uint8_t,
+                     std::conditional_t<(Bytes <= 2), uint16_t,
+                     std::conditional_t<(Bytes <= 4), uint32_t, uint64_t>>>;
+
+// Serdes configuration for one width shape, with every feature compiled in; DynamicSerdes gates features at runtime
+template <uint8_t A, uint8_t D, uint8_t L, uint8_t C>
+struct KernelCfg
+{
+    using AddressType = UintForBytes<A>;
+    static constexpr uint8_t AddressBits = A * 8;
+    static constexpr uint8_t AddressBytes = A;
+    using DataType = UintForBytes<D>;
+    static constexpr uint8_t DataBits = D * 8;
+    static constexpr uint8_t DataBytes = D;
+    using LengthType = UintForBytes<L>;
+    static constexpr uint8_t LengthBytes = L;
+    using CrcType = UintForBytes<C>;
+    static constexpr uint8_t CrcBytes = C;
+    static constexpr bool FeatureSequential = true;
+    static constexpr bool FeatureFifo = true;
+    static constexpr bool FeatureIncrement = true;
+    static constexpr bool FeatureCompressed = true;
+    static constexpr bool FeatureInterrupt = true;
+    static constexpr bool FeatureReadModifyWrite = true;
+};
+
+// The width shapes that get a precompiled kernel. Every Serdes<Cfg> instantiation DynamicSerdes costs is on this list;
+// add a line here to support a new device shape.
+using Kernels = std::tuple<
+    KernelCfg<1, 1, 1, 1>,
+    KernelCfg<3, 4, 2, 2>,
+    KernelCfg<4, 2, 1, 2>,
+    KernelCfg<6, 8, 2, 4>,
+    KernelCfg<8, 8, 4, 4>,
+    KernelCfg<ExampleRapCfg::AddressBytes, ExampleRapCfg::DataBytes, ExampleRapCfg::LengthBytes, ExampleRapCfg::CrcBytes>>;
+
+// Message structs are aggregates whose layout only differs between configurations in the integer widths,
+// so converting one is: take it apart with a structured binding, and aggregate-initialise the other from converted fields.
+struct AnyField
+{
+    template <typename T>
+    operator T&() const&&;
+};
+
+template <typename T>
+consteval size_t fieldCount()
+{
+    if constexpr (requires { T{ AnyField{}, AnyField{}, AnyField{}, AnyField{}, AnyField{}, AnyField{} }; })
+        return 6;
+    else if constexpr (requires { T{ AnyField{}, AnyField{}, AnyField{}, AnyField{}, AnyField{} }; })
+        return 5;
+    else if constexpr (requires { T{ AnyField{}, AnyField{}, AnyField{}, AnyField{} }; })
+        return 4;
+    else if constexpr (requires { T{ AnyField{}, AnyField{}, AnyField{} }; })
+        return 3;
+    else if constexpr (requires { T{ AnyField{}, AnyField{} }; })
+        return 2;
+    else
+        return 1;
+}
+
+template <typename T>
+struct IsVector : std::false_type {};
+template <typename T, typename A>
+struct IsVector<std::vector<T, A>> : std::true_type {};
+
+template <typename T>
+struct IsPair : std::false_type {};
+template <typename T, typename U>
+struct IsPair<std::pair<T, U>> : std::true_type {};
+
+template <typename To, typename From>
+To convertValue(From const& from)
+{
+    if constexpr (std::is_same_v<To, From>) {
+        return from;
+    }
+    else if constexpr (std::is_integral_v<To> && std::is_integral_v<From>) {
+        if (!std::in_range<To>(from))
+            throw std::out_of_range(std::format("Value 0x{:x} does not fit in the device's {}-byte field", from, sizeof(To)));
+        return static_cast<To>(from);
+    }
+    else if constexpr (IsVector<To>::value && IsVector<From>::value) {
+        To to;
+        to.reserve(from.size());
+        for (auto const& e : from)
+            to.push_back(convertValue<typename To::value_type>(e));
+        return to;
+    }
+    else if constexpr (IsPair<To>::value && IsPair<From>::value) {
+        return To{ convertValue<typename To::first_type>(from.first), convertValue<typename To::second_type>(from.second) };
+    }
+    else {
+        static_assert(!sizeof(To*), "Unhandled message field type");
+    }
+}
+
+// Converts to whatever field type it initialises
+template <typename From>
+struct FieldConverter
+{
+    From const& from;
+
+    template <typename To>
+    operator To() const { return convertValue<To>(this->from); }
+};
+
+template <typename From>
+FieldConverter<From> convertField(From const& from)
+{
+    return FieldConverter<From>{ from };
+}
+
+template <typename To, typename From>
+To convertMessage(From const& from)
+{
+    constexpr auto n = fieldCount<From>();
+    static_assert(n == fieldCount<To>());
+    if constexpr (n == 1) {
+        auto const& [a] = from;
+        return To{ convertField(a) };
+    }
+    else if constexpr (n == 2) {
+        auto const& [a, b] = from;
+        return To{ convertField(a), convertField(b) };
+    }
+    else if constexpr (n == 3) {
+        auto const& [a, b, c] = from;
+        return To{ convertField(a), convertField(b), convertField(c) };
+    }
+    else if constexpr (n == 4) {
+        auto const& [a, b, c, d] = from;
+        return To{ convertField(a), convertField(b), convertField(c), convertField(d) };
+    }
+    else if constexpr (n == 5) {
+        auto const& [a, b, c, d, e] = from;
+        return To{ convertField(a), convertField(b), convertField(c), convertField(d), convertField(e) };
+    }
+    else {
+        auto const& [a, b, c, d, e, f] = from;
+        return To{ convertField(a), convertField(b), convertField(c), convertField(d), convertField(e), convertField(f) };
+    }
+}
+
+template <typename T, typename Variant>
+struct VariantIndex;
+template <typename T, typename... Ts>
+struct VariantIndex<T, std::variant<Ts...>>
+{
+    static constexpr size_t value = [] {
+        size_t i = 0;
+        (void)((std::is_same_v<T, Ts> ? true : (i++, false)) || ...);
+        return i;
+    }();
+};
+
+// Both variants list the same message templates in the same order, just for different configurations
+template <typename ToVariant, typename FromVariant>
+ToVariant convertVariant(FromVariant const& from)
+{
+    return std::visit([](auto const& msg) -> ToVariant {
+        using FromMsg = std::remove_cvref_t<decltype(msg)>;
+        constexpr auto index = VariantIndex<FromMsg, FromVariant>::value;
+        return ToVariant(std::in_place_index<index>, convertMessage<std::variant_alternative_t<index, ToVariant>>(msg));
+    }, from);
+}
+
+template <typename K>
+class DynamicSerdesKernel final : public IDynamicSerdesKernel
+{
+public:
+    using CommandType = typename SerdesTypes<K>::CommandType;
+    using ResponseType = typename SerdesTypes<K>::ResponseType;
+    static_assert(std::is_same_v<typename SerdesTypes<K>::BufferType, DynamicBufferType>);
+    static_assert(std::variant_size_v<CommandType> == std::variant_size_v<DynamicCommand>);
+    static_assert(std::variant_size_v<ResponseType> == std::variant_size_v<DynamicResponse>);
+
+    explicit DynamicSerdesKernel(size_t max_message_size)
+        : serdes(max_message_size)
+    {}
+
+    virtual DynamicBufferType encodeCommand(DynamicCommand const& cmd) override
+    {
+        return this->serdes.encodeCommand(convertVariant<CommandType>(cmd));
+    }
+    virtual DynamicBufferType encodeResponse(DynamicResponse const& resp) override
+    {
+        return this->serdes.encodeResponse(convertVariant<ResponseType>(resp));
+    }
+    virtual DynamicCommand decodeCommand(DynamicBufferType const& buf) override
+    {
+        return convertVariant<DynamicCommand>(this->serdes.decodeCommand(buf));
+    }
+    virtual DynamicResponse decodeResponse(DynamicBufferType const& buf) override
+    {
+        return convertVariant<DynamicResponse>(this->serdes.decodeResponse(buf));
+    }
+    virtual size_t getMaxSeqReadCount() const override { return this->serdes.getMaxSeqReadCount(); }
+    virtual size_t getMaxSeqWriteCount() const override { return this->serdes.getMaxSeqWriteCount(); }
+    virtual size_t getMaxCompReadCount() const override { return this->serdes.getMaxCompReadCount(); }
+    virtual size_t getMaxCompWriteCount() const override { return this->serdes.getMaxCompWriteCount(); }
+
+private:
+    Serdes<K> serdes;
+};
+
+std::unique_ptr<IDynamicSerdesKernel> makeKernel(DynamicRapCfg const& cfg, size_t max_message_size)
+{
+    std::unique_ptr<IDynamicSerdesKernel> kernel;
+    [&]<typename... Ks>(std::tuple<Ks...>*) {
+        (void)(((Ks::AddressBytes == cfg.address_bytes && Ks::DataBytes == cfg.data_bytes && Ks::LengthBytes == cfg.length_bytes && Ks::CrcBytes == cfg.crc_bytes)
+            && (kernel = std::make_unique<DynamicSerdesKernel<Ks>>(max_message_size), true)) || ...);
+    }(static_cast<Kernels*>(nullptr));
+    return kernel;
+}
+
+uint8_t requireWidth(ACFP::Section const& config, std::string_view key, unsigned max)
+{
+    auto const value = ACFP::parse<unsigned>(config[key]);
+    if (!value.has_value())
+        throw std::runtime_error(std::format("DynamicRapCfg: '{}' is required", key));
+    if (value.value() < 1 || value.value() > max)
+        throw std::runtime_error(std::format("DynamicRapCfg: '{}' = {} is out of range [1, {}]", key, value.value(), max));
+    return static_cast<uint8_t>(value.value());
+}
+
+}
+
+DynamicRapCfg DynamicRapCfg::fromConfig(ACFP::Section const& config)
+{
+    DynamicRapCfg cfg;
+    cfg.address_bytes = requireWidth(config, "AddressBytes", 8);
+    cfg.address_bits = requireWidth(config, "AddressBits", cfg.address_bytes * 8u);
+    cfg.data_bytes = requireWidth(config, "DataBytes", 8);
+    cfg.data_bits = requireWidth(config, "DataBits", cfg.data_bytes * 8u);
+    cfg.length_bytes = requireWidth(config, "LengthBytes", 4);
+    cfg.crc_bytes = requireWidth(config, "CrcBytes", 4);
+    cfg.feature_sequential = ACFP::parse<bool>(config["FeatureSequential"]).value_or(false);
+    cfg.feature_fifo = ACFP::parse<bool>(config["FeatureFifo"]).value_or(false);
+    cfg.feature_increment = ACFP::parse<bool>(config["FeatureIncrement"]).value_or(false);
+    cfg.feature_compressed = ACFP::parse<bool>(config["FeatureCompressed"]).value_or(false);
+    cfg.feature_interrupt = ACFP::parse<bool>(config["FeatureInterrupt"]).value_or(false);
+    cfg.feature_read_modify_write = ACFP::parse<bool>(config["FeatureReadModifyWrite"]).value_or(false);
+    return cfg;
+}
+
+std::string DynamicRapCfg::toString() const
+{
+    return std::format("A{}/{}B D{}/{}B L{}B C{}B{}{}{}{}{}{}",
+        this->address_bits, this->address_bytes, this->data_bits, this->data_bytes, this->length_bytes, this->crc_bytes,
+        this->feature_sequential ? " Seq" : "", this->feature_fifo ? " Fifo" : "", this->feature_increment ? " Incr" : "",
+        this->feature_compressed ? " Comp" : "", this->feature_interrupt ? " Intr" : "", this->feature_read_modify_write ? " RMW" : "");
+}
+
+DynamicSerdes::DynamicSerdes(DynamicRapCfg const& cfg, size_t max_message_size)
+    : cfg(cfg)
+    , kernel(makeKernel(cfg, max_message_size))
+{
+    if (!this->kernel)
+        throw std::runtime_error(std::format("DynamicSerdes: no precompiled kernel for {}", cfg.toString()));
+    LOG_DEBUG("DynamicSerdes", "Using precompiled kernel for {}", cfg.toString());
+}
+
+DynamicBufferType DynamicSerdes::encodeCommand(DynamicCommand const& cmd)
+{
+    this->validate(cmd);
+    return this->kernel->encodeCommand(cmd);
+}
+
+DynamicBufferType DynamicSerdes::encodeResponse(DynamicResponse const& resp)
+{
+    this->validate(resp);
+    return this->kernel->encodeResponse(resp);
+}
+
+DynamicCommand DynamicSerdes::decodeCommand(DynamicBufferType const& buf)
+{
+    auto cmd = this->kernel->decodeCommand(buf);
+    this->validate(cmd);
+    return cmd;
+}
+
+DynamicResponse DynamicSerdes::decodeResponse(DynamicBufferType const& buf)
+{
+    auto resp = this->kernel->decodeResponse(buf);
+    this->validate(resp);
+    return resp;
+}
+
+static
+void requireFits(uint64_t value, uint8_t bits, std::string_view field)
+{
+    if (bits < 64 && (value >> bits) != 0)
+        throw std::out_of_range(std::format("DynamicSerdes: {} 0x{:x} does not fit in the device's {} bits", field, value, bits));
+}
+
+// The kernels only know byte widths; a device can use fewer bits than that (e.g. 24-bit addresses in 4 bytes)
+template <typename Message>
+static
+void checkBits(DynamicRapCfg const& cfg, Message const& m)
+{
+    if constexpr (requires { m.addr; })
+        requireFits(m.addr, cfg.address_bits, "address");
+    if constexpr (requires { m.start_addr; })
+        requireFits(m.start_addr, cfg.address_bits, "address");
+    if constexpr (requires { m.addresses; })
+        for (auto const addr : m.addresses)
+            requireFits(addr, cfg.address_bits, "address");
+    if constexpr (requires { m.addr_data; }) {
+        for (auto const& [addr, data] : m.addr_data) {
+            requireFits(addr, cfg.address_bits, "address");
+            requireFits(data, cfg.data_bits, "data");
+        }
+    }
+    if constexpr (requires { m.data.size(); }) {
+        for (auto const data : m.data)
+            requireFits(data, cfg.data_bits, "data");
+    }
+    else if constexpr (requires { m.data; }) {
+        requireFits(m.data, cfg.data_bits, "data");
+    }
+    if constexpr (requires { m.mask; })
+        requireFits(m.mask, cfg.data_bits, "mask");
+}
+
+static
+void requireFeature(bool enabled, std::string_view feature)
+{
+    if (!enabled)
+        throw std::runtime_error(std::format("DynamicSerdes: message needs {}, which this device does not support", feature));
+}
+
+void DynamicSerdes::validate(DynamicCommand const& cmd) const
+{
+    using W = DynamicWideCfg;
+    std::visit([&](auto const& c) {
+        using C = std::remove_cvref_t<decltype(c)>;
+        checkBits(this->cfg, c);
+        if constexpr (std::is_same_v<C, ReadSeqCommand<W>> || std::is_same_v<C, WriteSeqCommand<W>>) {
+            if (c.increment == 0)
+                requireFeature(this->cfg.feature_fifo, "FeatureFifo");
+            else if (c.increment == this->cfg.data_bytes)
+                requireFeature(this->cfg.feature_sequential, "FeatureSequential");
+            else
+                requireFeature(this->cfg.feature_increment, "FeatureIncrement");
+        }
+        else if constexpr (std::is_same_v<C, ReadCompCommand<W>> || std::is_same_v<C, WriteCompCommand<W>>) {
+            requireFeature(this->cfg.feature_compressed, "FeatureCompressed");
+        }
+        else if constexpr (std::is_same_v<C, ReadModifyWriteCommand<W>>) {
+            requireFeature(this->cfg.feature_read_modify_write, "FeatureReadModifyWrite");
+        }
+    }, cmd);
+}
+
+void DynamicSerdes::validate(DynamicResponse const& resp) const
+{
+    using W = DynamicWideCfg;
+    std::visit([&](auto const& r) {
+        using R = std::remove_cvref_t<decltype(r)>;
+        checkBits(this->cfg, r);
+        if constexpr (std::is_same_v<R, Interrupt<W>>)
+            requireFeature(this->cfg.feature_interrupt, "FeatureInterrupt");
+        else if constexpr (std::is_same_v<R, ReadmodifywriteSingleAckResponse<W>> || std::is_same_v<R, ReadmodifywriteSingleNakResponse<W>>)
+            requireFeature(this->cfg.feature_read_modify_write, "FeatureReadModifyWrite");
+    }, resp);
+}
+
+}
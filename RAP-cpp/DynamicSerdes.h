@@ -0,0 +1,125 @@
+#pragma once
+#include <RAP/Serdes.h>
+#include <ACFP/ACFP.h>
+#include "SerdesTypes.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace RAP::Serdes {
+
+// Wire configuration known only at runtime: the fields of an IsConfigurationType struct, as values
+struct DynamicRapCfg
+{
+    uint8_t address_bits = 32;
+    uint8_t address_bytes = 4;
+    uint8_t data_bits = 32;
+    uint8_t data_bytes = 4;
+    uint8_t length_bytes = 2;
+    uint8_t crc_bytes = 2;
+    bool feature_sequential = false;
+    bool feature_fifo = false;
+    bool feature_increment = false;
+    bool feature_compressed = false;
+    bool feature_interrupt = false;
+    bool feature_read_modify_write = false;
+
+    // Reads AddressBits, AddressBytes, DataBits, DataBytes, LengthBytes, CrcBytes and the Feature* flags (default false).
+    // Widths are required; throws std::runtime_error if any is missing or out of range.
+    static DynamicRapCfg fromConfig(ACFP::Section const& config);
+
+    template <IsConfigurationType Cfg>
+    static constexpr DynamicRapCfg from()
+    {
+        return DynamicRapCfg{
+            .address_bits = Cfg::AddressBits,
+            .address_bytes = Cfg::AddressBytes,
+            .data_bits = Cfg::DataBits,
+            .data_bytes = Cfg::DataBytes,
+            .length_bytes = Cfg::LengthBytes,
+            .crc_bytes = Cfg::CrcBytes,
+            .feature_sequential = Cfg::FeatureSequential,
+            .feature_fifo = Cfg::FeatureFifo,
+            .feature_increment = Cfg::FeatureIncrement,
+            .feature_compressed = Cfg::FeatureCompressed,
+            .feature_interrupt = Cfg::FeatureInterrupt,
+            .feature_read_modify_write = Cfg::FeatureReadModifyWrite,
+        };
+    }
+
+    std::string toString() const;
+};
+
+// The configuration DynamicSerdes messages are expressed in: every field at its widest, every feature on.
+// Values are narrowed (with range checks) to the device's real widths when encoding.
+struct DynamicWideCfg
+{
+    using AddressType = uint64_t;
+    static constexpr uint8_t AddressBits = 64;
+    static constexpr uint8_t AddressBytes = 8;
+    using DataType = uint64_t;
+    static constexpr uint8_t DataBits = 64;
+    static constexpr uint8_t DataBytes = 8;
+    using LengthType = uint32_t;
+    static constexpr uint8_t LengthBytes = 4;
+    using CrcType = uint32_t;
+    static constexpr uint8_t CrcBytes = 4;
+    static constexpr bool FeatureSequential = true;
+    static constexpr bool FeatureFifo = true;
+    static constexpr bool FeatureIncrement = true;
+    static constexpr bool FeatureCompressed = true;
+    static constexpr bool FeatureInterrupt = true;
+    static constexpr bool FeatureReadModifyWrite = true;
+};
+static_assert(IsConfigurationType<DynamicWideCfg>);
+
+using DynamicBufferType = typename SerdesTypes<DynamicWideCfg>::BufferType;
+using DynamicCommand = typename SerdesTypes<DynamicWideCfg>::CommandType;
+using DynamicResponse = typename SerdesTypes<DynamicWideCfg>::ResponseType;
+
+// One precompiled Serdes<Cfg> for a particular width shape; DynamicSerdes forwards to one of these
+class IDynamicSerdesKernel
+{
+public:
+    virtual ~IDynamicSerdesKernel() = default;
+    virtual DynamicBufferType encodeCommand(DynamicCommand const& cmd) = 0;
+    virtual DynamicBufferType encodeResponse(DynamicResponse const& resp) = 0;
+    virtual DynamicCommand decodeCommand(DynamicBufferType const& buf) = 0;
+    virtual DynamicResponse decodeResponse(DynamicBufferType const& buf) = 0;
+    virtual size_t getMaxSeqReadCount() const = 0;
+    virtual size_t getMaxSeqWriteCount() const = 0;
+    virtual size_t getMaxCompReadCount() const = 0;
+    virtual size_t getMaxCompWriteCount() const = 0;
+};
+
+// Serdes for a configuration read at startup (config file, capability register) instead of fixed at compile time.
+// Serdes<Cfg> is only instantiated for the width shapes listed in DynamicSerdes.cpp; a device whose
+// AddressBytes/DataBytes/LengthBytes/CrcBytes combination isn't there is rejected at construction.
+// Feature flags and AddressBits/DataBits are enforced here: messages the device could not carry are refused in both directions.
+class DynamicSerdes
+{
+public:
+    DynamicSerdes(DynamicRapCfg const& cfg, size_t max_message_size);
+
+    DynamicBufferType encodeCommand(DynamicCommand const& cmd);
+    DynamicBufferType encodeResponse(DynamicResponse const& resp);
+    DynamicCommand decodeCommand(DynamicBufferType const& buf);
+    DynamicResponse decodeResponse(DynamicBufferType const& buf);
+
+    size_t getMaxSeqReadCount() const { return this->kernel->getMaxSeqReadCount(); }
+    size_t getMaxSeqWriteCount() const { return this->kernel->getMaxSeqWriteCount(); }
+    size_t getMaxCompReadCount() const { return this->kernel->getMaxCompReadCount(); }
+    size_t getMaxCompWriteCount() const { return this->kernel->getMaxCompWriteCount(); }
+
+    DynamicRapCfg const& getCfg() const { return this->cfg; }
+
+private:
+    void validate(DynamicCommand const& cmd) const;
+    void validate(DynamicResponse const& resp) const;
+
+    DynamicRapCfg cfg;
+    std::unique_ptr<IDynamicSerdesKernel> kernel;
+};
+
+}
@@ -0,0 +1,150 @@
+#include <RAP/Serdes.h>
+#include "DynamicSerdes.h"
+#include "SerdesTestCfgs.h"
+#include <ACFP/ACFP.h>
+#include <catch2/catch_test_macros.hpp>
+
+template <RAP::IsConfigurationType Cfg>
+static
+void checkMatchesStatic()
+{
+    using W = RAP::Serdes::DynamicWideCfg;
+    auto serdes = RAP::Serdes::Serdes<Cfg>(256);
+    auto dynamic = RAP::Serdes::DynamicSerdes(RAP::Serdes::DynamicRapCfg::from<Cfg>(), 256);
+
+    auto const write_single = dynamic.encodeCommand(RAP::Serdes::WriteSingleCommand<W>{ .transaction_id = 3, .posted = false, .addr = 0x12, .data = 0x34 });
+    CHECK(write_single == serdes.encodeCommand(RAP::Serdes::WriteSingleCommand<Cfg>{ .transaction_id = 3, .posted = false, .addr = 0x12, .data = 0x34 }));
+    auto const decoded = dynamic.decodeCommand(write_single);
+    REQUIRE(std::holds_alternative<RAP::Serdes::WriteSingleCommand<W>>(decoded));
+    CHECK(std::get<RAP::Serdes::WriteSingleCommand<W>>(decoded).data == 0x34);
+
+    auto const write_comp = dynamic.encodeCommand(RAP::Serdes::WriteCompCommand<W>{ .transaction_id = 4, .posted = true, .addr_data = { { 0x10, 0x01 }, { 0x20, 0x02 } } });
+    CHECK(write_comp == serdes.encodeCommand(RAP::Serdes::WriteCompCommand<Cfg>{ .transaction_id = 4, .posted = true, .addr_data = { { 0x10, 0x01 }, { 0x20, 0x02 } } }));
+
+    auto const read_seq_ack = dynamic.encodeResponse(RAP::Serdes::ReadSeqAckResponse<W>{ .transaction_id = 5, .data = { 1, 2, 3 } });
+    CHECK(read_seq_ack == serdes.encodeResponse(RAP::Serdes::ReadSeqAckResponse<Cfg>{ .transaction_id = 5, .data = { 1, 2, 3 } }));
+    auto const decoded_ack = dynamic.decodeResponse(read_seq_ack);
+    REQUIRE(std::holds_alternative<RAP::Serdes::ReadSeqAckResponse<W>>(decoded_ack));
+    CHECK(std::get<RAP::Serdes::ReadSeqAckResponse<W>>(decoded_ack).data == std::vector<uint64_t>{ 1, 2, 3 });
+
+    CHECK(dynamic.getMaxSeqReadCount() == serdes.getMaxSeqReadCount());
+    CHECK(dynamic.getMaxCompWriteCount() == serdes.getMaxCompWriteCount());
+}
+
+TEST_CASE("DynamicSerdes matches Serdes<Cfg> on the wire", "[serdes][dynamic]")
+{
+    checkMatchesStatic<RAP::ExampleRapCfg>();
+    checkMatchesStatic<Rap_A24D32L2C2>();
+    checkMatchesStatic<Rap_A8D8L1C1>();
+    checkMatchesStatic<Rap_A48D64L2C4>();
+}
+
+// The same feature-gated commands in any configuration, so the wide and the device encodings can be compared
+template <RAP::IsConfigurationType C>
+static
+RAP::Serdes::ReadSeqCommand<C> readSeq(size_t increment)
+{
+    auto cmd = RAP::Serdes::ReadSeqCommand<C>{ .transaction_id = 6, .start_addr = 0x40, .count = 3 };
+    cmd.increment = static_cast<decltype(cmd.increment)>(increment);
+    return cmd;
+}
+
+template <RAP::IsConfigurationType C>
+static
+RAP::Serdes::WriteSeqCommand<C> writeSeq(size_t increment)
+{
+    auto cmd = RAP::Serdes::WriteSeqCommand<C>{ .transaction_id = 7, .posted = false, .start_addr = 0x48, .data = std::vector<typename C::DataType>{ 0x11, 0x22, 0x33 } };
+    cmd.increment = static_cast<decltype(cmd.increment)>(increment);
+    return cmd;
+}
+
+template <RAP::IsConfigurationType C>
+static
+RAP::Serdes::ReadModifyWriteCommand<C> readModifyWrite()
+{
+    return RAP::Serdes::ReadModifyWriteCommand<C>{ .transaction_id = 8, .posted = false, .addr = 0x50, .data = 0xA5, .mask = 0x0F };
+}
+
+// With the feature, DynamicSerdes has to produce Serdes<Cfg>'s bytes and decode them back.
+// Without it, it has to refuse the command both ways: encoding it, and decoding it from a device that has every feature.
+template <RAP::IsConfigurationType Cfg>
+static
+void checkGatedCommand(bool feature, RAP::Serdes::DynamicCommand const& wide, typename RAP::Serdes::SerdesTypes<Cfg>::CommandType const& narrow)
+{
+    auto serdes = RAP::Serdes::Serdes<Cfg>(256);
+    auto dynamic = RAP::Serdes::DynamicSerdes(RAP::Serdes::DynamicRapCfg::from<Cfg>(), 256);
+    if (feature) {
+        auto const buf = dynamic.encodeCommand(wide);
+        CHECK(buf == serdes.encodeCommand(narrow));
+        auto const decoded = dynamic.decodeCommand(buf);
+        CHECK(decoded.index() == wide.index());
+        CHECK(dynamic.encodeCommand(decoded) == buf);
+        return;
+    }
+    auto everything = RAP::Serdes::DynamicRapCfg::from<Cfg>();
+    everything.feature_sequential = everything.feature_fifo = everything.feature_increment = true;
+    everything.feature_compressed = everything.feature_interrupt = everything.feature_read_modify_write = true;
+    auto const buf = RAP::Serdes::DynamicSerdes(everything, 256).encodeCommand(wide);
+    CHECK_THROWS(dynamic.encodeCommand(wide));
+    CHECK_THROWS(dynamic.decodeCommand(buf));
+}
+
+template <RAP::IsConfigurationType Cfg>
+static
+void checkGatedCommandsMatchStatic()
+{
+    using W = RAP::Serdes::DynamicWideCfg;
+    constexpr size_t seq = Cfg::DataBytes;
+    constexpr size_t incr = 2 * Cfg::DataBytes;
+    checkGatedCommand<Cfg>(Cfg::FeatureSequential, readSeq<W>(seq), readSeq<Cfg>(seq));
+    checkGatedCommand<Cfg>(Cfg::FeatureSequential, writeSeq<W>(seq), writeSeq<Cfg>(seq));
+    checkGatedCommand<Cfg>(Cfg::FeatureFifo, readSeq<W>(0), readSeq<Cfg>(0));
+    checkGatedCommand<Cfg>(Cfg::FeatureFifo, writeSeq<W>(0), writeSeq<Cfg>(0));
+    checkGatedCommand<Cfg>(Cfg::FeatureIncrement, readSeq<W>(incr), readSeq<Cfg>(incr));
+    checkGatedCommand<Cfg>(Cfg::FeatureIncrement, writeSeq<W>(incr), writeSeq<Cfg>(incr));
+    checkGatedCommand<Cfg>(Cfg::FeatureReadModifyWrite, readModifyWrite<W>(), readModifyWrite<Cfg>());
+}
+
+TEST_CASE("DynamicSerdes matches Serdes<Cfg> on feature-gated commands", "[serdes][dynamic]")
+{
+    checkGatedCommandsMatchStatic<RAP::ExampleRapCfg>();
+    checkGatedCommandsMatchStatic<Rap_A24D32L2C2>();
+    checkGatedCommandsMatchStatic<Rap_A8D8L1C1>();
+    checkGatedCommandsMatchStatic<Rap_A48D64L2C4>();
+}
+
+TEST_CASE("DynamicSerdes enforces the runtime configuration", "[serdes][dynamic]")
+{
+    using W = RAP::Serdes::DynamicWideCfg;
+    auto cfg = RAP::Serdes::DynamicRapCfg::from<Rap_A24D32L2C2>();
+
+    SECTION("Addresses wider than AddressBits")
+    {
+        auto dynamic = RAP::Serdes::DynamicSerdes(cfg, 256);
+        CHECK_THROWS(dynamic.encodeCommand(RAP::Serdes::ReadSingleCommand<W>{ .transaction_id = 0, .addr = 0x1000000 }));
+        CHECK_NOTHROW(dynamic.encodeCommand(RAP::Serdes::ReadSingleCommand<W>{ .transaction_id = 0, .addr = 0xFFFFFF }));
+    }
+    SECTION("Disabled features")
+    {
+        cfg.feature_compressed = false;
+        auto dynamic = RAP::Serdes::DynamicSerdes(cfg, 256);
+        CHECK_THROWS(dynamic.encodeCommand(RAP::Serdes::ReadCompCommand<W>{ .transaction_id = 0, .addresses = { 0x10 } }));
+        CHECK_THROWS(dynamic.encodeCommand(RAP::Serdes::ReadModifyWriteCommand<W>{ .transaction_id = 0, .posted = false, .addr = 0x10, .data = 1, .mask = 1 }));
+    }
+    SECTION("Width shape without a kernel")
+    {
+        cfg.crc_bytes = 3;
+        CHECK_THROWS(RAP::Serdes::DynamicSerdes(cfg, 256));
+    }
+}
+
+TEST_CASE("DynamicSerdes from Config.txt", "[serdes][dynamic]")
+{
+    auto const config = ACFP::parseConfigFile("Config.txt");
+    auto const cfg = RAP::Serdes::DynamicRapCfg::fromConfig(config["RapDevice"][""]);
+    CHECK(cfg.address_bytes == 4);
+    CHECK(cfg.feature_sequential);
+    auto dynamic = RAP::Serdes::DynamicSerdes(cfg, 256);
+    auto const buf = dynamic.encodeCommand(RAP::Serdes::ReadSingleCommand<RAP::Serdes::DynamicWideCfg>{ .transaction_id = 1, .addr = 0x40 });
+    CHECK(std::holds_alternative<RAP::Serdes::ReadSingleCommand<RAP::Serdes::DynamicWideCfg>>(dynamic.decodeCommand(buf)));
+}
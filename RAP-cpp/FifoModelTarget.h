@@ -0,0 +1,232 @@
+#pragma once
+#include <RTF/RTF.h>
+#include <YALF/YALF.h>
+#include "BinaryLog.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+// Fixed-capacity single-lock ring buffer; push/pop move a whole span with at most two copies.
+template <typename T>
+class RingBuffer
+{
+public:
+    explicit RingBuffer(size_t capacity)
+        : storage(std::bit_ceil(std::max<size_t>(capacity, 1)))
+        , mask(this->storage.size() - 1)
+        , limit(capacity)
+    {}
+
+    size_t size() const { return static_cast<size_t>(this->tail - this->head); }
+    size_t capacity() const { return this->limit; }
+    size_t available() const { return this->limit - this->size(); }
+
+    // Returns how many elements fit; the rest are not enqueued
+    size_t push(std::span<T const> data)
+    {
+        auto const n = std::min(data.size(), this->available());
+        auto const start = static_cast<size_t>(this->tail & this->mask);
+        auto const first = std::min(n, this->storage.size() - start);
+        std::copy_n(data.begin(), first, this->storage.begin() + start);
+        std::copy_n(data.begin() + first, n - first, this->storage.begin());
+        this->tail += n;
+        return n;
+    }
+    // Returns how many elements were dequeued into the front of out
+    size_t pop(std::span<T> out)
+    {
+        auto const n = std::min(out.size(), this->size());
+        auto const start = static_cast<size_t>(this->head & this->mask);
+        auto const first = std::min(n, this->storage.size() - start);
+        std::copy_n(this->storage.begin() + start, first, out.begin());
+        std::copy_n(this->storage.begin(), n - first, out.begin() + first);
+        this->head += n;
+        return n;
+    }
+
+private:
+    std::vector<T> storage;
+    uint64_t head = 0;
+    uint64_t tail = 0;
+    uint64_t mask;
+    size_t limit;
+};
+
+// Models FIFO ports in front of another register target: addresses registered with addFifo() behave like a
+// hardware FIFO (fifoWrite enqueues the whole span at once, fifoRead dequeues, single write/read move one element),
+// and everything else is forwarded to the wrapped target unchanged.
+// A full FIFO drops what doesn't fit and an empty one reads as zero; both are counted, as a device's overflow and
+// underflow flags would be. The device side of each FIFO is devicePush/devicePop, which may be called from another thread.
+template <typename AddressType, typename DataType>
+class FifoModelTarget : public RTF::IRegisterTarget<AddressType, DataType>
+{
+public:
+    using TargetType = RTF::IRegisterTarget<AddressType, DataType>;
+
+    struct FifoStats
+    {
+        size_t occupancy = 0;
+        size_t capacity = 0;
+        uint64_t overflows = 0;  // Elements dropped because the FIFO was full
+        uint64_t underflows = 0; // Elements read while it was empty
+    };
+
+    explicit FifoModelTarget(std::shared_ptr<TargetType> target)
+        : RTF::IRegisterTarget<AddressType, DataType>(target->getName())
+        , target(std::move(target))
+    {}
+    virtual std::string_view getDomain() const override { return "FifoModelTarget"; }
+
+    void addFifo(AddressType fifo_addr, size_t capacity)
+    {
+        auto const lock = std::scoped_lock(this->mutex);
+        if (this->findFifo(fifo_addr))
+            throw std::invalid_argument(std::format("{}: a FIFO at 0x{:x} already exists", this->getName(), static_cast<uint64_t>(fifo_addr)));
+        this->fifos.push_back(std::make_unique<Fifo>(fifo_addr, capacity));
+    }
+
+    // Device side: what the host wrote, and data for the host to read
+    size_t devicePop(AddressType fifo_addr, std::span<DataType> out)
+    {
+        auto const lock = std::scoped_lock(this->mutex);
+        return this->getFifo(fifo_addr).ring.pop(out);
+    }
+    size_t devicePush(AddressType fifo_addr, std::span<DataType const> data)
+    {
+        auto const lock = std::scoped_lock(this->mutex);
+        return this->getFifo(fifo_addr).ring.push(data);
+    }
+    FifoStats getStats(AddressType fifo_addr) const
+    {
+        auto const lock = std::scoped_lock(this->mutex);
+        auto const& fifo = this->getFifo(fifo_addr);
+        return FifoStats{ fifo.ring.size(), fifo.ring.capacity(), fifo.overflows, fifo.underflows };
+    }
+
+    virtual void write(AddressType addr, DataType data) override
+    {
+        if (this->isFifo(addr))
+            this->fifoWrite(addr, std::span{ &data, 1 });
+        else
+            this->target->write(addr, data);
+    }
+    virtual DataType read(AddressType addr) override
+    {
+        if (!this->isFifo(addr))
+            return this->target->read(addr);
+        DataType rv{};
+        this->fifoRead(addr, std::span{ &rv, 1 });
+        return rv;
+    }
+    virtual void readModifyWrite(AddressType addr, DataType new_data, DataType mask) override
+    {
+        if (this->isFifo(addr))
+            throw std::invalid_argument(std::format("{}: readModifyWrite on FIFO 0x{:x}", this->getName(), static_cast<uint64_t>(addr)));
+        this->target->readModifyWrite(addr, new_data, mask);
+    }
+    virtual void seqWrite(AddressType start_addr, std::span<DataType const> data, size_t increment = sizeof(DataType)) override
+    {
+        this->target->seqWrite(start_addr, data, increment);
+    }
+    virtual void seqRead(AddressType start_addr, std::span<DataType> out_data, size_t increment = sizeof(DataType)) override
+    {
+        this->target->seqRead(start_addr, out_data, increment);
+    }
+    virtual void fifoWrite(AddressType fifo_addr, std::span<DataType const> data) override
+    {
+        BLOG_NOISE(this, "fifoWrite(0x{:0{}x}, {}..)", fifo_addr, sizeof(AddressType) * 2, data.size());
+        auto lock = std::unique_lock(this->mutex);
+        auto* const fifo = this->findFifo(fifo_addr);
+        if (!fifo) {
+            lock.unlock();
+            this->target->fifoWrite(fifo_addr, data);
+            return;
+        }
+        fifo->overflows += data.size() - fifo->ring.push(data);
+    }
+    virtual void fifoRead(AddressType fifo_addr, std::span<DataType> out_data) override
+    {
+        BLOG_NOISE(this, "fifo_read(0x{:0{}x}, {}..)", fifo_addr, sizeof(AddressType) * 2, out_data.size());
+        auto lock = std::unique_lock(this->mutex);
+        auto* const fifo = this->findFifo(fifo_addr);
+        if (!fifo) {
+            lock.unlock();
+            this->target->fifoRead(fifo_addr, out_data);
+            return;
+        }
+        auto const n = fifo->ring.pop(out_data);
+        std::fill(out_data.begin() + n, out_data.end(), DataType{});
+        fifo->underflows += out_data.size() - n;
+    }
+    // Runs of non-FIFO pairs are forwarded as one compWrite each; order across FIFO and non-FIFO pairs is kept
+    virtual void compWrite(std::span<std::pair<AddressType, DataType> const> addr_data) override
+    {
+        size_t run_start = 0;
+        for (size_t i = 0; i < addr_data.size(); i++) {
+            if (!this->isFifo(addr_data[i].first))
+                continue;
+            if (i > run_start)
+                this->target->compWrite(addr_data.subspan(run_start, i - run_start));
+            this->fifoWrite(addr_data[i].first, std::span{ &addr_data[i].second, 1 });
+            run_start = i + 1;
+        }
+        if (run_start < addr_data.size())
+            this->target->compWrite(addr_data.subspan(run_start));
+    }
+    virtual void compRead(std::span<AddressType const> const addresses, std::span<DataType> out_data) override
+    {
+        assert(addresses.size() == out_data.size());
+        size_t run_start = 0;
+        for (size_t i = 0; i < addresses.size(); i++) {
+            if (!this->isFifo(addresses[i]))
+                continue;
+            if (i > run_start)
+                this->target->compRead(addresses.subspan(run_start, i - run_start), out_data.subspan(run_start, i - run_start));
+            this->fifoRead(addresses[i], out_data.subspan(i, 1));
+            run_start = i + 1;
+        }
+        if (run_start < addresses.size())
+            this->target->compRead(addresses.subspan(run_start), out_data.subspan(run_start));
+    }
+
+private:
+    struct Fifo
+    {
+        Fifo(AddressType addr, size_t capacity) : addr(addr), ring(capacity) {}
+        AddressType addr;
+        RingBuffer<DataType> ring;
+        uint64_t overflows = 0;
+        uint64_t underflows = 0;
+    };
+
+    // A device has a handful of FIFOs, so a linear scan beats hashing
+    Fifo* findFifo(AddressType addr) const
+    {
+        for (auto const& fifo : this->fifos)
+            if (fifo->addr == addr)
+                return fifo.get();
+        return nullptr;
+    }
+    Fifo& getFifo(AddressType addr) const
+    {
+        if (auto* const fifo = this->findFifo(addr))
+            return *fifo;
+        throw std::invalid_argument(std::format("{}: no FIFO at 0x{:x}", this->getName(), static_cast<uint64_t>(addr)));
+    }
+    bool isFifo(AddressType addr) const
+    {
+        auto const lock = std::scoped_lock(this->mutex);
+        return this->findFifo(addr) != nullptr;
+    }
+
+    std::shared_ptr<TargetType> target;
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<Fifo>> fifos;
+};
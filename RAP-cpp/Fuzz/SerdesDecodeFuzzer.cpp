@@ -0,0 +1,83 @@
+// libFuzzer target for Serdes<Cfg>::decodeCommand / decodeResponse across every test configuration.
+// Not part of RAP-cpp.vcxproj (libFuzzer supplies its own main). Build with clang, e.g.
+//   clang++ -std=c++20 -g -O1 -fsanitize=fuzzer,address,undefined -I.. -I<RAP include dir> SerdesDecodeFuzzer.cpp <RAP sources> -o SerdesDecodeFuzzer
+// or with MSVC: cl /std:c++20 /fsanitize=fuzzer /fsanitize=address ...
+// The first input byte picks the configuration and whether the rest is decoded as a command or a response.
+#include <RAP/Serdes.h>
+#include "../CheckedDecode.h"
+#include "../SerdesTestCfgs.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+
+// SerdesTestCfgs.h declares these extern for the test target; this standalone binary provides its own
+template class RAP::Serdes::Serdes<RAP::ExampleRapCfg>;
+template class RAP::Serdes::Serdes<Rap_A24D32L2C2>;
+template class RAP::Serdes::Serdes<Rap_A8D8L1C1>;
+template class RAP::Serdes::Serdes<Rap_A48D64L2C4>;
+
+static constexpr size_t max_message_size = 4096;
+
+template <RAP::IsConfigurationType Cfg>
+static
+void fuzzOne(bool as_response, std::span<std::byte const> frame)
+{
+    static auto decoder = RAP::Serdes::CheckedDecoder<Cfg>(max_message_size);
+    auto& serdes = decoder.getSerdes();
+    using BufferType = typename RAP::Serdes::CheckedDecoder<Cfg>::BufferType;
+    using ElementType = typename BufferType::value_type;
+    auto const* const p = reinterpret_cast<ElementType const*>(frame.data());
+    auto const buf = BufferType(p, p + frame.size() / sizeof(ElementType));
+
+    // The throwing path may only throw std::exception-derived errors
+    bool threw = false;
+    BufferType reencoded;
+    try {
+        if (as_response)
+            reencoded = serdes.encodeResponse(serdes.decodeResponse(buf));
+        else
+            reencoded = serdes.encodeCommand(serdes.decodeCommand(buf));
+    }
+    catch (std::exception const&) {
+        threw = true;
+    }
+
+    // The non-throwing path must agree with it
+    RAP::Serdes::DecodeStatus status;
+    if (as_response) {
+        typename RAP::Serdes::CheckedDecoder<Cfg>::ResponseType out;
+        status = decoder.tryDecodeResponse(frame, out);
+    }
+    else {
+        typename RAP::Serdes::CheckedDecoder<Cfg>::CommandType out;
+        status = decoder.tryDecodeCommand(frame, out);
+    }
+    if (threw != (status != RAP::Serdes::DecodeStatus::Ok))
+        std::abort();
+    if (threw)
+        return;
+
+    // Anything accepted must re-encode to something that decodes to the same bytes again
+    auto const again = as_response
+        ? serdes.encodeResponse(serdes.decodeResponse(reencoded))
+        : serdes.encodeCommand(serdes.decodeCommand(reencoded));
+    if (again != reencoded)
+        std::abort();
+}
+
+extern "C" int LLVMFuzzerTestOneInput(uint8_t const* data, size_t size)
+{
+    if (size < 1)
+        return 0;
+    auto const selector = data[0];
+    auto const frame = std::as_bytes(std::span{ data + 1, size - 1 });
+    bool const as_response = (selector & 0x4) != 0;
+    switch (selector & 0x3) {
+    case 0: fuzzOne<RAP::ExampleRapCfg>(as_response, frame); break;
+    case 1: fuzzOne<Rap_A24D32L2C2>(as_response, frame); break;
+    case 2: fuzzOne<Rap_A8D8L1C1>(as_response, frame); break;
+    case 3: fuzzOne<Rap_A48D64L2C4>(as_response, frame); break;
+    }
+    return 0;
+}
@@ -0,0 +1,227 @@
+#pragma once
+#include <RAP/Serdes.h>
+#include <RTF/RTF.h>
+#include "MessageSizes.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace RAP::RTF {
+
+enum class RunKind : uint8_t
+{
+    Single, // ReadSingleCommand / WriteSingleCommand
+    Seq,    // ReadSeqCommand / WriteSeqCommand with a constant, non-zero increment
+    Fifo,   // ReadSeqCommand / WriteSeqCommand with increment 0: the same address over and over
+    Comp,   // ReadCompCommand / WriteCompCommand: an explicit address list
+};
+
+// One message's worth of a gather/scatter: elements [first, first + count) of the caller's address list
+template <typename AddressType>
+struct AccessRun
+{
+    RunKind kind;
+    size_t first;
+    size_t count;
+    AddressType start_addr;
+    size_t increment; // Seq only
+};
+
+// Splits an arbitrary address list into the runs that cost the fewest bytes on the wire, command plus response, one message per run.
+// Costs come from MessageSizes<Cfg>, so nothing is encoded to work them out;
+// runs are chosen by dynamic programming over the list, honouring the Cfg's features and Serdes' per-message count limits.
+// Element order is preserved, so targets with read side effects (FIFOs, clear-on-read) see the accesses in the order given.
+template <IsConfigurationType Cfg>
+class AccessPlanner
+{
+public:
+    using AddressType = typename Cfg::AddressType;
+    using DataType = typename Cfg::DataType;
+    using Plan = std::vector<AccessRun<AddressType>>;
+
+    // per_message_overhead is what each extra datagram costs below RAP (IPv4 + UDP headers by default)
+    explicit AccessPlanner(size_t max_message_size = 4096, size_t per_message_overhead = 28)
+    {
+        using Sizes = RAP::Serdes::MessageSizes<Cfg>;
+        auto const cost = [&](size_t command, size_t response, size_t per_item) { return WireCost{ command + response + per_message_overhead, per_item }; };
+
+        this->read_costs.single = cost(Sizes::read_single_command, Sizes::read_single_ack, 0);
+        this->write_costs.single = cost(Sizes::write_single_command, Sizes::write_ack, 0);
+        // Only the count limits depend on max_message_size, and Serdes is the authority on those
+        auto serdes = RAP::Serdes::Serdes<Cfg>(max_message_size);
+        if constexpr (Cfg::FeatureSequential || Cfg::FeatureFifo || Cfg::FeatureIncrement) {
+            this->read_costs.seq = cost(Sizes::read_seq_command, Sizes::readSeqAck(0), Sizes::data);
+            this->write_costs.seq = cost(Sizes::writeSeqCommand(0), Sizes::write_ack, Sizes::data);
+            this->read_costs.max_seq = serdes.getMaxSeqReadCount();
+            this->write_costs.max_seq = serdes.getMaxSeqWriteCount();
+        }
+        if constexpr (Cfg::FeatureCompressed) {
+            this->read_costs.comp = cost(Sizes::readCompCommand(0), Sizes::readCompAck(0), Sizes::address + Sizes::data);
+            this->write_costs.comp = cost(Sizes::writeCompCommand(0), Sizes::write_ack, Sizes::address + Sizes::data);
+            this->read_costs.max_comp = serdes.getMaxCompReadCount();
+            this->write_costs.max_comp = serdes.getMaxCompWriteCount();
+        }
+    }
+
+    Plan planReads(std::span<AddressType const> addresses) const
+    {
+        return plan(addresses.size(), [&](size_t i) { return addresses[i]; }, this->read_costs);
+    }
+    Plan planWrites(std::span<std::pair<AddressType, DataType> const> addr_data) const
+    {
+        return plan(addr_data.size(), [&](size_t i) { return addr_data[i].first; }, this->write_costs);
+    }
+
+    // Total modelled wire bytes of a plan
+    size_t readCost(Plan const& plan) const { return cost(plan, this->read_costs); }
+    size_t writeCost(Plan const& plan) const { return cost(plan, this->write_costs); }
+
+private:
+    struct WireCost
+    {
+        size_t fixed = 0;
+        size_t per_item = 0;
+        size_t of(size_t count) const { return this->fixed + (this->per_item * count); }
+    };
+    struct Costs
+    {
+        WireCost single;
+        WireCost seq; // Also FIFO
+        WireCost comp;
+        size_t max_seq = 0;
+        size_t max_comp = 0;
+    };
+
+    using IncrementType = decltype(Serdes::ReadSeqCommand<Cfg>{}.increment);
+    static constexpr size_t unreached = std::numeric_limits<size_t>::max();
+
+    static
+    bool canUseStride(AddressType stride)
+    {
+        if (stride == sizeof(DataType))
+            return Cfg::FeatureSequential;
+        return Cfg::FeatureIncrement && std::in_range<IncrementType>(stride);
+    }
+
+    static
+    size_t cost(Plan const& plan, Costs const& costs)
+    {
+        size_t total = 0;
+        for (auto const& run : plan) {
+            switch (run.kind) {
+            case RunKind::Single: total += costs.single.of(1); break;
+            case RunKind::Seq:
+            case RunKind::Fifo: total += costs.seq.of(run.count); break;
+            case RunKind::Comp: total += costs.comp.of(run.count); break;
+            }
+        }
+        return total;
+    }
+
+    template <typename AddressAt>
+    static
+    Plan plan(size_t n, AddressAt address_at, Costs const& costs)
+    {
+        struct Step
+        {
+            size_t cost = unreached;
+            size_t from = 0;
+            AccessRun<AddressType> run{};
+        };
+        // best[j]: cheapest way to cover elements [0, j)
+        std::vector<Step> best(n + 1);
+        best[0].cost = 0;
+        auto const relax = [&](size_t i, size_t count, size_t run_cost, RunKind kind, size_t increment) {
+            auto const total = best[i].cost + run_cost;
+            if (total < best[i + count].cost)
+                best[i + count] = { total, i, { kind, i, count, address_at(i), increment } };
+        };
+
+        for (size_t i = 0; i < n; i++) {
+            if (best[i].cost == unreached)
+                continue;
+            relax(i, 1, costs.single.of(1), RunKind::Single, 0);
+
+            if (Cfg::FeatureFifo) {
+                for (size_t count = 2; count <= costs.max_seq && i + count <= n && address_at(i + count - 1) == address_at(i); count++)
+                    relax(i, count, costs.seq.of(count), RunKind::Fifo, 0);
+            }
+            if (i + 1 < n && address_at(i + 1) > address_at(i)) {
+                auto const stride = static_cast<AddressType>(address_at(i + 1) - address_at(i));
+                if (canUseStride(stride)) {
+                    for (size_t count = 2; count <= costs.max_seq && i + count <= n; count++) {
+                        auto const prev = address_at(i + count - 2);
+                        auto const next = address_at(i + count - 1);
+                        if (next <= prev || static_cast<AddressType>(next - prev) != stride)
+                            break;
+                        relax(i, count, costs.seq.of(count), RunKind::Seq, stride);
+                    }
+                }
+            }
+            if (Cfg::FeatureCompressed) {
+                for (size_t count = 2; count <= costs.max_comp && i + count <= n; count++)
+                    relax(i, count, costs.comp.of(count), RunKind::Comp, 0);
+            }
+        }
+
+        Plan runs;
+        for (size_t j = n; j > 0; j = best[j].from)
+            runs.push_back(best[j].run);
+        std::reverse(runs.begin(), runs.end());
+        return runs;
+    }
+
+    Costs read_costs;
+    Costs write_costs;
+};
+
+// Reads addresses[i] into out_data[i] for an arbitrary address list, one target call per planned run
+template <IsConfigurationType Cfg>
+void gatherRead(::RTF::IRegisterTarget<typename Cfg::AddressType, typename Cfg::DataType>& target, AccessPlanner<Cfg> const& planner, std::span<typename Cfg::AddressType const> addresses, std::span<typename Cfg::DataType> out_data)
+{
+    if (addresses.size() != out_data.size())
+        throw std::invalid_argument("gatherRead: addresses and out_data must be the same size");
+    for (auto const& run : planner.planReads(addresses)) {
+        auto const out = out_data.subspan(run.first, run.count);
+        switch (run.kind) {
+        case RunKind::Single: out[0] = target.read(run.start_addr); break;
+        case RunKind::Seq: target.seqRead(run.start_addr, out, run.increment); break;
+        case RunKind::Fifo: target.fifoRead(run.start_addr, out); break;
+        case RunKind::Comp: target.compRead(addresses.subspan(run.first, run.count), out); break;
+        }
+    }
+}
+
+// Writes every (address, data) pair, in order, one target call per planned run
+template <IsConfigurationType Cfg>
+void scatterWrite(::RTF::IRegisterTarget<typename Cfg::AddressType, typename Cfg::DataType>& target, AccessPlanner<Cfg> const& planner, std::span<std::pair<typename Cfg::AddressType, typename Cfg::DataType> const> addr_data)
+{
+    std::vector<typename Cfg::DataType> data;
+    for (auto const& run : planner.planWrites(addr_data)) {
+        auto const pairs = addr_data.subspan(run.first, run.count);
+        switch (run.kind) {
+        case RunKind::Single:
+            target.write(run.start_addr, pairs[0].second);
+            break;
+        case RunKind::Seq:
+        case RunKind::Fifo:
+            data.clear();
+            for (auto const& ad : pairs)
+                data.push_back(ad.second);
+            if (run.kind == RunKind::Seq)
+                target.seqWrite(run.start_addr, data, run.increment);
+            else
+                target.fifoWrite(run.start_addr, data);
+            break;
+        case RunKind::Comp:
+            target.compWrite(pairs);
+            break;
+        }
+    }
+}
+
+}
@@ -0,0 +1,84 @@
+#include "AdvDummyRegisterTarget.h"
+#include "GatherScatter.h"
+#include "SerdesTestCfgs.h"
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("Access planner picks the cheapest run kinds", "[RRT][gather]")
+{
+    using CFG = Rap_A24D32L2C2; // Sequential, FIFO and Comp; no Increment
+    using RAP::RTF::RunKind;
+    auto const planner = RAP::RTF::AccessPlanner<CFG>(256);
+
+    SECTION("Contiguous words are one Seq run")
+    {
+        std::vector<CFG::AddressType> addresses;
+        for (CFG::AddressType i = 0; i < 16; i++)
+            addresses.push_back(0x100 + i * sizeof(CFG::DataType));
+        auto const plan = planner.planReads(addresses);
+        REQUIRE(plan.size() == 1);
+        CHECK(plan[0].kind == RunKind::Seq);
+        CHECK(plan[0].count == 16);
+        CHECK(plan[0].start_addr == 0x100);
+    }
+    SECTION("A repeated address is one FIFO run")
+    {
+        std::vector<CFG::AddressType> const addresses(8, 0x40);
+        auto const plan = planner.planReads(addresses);
+        REQUIRE(plan.size() == 1);
+        CHECK(plan[0].kind == RunKind::Fifo);
+        CHECK(plan[0].count == 8);
+    }
+    SECTION("Scattered addresses are one Comp run")
+    {
+        std::vector<CFG::AddressType> const addresses{ 0x10, 0x2000, 0x38, 0x9C, 0x1234 };
+        auto const plan = planner.planReads(addresses);
+        REQUIRE(plan.size() == 1);
+        CHECK(plan[0].kind == RunKind::Comp);
+        CHECK(planner.readCost(plan) < 5 * planner.readCost({ { RunKind::Single, 0, 1, 0x10, 0 } }));
+    }
+    SECTION("Strides other than one word need FeatureIncrement")
+    {
+        std::vector<CFG::AddressType> const addresses{ 0x0, 0x8, 0x10, 0x18 };
+        for (auto const& run : planner.planReads(addresses))
+            CHECK(run.kind != RunKind::Seq);
+    }
+    SECTION("Runs never exceed Serdes' per-message limits")
+    {
+        auto const max_seq = RAP::Serdes::Serdes<CFG>(256).getMaxSeqReadCount();
+        std::vector<CFG::AddressType> addresses;
+        for (CFG::AddressType i = 0; i < max_seq * 3; i++)
+            addresses.push_back(i * sizeof(CFG::DataType));
+        auto const plan = planner.planReads(addresses);
+        size_t covered = 0;
+        for (auto const& run : plan) {
+            CHECK(run.first == covered);
+            CHECK(run.count <= max_seq);
+            covered += run.count;
+        }
+        CHECK(covered == addresses.size());
+    }
+}
+
+TEST_CASE("Gather and scatter through a register target", "[RRT][gather]")
+{
+    using CFG = Rap_A24D32L2C2;
+    auto const planner = RAP::RTF::AccessPlanner<CFG>(256);
+    AdvDummyRegisterTarget<CFG::AddressType, CFG::DataType> target("Adv Dummy");
+
+    std::vector<std::pair<CFG::AddressType, CFG::DataType>> const addr_data{
+        { 0x00, 1 }, { 0x04, 2 }, { 0x08, 3 }, { 0x0C, 4 }, // Seq
+        { 0x80, 5 },                                       // Single or Comp
+        { 0x44, 6 }, { 0x200, 7 }, { 0x14, 8 },            // Comp
+    };
+    RAP::RTF::scatterWrite<CFG>(target, planner, addr_data);
+
+    std::vector<CFG::AddressType> addresses;
+    std::vector<CFG::DataType> expected;
+    for (auto it = addr_data.rbegin(); it != addr_data.rend(); ++it) {
+        addresses.push_back(it->first);
+        expected.push_back(it->second);
+    }
+    std::vector<CFG::DataType> out_data(addresses.size());
+    RAP::RTF::gatherRead<CFG>(target, planner, addresses, out_data);
+    CHECK(out_data == expected);
+}
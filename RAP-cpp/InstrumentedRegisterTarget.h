@@ -0,0 +1,80 @@
+#pragma once
+#include <RTF/RTF.h>
+#include "RapMetrics.h"
+#include <chrono>
+#include <memory>
+
+// Wraps the target behind a RapServerAdapter and records how long the device takes to service each command,
+// so server-side Device time can be told apart from the client's Wire time.
+template <typename AddressType, typename DataType>
+class InstrumentedRegisterTarget : public RTF::IRegisterTarget<AddressType, DataType>
+{
+public:
+    using TargetType = RTF::IRegisterTarget<AddressType, DataType>;
+
+    explicit InstrumentedRegisterTarget(std::shared_ptr<TargetType> target, RAP::Metrics::Side side = RAP::Metrics::Side::Server)
+        : RTF::IRegisterTarget<AddressType, DataType>(target->getName())
+        , target(std::move(target))
+        , side(side)
+    {}
+    virtual std::string_view getDomain() const override { return this->target->getDomain(); }
+
+    virtual void write(AddressType addr, DataType data) override
+    {
+        auto const t = this->time(RAP::Metrics::MessageKind::WriteSingle);
+        this->target->write(addr, data);
+    }
+    virtual DataType read(AddressType addr) override
+    {
+        auto const t = this->time(RAP::Metrics::MessageKind::ReadSingle);
+        return this->target->read(addr);
+    }
+    virtual void readModifyWrite(AddressType addr, DataType new_data, DataType mask) override
+    {
+        auto const t = this->time(RAP::Metrics::MessageKind::ReadModifyWrite);
+        this->target->readModifyWrite(addr, new_data, mask);
+    }
+    virtual void seqWrite(AddressType start_addr, std::span<DataType const> data, size_t increment = sizeof(DataType)) override
+    {
+        auto const t = this->time(RAP::Metrics::MessageKind::WriteSeq);
+        this->target->seqWrite(start_addr, data, increment);
+    }
+    virtual void seqRead(AddressType start_addr, std::span<DataType> out_data, size_t increment = sizeof(DataType)) override
+    {
+        auto const t = this->time(RAP::Metrics::MessageKind::ReadSeq);
+        this->target->seqRead(start_addr, out_data, increment);
+    }
+    virtual void fifoWrite(AddressType fifo_addr, std::span<DataType const> data) override
+    {
+        auto const t = this->time(RAP::Metrics::MessageKind::WriteSeq);
+        this->target->fifoWrite(fifo_addr, data);
+    }
+    virtual void fifoRead(AddressType fifo_addr, std::span<DataType> out_data) override
+    {
+        auto const t = this->time(RAP::Metrics::MessageKind::ReadSeq);
+        this->target->fifoRead(fifo_addr, out_data);
+    }
+    virtual void compWrite(std::span<std::pair<AddressType, DataType> const> addr_data) override
+    {
+        auto const t = this->time(RAP::Metrics::MessageKind::WriteComp);
+        this->target->compWrite(addr_data);
+    }
+    virtual void compRead(std::span<AddressType const> const addresses, std::span<DataType> out_data) override
+    {
+        auto const t = this->time(RAP::Metrics::MessageKind::ReadComp);
+        this->target->compRead(addresses, out_data);
+    }
+
+private:
+    struct ScopedTimer
+    {
+        RAP::Metrics::Side side;
+        RAP::Metrics::MessageKind kind;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        ~ScopedTimer() { RAP::Metrics::recordLatency(side, kind, RAP::Metrics::Phase::Device, std::chrono::steady_clock::now() - start); }
+    };
+    ScopedTimer time(RAP::Metrics::MessageKind kind) const { return ScopedTimer{ this->side, kind }; }
+
+    std::shared_ptr<TargetType> target;
+    RAP::Metrics::Side side;
+};
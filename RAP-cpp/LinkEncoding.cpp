@@ -0,0 +1,396 @@
+#include "LinkEncoding.h"
+#include <YALF/YALF.h>
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+namespace RAP::Transport {
+
+namespace {
+    enum class TokenKind : uint8_t
+    {
+        Literal = 0, // Byte count, then the bytes
+        Repeat = 1,  // Word count, then the word
+        Delta = 2,   // Word count, then the first word and the zigzag-varint difference between words
+    };
+    // A run token costs a varint, one word and (for Delta) a varint; shorter runs are cheaper as literals
+    constexpr size_t MinRunWords = 3;
+
+    void checkWordSize(LinkEncodingOptions const& options)
+    {
+        if (options.word_size == 0 || options.word_size > 8)
+            throw std::invalid_argument("Link encoding word size must be 1 to 8 bytes (the Cfg's DataBytes)");
+    }
+
+    uint64_t loadWord(std::byte const* p, size_t word_size)
+    {
+        uint64_t v = 0;
+        for (size_t i = 0; i < word_size; i++)
+            v |= std::to_integer<uint64_t>(p[i]) << (8 * i);
+        return v;
+    }
+    // The encoder loads a few words per input byte, so it is instantiated per word size to make each load one move
+    template <size_t WordSize>
+    uint64_t loadWord(std::byte const* p)
+    {
+        if constexpr (std::endian::native == std::endian::little) {
+            uint64_t v = 0;
+            std::memcpy(&v, p, WordSize);
+            return v;
+        } else {
+            return loadWord(p, WordSize);
+        }
+    }
+    void storeWord(std::byte* p, uint64_t v, size_t word_size)
+    {
+        for (size_t i = 0; i < word_size; i++)
+            p[i] = static_cast<std::byte>(v >> (8 * i));
+    }
+    uint64_t wordMask(size_t word_size)
+    {
+        return word_size >= 8 ? ~uint64_t{ 0 } : (uint64_t{ 1 } << (8 * word_size)) - 1;
+    }
+
+    // Writers stop at the end of out and report failure through ok
+    struct Writer
+    {
+        std::span<std::byte> out;
+        size_t pos = 0;
+        bool ok = true;
+
+        void put(std::byte b)
+        {
+            if (this->pos < this->out.size())
+                this->out[this->pos++] = b;
+            else
+                this->ok = false;
+        }
+        void put(std::byte const* p, size_t n)
+        {
+            if (n <= this->out.size() - this->pos) {
+                std::memcpy(this->out.data() + this->pos, p, n);
+                this->pos += n;
+            } else {
+                this->ok = false;
+            }
+        }
+        void putVarint(uint64_t v)
+        {
+            while (v >= 0x80) {
+                this->put(static_cast<std::byte>(v | 0x80));
+                v >>= 7;
+            }
+            this->put(static_cast<std::byte>(v));
+        }
+    };
+
+    std::optional<uint64_t> getVarint(std::span<std::byte const> in, size_t& pos)
+    {
+        uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+            auto const b = std::to_integer<uint64_t>(in[pos++]);
+            v |= (b & 0x7F) << shift;
+            if (!(b & 0x80))
+                return v;
+        }
+        return std::nullopt;
+    }
+    void putToken(Writer& out, TokenKind kind, uint64_t count)
+    {
+        out.putVarint((count << 2) | static_cast<uint64_t>(kind));
+    }
+
+    constexpr uint8_t capabilityBit(LinkEncoding encoding)
+    {
+        return static_cast<uint8_t>(1u << (static_cast<unsigned>(encoding) - 1));
+    }
+}
+
+template <size_t word_size>
+static
+std::optional<size_t> encodeWordRle(std::span<std::byte const> in, std::span<std::byte> out_span)
+{
+    auto out = Writer{ out_span };
+    auto const mask = wordMask(word_size);
+    auto const n = in.size();
+    auto const* const data = in.data();
+
+    size_t literal_start = 0;
+    auto const flushLiteral = [&](size_t end) {
+        if (end > literal_start) {
+            putToken(out, TokenKind::Literal, end - literal_start);
+            out.put(data + literal_start, end - literal_start);
+        }
+    };
+
+    size_t i = 0;
+    while (i + MinRunWords * word_size <= n) {
+        auto const w0 = loadWord<word_size>(data + i);
+        auto const w1 = loadWord<word_size>(data + i + word_size);
+        auto const delta = (w1 - w0) & mask;
+        size_t count = 2;
+        uint64_t prev = w1;
+        while (i + (count + 1) * word_size <= n) {
+            auto const w = loadWord<word_size>(data + i + count * word_size);
+            if (((w - prev) & mask) != delta)
+                break;
+            prev = w;
+            count++;
+        }
+        if (count < MinRunWords) {
+            i++;
+            continue;
+        }
+
+        flushLiteral(i);
+        auto const kind = delta == 0 ? TokenKind::Repeat : TokenKind::Delta;
+        putToken(out, kind, count);
+        out.put(data + i, word_size);
+        if (kind == TokenKind::Delta) {
+            // Store the difference sign-extended from the word width, so small negative steps stay small
+            auto const shift = 64 - 8 * word_size;
+            auto const signed_delta = static_cast<int64_t>(delta << shift) >> shift;
+            out.putVarint((static_cast<uint64_t>(signed_delta) << 1) ^ static_cast<uint64_t>(signed_delta >> 63));
+        }
+        i += count * word_size;
+        literal_start = i;
+        if (!out.ok)
+            return std::nullopt;
+    }
+    flushLiteral(n);
+    if (!out.ok)
+        return std::nullopt;
+    return out.pos;
+}
+
+std::optional<size_t> encodeWordRle(std::span<std::byte const> in, size_t word_size, std::span<std::byte> out)
+{
+    switch (word_size) {
+    case 1: return encodeWordRle<1>(in, out);
+    case 2: return encodeWordRle<2>(in, out);
+    case 3: return encodeWordRle<3>(in, out);
+    case 4: return encodeWordRle<4>(in, out);
+    case 5: return encodeWordRle<5>(in, out);
+    case 6: return encodeWordRle<6>(in, out);
+    case 7: return encodeWordRle<7>(in, out);
+    case 8: return encodeWordRle<8>(in, out);
+    default: throw std::invalid_argument("WordRle word size must be 1 to 8 bytes");
+    }
+}
+
+std::optional<size_t> decodeWordRle(std::span<std::byte const> in, size_t word_size, std::span<std::byte> out)
+{
+    if (word_size == 0 || word_size > 8)
+        return std::nullopt;
+    auto const mask = wordMask(word_size);
+    size_t pos = 0;
+    size_t written = 0;
+    while (pos < in.size()) {
+        auto const token = getVarint(in, pos);
+        if (!token)
+            return std::nullopt;
+        auto const kind = static_cast<TokenKind>(token.value() & 3);
+        auto const count = token.value() >> 2;
+        switch (kind) {
+        case TokenKind::Literal:
+            if (count > in.size() - pos || count > out.size() - written)
+                return std::nullopt;
+            std::memcpy(out.data() + written, in.data() + pos, count);
+            pos += count;
+            written += count;
+            break;
+        case TokenKind::Repeat:
+        case TokenKind::Delta: {
+            if (word_size > in.size() - pos || count > (out.size() - written) / word_size)
+                return std::nullopt;
+            auto word = loadWord(in.data() + pos, word_size);
+            pos += word_size;
+            uint64_t delta = 0;
+            if (kind == TokenKind::Delta) {
+                auto const z = getVarint(in, pos);
+                if (!z)
+                    return std::nullopt;
+                delta = ((z.value() >> 1) ^ (~(z.value() & 1) + 1)) & mask;
+            }
+            for (uint64_t k = 0; k < count; k++) {
+                storeWord(out.data() + written, word, word_size);
+                written += word_size;
+                word = (word + delta) & mask;
+            }
+            break;
+        }
+        default:
+            return std::nullopt;
+        }
+    }
+    return written;
+}
+
+uint8_t LinkEncodingOptions::capabilities() const
+{
+    return this->enable_word_rle ? capabilityBit(LinkEncoding::WordRle) : 0;
+}
+
+size_t encodeLinkFrame(std::span<std::byte const> message, uint8_t peer_capabilities, LinkEncodingOptions const& options, std::span<std::byte> out)
+{
+    assert(out.size() > message.size());
+    auto const capabilities = options.capabilities();
+    auto encoding = LinkEncoding::Raw;
+    size_t size = message.size();
+    // Only worth trying when even a single run could pay for itself
+    if ((capabilities & peer_capabilities & capabilityBit(LinkEncoding::WordRle)) && message.size() >= 4 * options.word_size) {
+        if (auto const encoded = encodeWordRle(message, options.word_size, out.subspan(1, message.size() - 1))) {
+            encoding = LinkEncoding::WordRle;
+            size = encoded.value();
+        }
+    }
+    if (encoding == LinkEncoding::Raw)
+        std::memcpy(out.data() + 1, message.data(), message.size());
+    out[0] = static_cast<std::byte>((capabilities << 4) | static_cast<uint8_t>(encoding));
+
+    if (auto const& stats = options.stats) {
+        stats->frames_sent.fetch_add(1, std::memory_order_relaxed);
+        stats->frames_encoded.fetch_add(encoding != LinkEncoding::Raw, std::memory_order_relaxed);
+        stats->message_bytes_sent.fetch_add(message.size(), std::memory_order_relaxed);
+        stats->wire_bytes_sent.fetch_add(size + 1, std::memory_order_relaxed);
+    }
+    return size + 1;
+}
+
+std::optional<size_t> decodeLinkFrame(std::span<std::byte const> frame, LinkEncodingOptions const& options, std::span<std::byte> out, uint8_t& peer_capabilities)
+{
+    auto const dropped = [&](std::string_view why) -> std::optional<size_t> {
+        LOG_DEBUG("LinkEncoding", "Dropping {} byte frame: {}", frame.size(), why);
+        if (options.stats)
+            options.stats->frames_dropped.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    };
+    if (frame.empty())
+        return dropped("empty");
+    auto const header = std::to_integer<uint8_t>(frame[0]);
+    auto const body = frame.subspan(1);
+    auto const encoding = static_cast<LinkEncoding>(header & 0x0F);
+    out = out.first(std::min(out.size(), options.max_message_size));
+    // Capabilities are only believed from frames that decode, so line noise can't switch encodings on
+    if (encoding == LinkEncoding::Raw) {
+        if (body.size() > out.size())
+            return dropped("too large");
+        std::memcpy(out.data(), body.data(), body.size());
+        peer_capabilities = header >> 4;
+        return body.size();
+    }
+    if (encoding != LinkEncoding::WordRle || !(options.capabilities() & capabilityBit(encoding)))
+        return dropped(std::format("encoding {} not enabled", header & 0x0F));
+    auto const size = decodeWordRle(body, options.word_size, out);
+    if (!size)
+        return dropped("malformed WordRle");
+    peer_capabilities = header >> 4;
+    return size;
+}
+
+class LinkEncodingTransport : public ITransport
+{
+public:
+    LinkEncodingTransport(std::unique_ptr<ITransport> next, LinkEncodingOptions options)
+        : ITransport()
+        , next(std::move(next))
+        , options(std::move(options))
+        , frame(this->options.max_message_size + 1)
+    {
+        checkWordSize(this->options);
+    }
+
+    virtual void send(std::span<std::byte const> buf) override
+    {
+        this->frame.resize(std::max(this->frame.size(), buf.size() + 1));
+        auto const size = encodeLinkFrame(buf, this->peer_capabilities, this->options, this->frame);
+        this->next->send(std::span{ this->frame }.first(size));
+    }
+
+    virtual std::vector<std::byte> recv() override
+    {
+        while (true) {
+            auto const received = this->next->recv();
+            // Handed on as is: an empty message is how next reports that nothing arrived
+            if (received.empty())
+                return received;
+            auto buf = std::vector<std::byte>(this->options.max_message_size);
+            if (auto const size = decodeLinkFrame(received, this->options, buf, this->peer_capabilities)) {
+                buf.resize(size.value());
+                return buf;
+            }
+        }
+    }
+
+    virtual void setTimeout(std::chrono::milliseconds timeout) override
+    {
+        this->next->setTimeout(timeout);
+    }
+
+private:
+    std::unique_ptr<ITransport> next;
+    LinkEncodingOptions options;
+    uint8_t peer_capabilities = 0; // Nothing until the peer has told us
+    std::vector<std::byte> frame;
+};
+
+std::unique_ptr<ITransport> makeLinkEncodingTransport(std::unique_ptr<ITransport> next, LinkEncodingOptions options)
+{
+    return std::make_unique<LinkEncodingTransport>(std::move(next), std::move(options));
+}
+
+class LinkEncodingAsyncTransport : public IAsyncTransport
+{
+public:
+    LinkEncodingAsyncTransport(std::unique_ptr<IAsyncTransport> next, LinkEncodingOptions options)
+        : IAsyncTransport()
+        , next(std::move(next))
+        , options(std::move(options))
+        , rx(this->options.max_message_size + 1)
+    {
+        checkWordSize(this->options);
+    }
+
+    virtual asio::any_io_executor getExecutor() override
+    {
+        return this->next->getExecutor();
+    }
+
+    virtual asio::awaitable<void> sendAsync(std::span<std::byte const> buf) override
+    {
+        // Per call rather than a member: several coroutines may have sends in flight on this transport
+        auto frame = std::vector<std::byte>(buf.size() + 1);
+        auto const size = encodeLinkFrame(buf, this->peer_capabilities, this->options, frame);
+        co_await this->next->sendAsync(std::span{ frame }.first(size));
+    }
+
+    virtual asio::awaitable<size_t> recvAsync(std::span<std::byte> buf) override
+    {
+        while (true) {
+            auto const n = co_await this->next->recvAsync(this->rx);
+            if (auto const size = decodeLinkFrame(std::span{ this->rx }.first(n), this->options, buf, this->peer_capabilities))
+                co_return size.value();
+        }
+    }
+
+    virtual void close() override
+    {
+        this->next->close();
+    }
+
+private:
+    std::unique_ptr<IAsyncTransport> next;
+    LinkEncodingOptions options;
+    uint8_t peer_capabilities = 0; // Nothing until the peer has told us
+    std::vector<std::byte> rx;
+};
+
+std::unique_ptr<IAsyncTransport> makeLinkEncodingAsyncTransport(std::unique_ptr<IAsyncTransport> next, LinkEncodingOptions options)
+{
+    return std::make_unique<LinkEncodingAsyncTransport>(std::move(next), std::move(options));
+}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <RAP/RegisterTarget.h>
+#include "AsyncTransports.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+// Optional link-level payload encoding for RAP messages.
+// Each frame on the wire gets a one-byte link header: the low nibble is the encoding used for this frame and the high
+// nibble is the set of encodings the sender can decode. A side only encodes once it has seen its peer advertise the
+// encoding, so the first frames go raw and the link settles on the best encoding both ends support without a handshake
+// (and without any handshake state to lose on a UDP link). Frames are only encoded when that makes them smaller.
+// Both ends must use the link header; a peer that only ever sends raw frames just advertises nothing.
+namespace RAP::Transport {
+
+enum class LinkEncoding : uint8_t
+{
+    Raw = 0,
+    // Runs of repeated words and of words with a constant (little-endian) difference, found at any byte offset,
+    // between literal byte spans. Suits zero-filled or patterned memory dumps and FIFO loads.
+    WordRle = 1,
+};
+
+struct LinkEncodingStats
+{
+    std::atomic<uint64_t> frames_sent{ 0 };
+    std::atomic<uint64_t> frames_encoded{ 0 }; // Sent with something other than Raw
+    std::atomic<uint64_t> message_bytes_sent{ 0 };
+    std::atomic<uint64_t> wire_bytes_sent{ 0 }; // Including the link header
+    std::atomic<uint64_t> frames_dropped{ 0 };  // Received frames that failed to decode
+};
+
+struct LinkEncodingOptions
+{
+    // Both ends must agree; normally the Cfg's DataBytes. BatchingServerAdapter fills it in from its Cfg when left at 0,
+    // the transports below require it.
+    size_t word_size = 0;
+    bool enable_word_rle = true;
+    size_t max_message_size = 4096;
+    std::shared_ptr<LinkEncodingStats> stats;
+
+    // Encodings this side can decode, as advertised in the link header
+    uint8_t capabilities() const;
+};
+
+// Encodes in into out; std::nullopt (leaving out partly written) as soon as the encoding doesn't fit in out.
+// Pass an out smaller than in to only accept an encoding that wins.
+std::optional<size_t> encodeWordRle(std::span<std::byte const> in, size_t word_size, std::span<std::byte> out);
+// Decodes into out; std::nullopt if the input is malformed or decodes to more than out.size() bytes
+std::optional<size_t> decodeWordRle(std::span<std::byte const> in, size_t word_size, std::span<std::byte> out);
+
+// Writes message as a link frame into out, which must hold message.size() + 1 bytes, using the best encoding both
+// this side and peer_capabilities support; returns the frame size
+size_t encodeLinkFrame(std::span<std::byte const> message, uint8_t peer_capabilities, LinkEncodingOptions const& options, std::span<std::byte> out);
+// Decodes a link frame into out and records the capabilities the peer advertised in it.
+// std::nullopt (counted in frames_dropped) if the frame is empty, uses an encoding this side doesn't decode, or is malformed.
+std::optional<size_t> decodeLinkFrame(std::span<std::byte const> frame, LinkEncodingOptions const& options, std::span<std::byte> out, uint8_t& peer_capabilities);
+
+// Frame everything sent and received over next; both ends of the link must use link framing
+std::unique_ptr<ITransport> makeLinkEncodingTransport(std::unique_ptr<ITransport> next, LinkEncodingOptions options);
+std::unique_ptr<IAsyncTransport> makeLinkEncodingAsyncTransport(std::unique_ptr<IAsyncTransport> next, LinkEncodingOptions options);
+
+}
@@ -0,0 +1,244 @@
+#include <RAP/Serdes.h>
+#include <RAP/ServerAdapter.h>
+#include "AdvDummyRegisterTarget.h"
+#include "AsyncRegisterTarget.h"
+#include "BatchingServerAdapter.h"
+#include "LinkEncoding.h"
+#include "SerdesTestCfgs.h"
+#include <YALF/YALF.h>
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <numeric>
+#include <random>
+
+using namespace RAP::Transport;
+
+static
+std::vector<std::byte> roundTrip(std::vector<std::byte> const& in, size_t word_size, size_t& encoded_size)
+{
+    std::vector<std::byte> encoded(in.size());
+    auto const size = encodeWordRle(in, word_size, encoded);
+    REQUIRE(size.has_value());
+    encoded_size = size.value();
+    std::vector<std::byte> decoded(in.size());
+    auto const decoded_size = decodeWordRle(std::span{ encoded }.first(encoded_size), word_size, decoded);
+    REQUIRE(decoded_size == in.size());
+    return decoded;
+}
+
+template <typename T>
+static
+std::vector<std::byte> toBytes(std::vector<T> const& words)
+{
+    auto const bytes = std::as_bytes(std::span{ words });
+    return { bytes.begin(), bytes.end() };
+}
+
+TEST_CASE("WordRle codec", "[link]")
+{
+    size_t encoded_size = 0;
+
+    SECTION("Zero-filled dump collapses to a few bytes")
+    {
+        auto const in = std::vector<std::byte>(4000);
+        CHECK(roundTrip(in, 4, encoded_size) == in);
+        CHECK(encoded_size < 10);
+    }
+    SECTION("Ramps and negative steps, wrapping at the word width")
+    {
+        std::vector<uint16_t> words(500);
+        std::iota(words.begin(), words.end(), uint16_t{ 0xFF00 });
+        for (size_t i = 0; i < 200; i++)
+            words.push_back(static_cast<uint16_t>(0x10 - 3 * i));
+        auto const in = toBytes(words);
+        CHECK(roundTrip(in, 2, encoded_size) == in);
+        CHECK(encoded_size < 16);
+    }
+    SECTION("Runs found at any byte offset between literals")
+    {
+        // A 3-byte header misaligns everything after it, as the fields in front of a WriteSeq payload do
+        std::vector<std::byte> in{ std::byte{ 1 }, std::byte{ 2 }, std::byte{ 3 } };
+        auto const pattern = toBytes(std::vector<uint32_t>(100, 0xDEADBEEF));
+        in.insert(in.end(), pattern.begin(), pattern.end());
+        in.push_back(std::byte{ 9 });
+        CHECK(roundTrip(in, 4, encoded_size) == in);
+        CHECK(encoded_size < 20);
+    }
+    SECTION("Incompressible input doesn't fit in less than its own size")
+    {
+        auto rng = std::mt19937(7);
+        std::vector<std::byte> in(1000);
+        for (auto& b : in)
+            b = static_cast<std::byte>(rng());
+        std::vector<std::byte> encoded(in.size() - 1);
+        CHECK(!encodeWordRle(in, 4, encoded).has_value());
+    }
+    SECTION("Malformed or oversized input is rejected, never overrun")
+    {
+        auto const in = std::vector<std::byte>(256);
+        std::vector<std::byte> encoded(in.size());
+        auto const size = encodeWordRle(in, 4, encoded).value();
+        std::vector<std::byte> small(255);
+        CHECK(!decodeWordRle(std::span{ encoded }.first(size), 4, small).has_value());
+        std::vector<std::byte> out(256);
+        CHECK(!decodeWordRle(std::span{ encoded }.first(size - 1), 4, out).has_value());
+
+        auto rng = std::mt19937(11);
+        std::vector<std::byte> garbage(64);
+        for (int i = 0; i < 10000; i++) {
+            for (auto& b : garbage)
+                b = static_cast<std::byte>(rng());
+            auto const decoded = decodeWordRle(garbage, 4, out);
+            CHECK((!decoded || decoded.value() <= out.size()));
+        }
+    }
+}
+
+TEST_CASE("Link frames negotiate the encoding in band", "[link]")
+{
+    auto const stats = std::make_shared<LinkEncodingStats>();
+    auto const a = LinkEncodingOptions{ .word_size = 4, .stats = stats };
+    auto const b = LinkEncodingOptions{ .word_size = 4 };
+    auto const raw_only = LinkEncodingOptions{ .word_size = 4, .enable_word_rle = false };
+    auto const message = std::vector<std::byte>(1024);
+    std::vector<std::byte> frame(message.size() + 1);
+    std::vector<std::byte> out(4096);
+    uint8_t a_knows_b = 0;
+    uint8_t b_knows_a = 0;
+
+    // Nothing advertised yet, so the first frame goes raw
+    auto size = encodeLinkFrame(message, a_knows_b, a, frame);
+    CHECK(size == message.size() + 1);
+    CHECK(decodeLinkFrame(std::span{ frame }.first(size), b, out, b_knows_a) == message.size());
+    CHECK(b_knows_a == a.capabilities());
+
+    size = encodeLinkFrame(message, b_knows_a, b, frame);
+    CHECK(size < 16);
+    CHECK(decodeLinkFrame(std::span{ frame }.first(size), a, out, a_knows_b) == message.size());
+    CHECK(std::equal(message.begin(), message.end(), out.begin()));
+    CHECK(a_knows_b == b.capabilities());
+
+    size = encodeLinkFrame(message, a_knows_b, a, frame);
+    CHECK(size < 16);
+    CHECK(stats->frames_sent == 2);
+    CHECK(stats->frames_encoded == 1);
+    CHECK(stats->wire_bytes_sent == message.size() + 1 + size);
+
+    // A side without the encoding never receives it, and drops it if sent anyway
+    uint8_t knows_raw_only = 0;
+    CHECK(decodeLinkFrame(std::span{ frame }.first(size), raw_only, out, knows_raw_only) == std::nullopt);
+    size = encodeLinkFrame(message, a_knows_b, raw_only, frame);
+    CHECK(decodeLinkFrame(std::span{ frame }.first(size), a, out, a_knows_b) == message.size());
+    CHECK(a_knows_b == 0);
+    CHECK(encodeLinkFrame(message, a_knows_b, a, frame) == message.size() + 1);
+}
+
+TEST_CASE("Bulk transfers over link-encoded UDP", "[link][RRT][Async]")
+{
+    using CFG = RAP::ExampleRapCfg;
+    asio::io_context ioc;
+
+    auto const server_stats = std::make_shared<LinkEncodingStats>();
+    auto const client_stats = std::make_shared<LinkEncodingStats>();
+    auto simple_target = std::make_shared<AdvDummyRegisterTarget<CFG::AddressType, CFG::DataType>>("Adv Dummy");
+    auto server = RAP::RTF::BatchingServerAdapter<CFG>("localhost", 4360, simple_target,
+        { .link_encoding = LinkEncodingOptions{ .stats = server_stats } });
+
+    auto client_xport = makeLinkEncodingAsyncTransport(makeAsyncUdpTransport(ioc.get_executor(), "localhost", 1260, "localhost", 4360),
+        { .word_size = CFG::DataBytes, .stats = client_stats });
+    auto rap_target = RAP::RTF::AsyncRapRegisterTarget<CFG>("Async Rap Target", std::move(client_xport));
+    rap_target.setTimeout(std::chrono::seconds(1));
+
+    // A firmware image that is mostly erased flash, with a short header
+    std::vector<CFG::DataType> image(2000, static_cast<CFG::DataType>(~CFG::DataType{}));
+    std::iota(image.begin(), image.begin() + 8, CFG::DataType{ 0x5A });
+    std::vector<CFG::DataType> readback(image.size());
+    asio::co_spawn(ioc, [&]() -> asio::awaitable<void> {
+        co_await rap_target.writeAsync(0x0, 0x1); // Lets both ends see each other's capabilities
+        co_await rap_target.seqWriteAsync(0x1000, image);
+        co_await rap_target.seqReadAsync(0x1000, readback);
+    }, [&](std::exception_ptr ex) {
+        ioc.stop();
+        if (ex)
+            std::rethrow_exception(ex);
+    });
+    REQUIRE_NOTHROW(ioc.run());
+
+    CHECK(readback == image);
+    CHECK(client_stats->frames_encoded > 0);
+    CHECK(server_stats->frames_encoded > 0);
+    CHECK(client_stats->wire_bytes_sent * 10 < client_stats->message_bytes_sent);
+    CHECK(server_stats->wire_bytes_sent * 10 < server_stats->message_bytes_sent);
+    CHECK(server_stats->frames_dropped == 0);
+}
+
+TEST_CASE("Bulk transfers over link-encoded sync transports", "[link][RRT]")
+{
+    using CFG = RAP::ExampleRapCfg;
+    auto const server_stats = std::make_shared<LinkEncodingStats>();
+    auto const client_stats = std::make_shared<LinkEncodingStats>();
+    auto [client_ipc, server_ipc] = makeSyncPairedIpcTransport(4096);
+    auto client_xport = makeLinkEncodingTransport(std::move(client_ipc), { .word_size = CFG::DataBytes, .stats = client_stats });
+    client_xport->setTimeout(std::chrono::seconds(1));
+    auto rap_target = RAP::RTF::RapRegisterTarget<CFG>("Rap Target", std::move(client_xport));
+    auto simple_target = std::make_shared<AdvDummyRegisterTarget<CFG::AddressType, CFG::DataType>>("Adv Dummy");
+    auto server = RAP::RTF::RapServerAdapter<CFG>(makeLinkEncodingTransport(std::move(server_ipc), { .word_size = CFG::DataBytes, .stats = server_stats }), simple_target);
+
+    std::vector<CFG::DataType> zeroes(200);
+    std::vector<CFG::DataType> readback(zeroes.size(), CFG::DataType{ 1 });
+    rap_target.write(0x0, 0x1); // Lets both ends see each other's capabilities
+    rap_target.seqWrite(0x1000, zeroes);
+    rap_target.seqRead(0x1000, readback);
+
+    CHECK(readback == zeroes);
+    CHECK(client_stats->frames_encoded > 0);
+    CHECK(server_stats->frames_encoded > 0);
+    CHECK(server_stats->frames_dropped == 0);
+    CHECK_THROWS(makeLinkEncodingTransport(makeSyncPairedIpcTransport(512).first, {}));
+}
+
+TEST_CASE("Measure link encoding of bulk payloads", "[Explore][link]")
+{
+    using CFG = Rap_A24D32L2C2;
+    using DataType = CFG::DataType;
+    auto constexpr words = 1000;
+    auto constexpr iterations = 2000;
+    auto serdes = RAP::Serdes::Serdes<CFG>(4096);
+    auto rng = std::mt19937(1234);
+
+    auto const measure = [&](std::string_view name, std::vector<DataType> data) {
+        auto const cmd = RAP::Serdes::WriteSeqCommand<CFG>{ .transaction_id = 1, .posted = false, .start_addr = 0x1000, .increment = sizeof(DataType), .data = std::move(data) };
+        auto const encoded = serdes.encodeCommand(cmd);
+        auto const message = std::as_bytes(std::span{ encoded });
+        auto const options = LinkEncodingOptions{ .word_size = CFG::DataBytes };
+        std::vector<std::byte> frame(message.size() + 1);
+        std::vector<std::byte> out(message.size());
+        uint8_t peer_capabilities = options.capabilities();
+
+        size_t frame_size = 0;
+        auto const encode_start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+            frame_size = encodeLinkFrame(message, peer_capabilities, options, frame);
+        auto const encode_time = std::chrono::steady_clock::now() - encode_start;
+        auto const decode_start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+            CHECK(decodeLinkFrame(std::span{ frame }.first(frame_size), options, out, peer_capabilities) == message.size());
+        auto const decode_time = std::chrono::steady_clock::now() - decode_start;
+        CHECK(std::equal(message.begin(), message.end(), out.begin()));
+
+        auto const mb_per_s = [&](auto t) { return message.size() * iterations / std::chrono::duration<double, std::micro>(t).count(); };
+        LOG_INFO("Explore", "{}: {} -> {} bytes ({:.1f}x), encode {:.0f} MB/s, decode {:.0f} MB/s",
+            name, message.size(), frame_size, double(message.size()) / frame_size, mb_per_s(encode_time), mb_per_s(decode_time));
+    };
+
+    std::vector<DataType> data(words);
+    measure("Zeroed memory dump", data);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (i / 64) % 3 == 0 ? static_cast<DataType>(rng()) : 0;
+    measure("Sparse memory dump", data);
+    std::iota(data.begin(), data.end(), DataType{ 0 });
+    measure("FIFO ramp", data);
+    for (auto& word : data)
+        word = static_cast<DataType>(rng());
+    measure("Random", data);
+}
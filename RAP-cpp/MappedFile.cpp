@@ -0,0 +1,192 @@
+#include "MappedFile.h"
+#include <format>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+static
+std::system_error lastError(std::string_view what)
+{
+#if defined(_WIN32)
+    return std::system_error(static_cast<int>(::GetLastError()), std::system_category(), std::string{ what });
+#else
+    return std::system_error(errno, std::system_category(), std::string{ what });
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    if (this->isOpen())
+        this->close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        if (this->isOpen())
+            this->close();
+        this->base = std::exchange(other.base, nullptr);
+        this->length = std::exchange(other.length, 0);
+        this->writable = other.writable;
+#if defined(_WIN32)
+        this->file = std::exchange(other.file, nullptr);
+        this->mapping = std::exchange(other.mapping, nullptr);
+#else
+        this->fd = std::exchange(other.fd, -1);
+#endif
+    }
+    return *this;
+}
+
+bool MappedFile::isOpen() const
+{
+#if defined(_WIN32)
+    return this->file != nullptr;
+#else
+    return this->fd >= 0;
+#endif
+}
+
+MappedFile MappedFile::openRead(std::filesystem::path const& path)
+{
+    MappedFile mf;
+    mf.writable = false;
+#if defined(_WIN32)
+    mf.file = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (mf.file == INVALID_HANDLE_VALUE) {
+        mf.file = nullptr;
+        throw lastError(std::format("Opening {}", path.string()));
+    }
+    LARGE_INTEGER size{};
+    ::GetFileSizeEx(mf.file, &size);
+    mf.map(static_cast<size_t>(size.QuadPart));
+#else
+    mf.fd = ::open(path.c_str(), O_RDONLY);
+    if (mf.fd < 0)
+        throw lastError(std::format("Opening {}", path.string()));
+    struct stat st{};
+    ::fstat(mf.fd, &st);
+    mf.map(static_cast<size_t>(st.st_size));
+#endif
+    return mf;
+}
+
+MappedFile MappedFile::create(std::filesystem::path const& path, size_t initial_size)
+{
+    if (path.has_parent_path())
+        std::filesystem::create_directories(path.parent_path());
+    MappedFile mf;
+    mf.writable = true;
+#if defined(_WIN32)
+    mf.file = ::CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (mf.file == INVALID_HANDLE_VALUE) {
+        mf.file = nullptr;
+        throw lastError(std::format("Creating {}", path.string()));
+    }
+#else
+    mf.fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (mf.fd < 0)
+        throw lastError(std::format("Creating {}", path.string()));
+#endif
+    mf.map(initial_size);
+    return mf;
+}
+
+void MappedFile::resize(size_t new_size)
+{
+    if (!this->writable)
+        throw std::logic_error("MappedFile::resize on a read-only mapping");
+    this->unmap();
+    this->map(new_size);
+}
+
+void MappedFile::flush()
+{
+    if (!this->isOpen())
+        return;
+#if defined(_WIN32)
+    ::FlushViewOfFile(this->base, this->length);
+#else
+    ::msync(this->base, this->length, MS_ASYNC);
+#endif
+}
+
+void MappedFile::close(size_t final_size)
+{
+    this->unmap();
+#if defined(_WIN32)
+    if (this->file) {
+        if (this->writable) {
+            LARGE_INTEGER size{};
+            size.QuadPart = static_cast<LONGLONG>(final_size);
+            ::SetFilePointerEx(this->file, size, nullptr, FILE_BEGIN);
+            ::SetEndOfFile(this->file);
+        }
+        ::CloseHandle(this->file);
+        this->file = nullptr;
+    }
+#else
+    if (this->fd >= 0) {
+        if (this->writable)
+            (void)::ftruncate(this->fd, static_cast<off_t>(final_size));
+        ::close(this->fd);
+        this->fd = -1;
+    }
+#endif
+    this->length = 0;
+}
+
+void MappedFile::map(size_t new_size)
+{
+    this->length = new_size;
+    if (new_size == 0)
+        return;
+#if defined(_WIN32)
+    auto const protect = this->writable ? PAGE_READWRITE : PAGE_READONLY;
+    auto const access = this->writable ? FILE_MAP_WRITE : FILE_MAP_READ;
+    auto const size64 = static_cast<uint64_t>(new_size);
+    this->mapping = ::CreateFileMappingW(this->file, nullptr, protect, static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64), nullptr);
+    if (!this->mapping)
+        throw lastError("CreateFileMapping");
+    this->base = static_cast<std::byte*>(::MapViewOfFile(this->mapping, access, 0, 0, new_size));
+    if (!this->base)
+        throw lastError("MapViewOfFile");
+#else
+    if (this->writable && ::ftruncate(this->fd, static_cast<off_t>(new_size)) != 0)
+        throw lastError("ftruncate");
+    auto const prot = this->writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void* const p = ::mmap(nullptr, new_size, prot, MAP_SHARED, this->fd, 0);
+    if (p == MAP_FAILED)
+        throw lastError("mmap");
+    this->base = static_cast<std::byte*>(p);
+#endif
+}
+
+void MappedFile::unmap()
+{
+#if defined(_WIN32)
+    if (this->base)
+        ::UnmapViewOfFile(this->base);
+    if (this->mapping)
+        ::CloseHandle(this->mapping);
+    this->mapping = nullptr;
+#else
+    if (this->base)
+        ::munmap(this->base, this->length);
+#endif
+    this->base = nullptr;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+// Minimal memory-mapped file, Win32 or POSIX.
+// Writable files are created at an initial size and grown with resize(); close(final_size) trims off the unused tail.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    static MappedFile openRead(std::filesystem::path const& path);
+    static MappedFile create(std::filesystem::path const& path, size_t initial_size);
+
+    bool isOpen() const;
+    std::span<std::byte> data() { return { this->base, this->length }; }
+    std::span<std::byte const> data() const { return { this->base, this->length }; }
+    size_t size() const { return this->length; }
+
+    // Grows (or shrinks) a writable mapping; invalidates previously returned spans
+    void resize(size_t new_size);
+    void flush();
+    void close(size_t final_size);
+    void close() { this->close(this->length); }
+
+private:
+    void map(size_t new_size);
+    void unmap();
+
+    std::byte* base = nullptr;
+    size_t length = 0;
+    bool writable = false;
+#if defined(_WIN32)
+    void* file = nullptr;
+    void* mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
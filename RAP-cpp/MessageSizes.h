@@ -0,0 +1,73 @@
+#pragma once
+#include <RAP/Serdes.h>
+#include "SerdesTypes.h"
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+namespace RAP::Serdes {
+
+// Encoded sizes of Serdes<Cfg> messages, known at compile time.
+// Every message is a type byte and the transaction ID, its fields at their Cfg widths (AddressBytes, DataBytes,
+// LengthBytes; a Seq increment is LengthBytes wide, a NAK status DataBytes), then the CRC. Counts on the wire are
+// LengthBytes wide and precede the items they count. MessageSizingExplore.cpp checks all of this against what Serdes
+// actually encodes, for every test Cfg.
+// These are sizes only. Encoding a fixed-size message into a std::array<std::byte, N> needs the field layout, which has
+// to come from RAP's Serdes itself, next to the code that writes the frames, so the two can't drift apart.
+template <IsConfigurationType Cfg>
+struct MessageSizes
+{
+    static constexpr size_t header = 1 + sizeof(typename SerdesTypes<Cfg>::TransactionIdType);
+    static constexpr size_t crc = Cfg::CrcBytes;
+    static constexpr size_t address = Cfg::AddressBytes;
+    static constexpr size_t data = Cfg::DataBytes;
+    static constexpr size_t length = Cfg::LengthBytes;
+
+    // Fixed-size messages
+    static constexpr size_t read_single_command = header + address + crc;
+    static constexpr size_t write_single_command = header + address + data + crc;
+    static constexpr size_t read_seq_command = header + address + length + length + crc;
+    static constexpr size_t read_modify_write_command = header + address + data + data + crc;
+    static constexpr size_t read_single_ack = header + data + crc;
+    static constexpr size_t write_ack = header + crc; // Every write's ACK: single, Seq, Comp and read-modify-write
+    static constexpr size_t nak = header + data + crc;
+
+    // Variable-size messages, for count items
+    static constexpr size_t writeSeqCommand(size_t count) { return header + address + length + length + count * data + crc; }
+    static constexpr size_t readCompCommand(size_t count) { return header + length + count * address + crc; }
+    static constexpr size_t writeCompCommand(size_t count) { return header + length + count * (address + data) + crc; }
+    static constexpr size_t readSeqAck(size_t count) { return header + length + count * data + crc; }
+    static constexpr size_t readCompAck(size_t count) { return header + length + count * data + crc; }
+
+    static constexpr size_t smallest_command = std::min({ read_single_command, write_single_command, read_seq_command, read_modify_write_command,
+        writeSeqCommand(0), readCompCommand(0), writeCompCommand(0) });
+    static constexpr size_t smallest_response = std::min({ read_single_ack, write_ack, nak, readSeqAck(0), readCompAck(0) });
+    // Largest message with every count at zero; Serdes<Cfg>::minimum_max_message_size has to fit it
+    static constexpr size_t largest_empty = std::max({ read_single_command, write_single_command, read_seq_command, read_modify_write_command,
+        writeSeqCommand(0), readCompCommand(0), writeCompCommand(0), read_single_ack, write_ack, nak, readSeqAck(0), readCompAck(0) });
+};
+
+// Exact encoded size of a message that has no variable part, as FixedMessageSize<ReadSingleCommand<Cfg>>::value
+template <typename Message>
+struct FixedMessageSize;
+template <IsConfigurationType Cfg> struct FixedMessageSize<ReadSingleCommand<Cfg>> : std::integral_constant<size_t, MessageSizes<Cfg>::read_single_command> {};
+template <IsConfigurationType Cfg> struct FixedMessageSize<WriteSingleCommand<Cfg>> : std::integral_constant<size_t, MessageSizes<Cfg>::write_single_command> {};
+template <IsConfigurationType Cfg> struct FixedMessageSize<ReadSeqCommand<Cfg>> : std::integral_constant<size_t, MessageSizes<Cfg>::read_seq_command> {};
+template <IsConfigurationType Cfg> struct FixedMessageSize<ReadModifyWriteCommand<Cfg>> : std::integral_constant<size_t, MessageSizes<Cfg>::read_modify_write_command> {};
+template <IsConfigurationType Cfg> struct FixedMessageSize<ReadSingleAckResponse<Cfg>> : std::integral_constant<size_t, MessageSizes<Cfg>::read_single_ack> {};
+template <IsConfigurationType Cfg> struct FixedMessageSize<WriteSingleAckResponse<Cfg>> : std::integral_constant<size_t, MessageSizes<Cfg>::write_ack> {};
+template <IsConfigurationType Cfg> struct FixedMessageSize<WriteSeqAckResponse<Cfg>> : std::integral_constant<size_t, MessageSizes<Cfg>::write_ack> {};
+template <IsConfigurationType Cfg> struct FixedMessageSize<WriteCompAckResponse<Cfg>> : std::integral_constant<size_t, MessageSizes<Cfg>::write_ack> {};
+template <IsConfigurationType Cfg> struct FixedMessageSize<ReadmodifywriteSingleAckResponse<Cfg>> : std::integral_constant<size_t, MessageSizes<Cfg>::write_ack> {};
+template <IsConfigurationType Cfg> struct FixedMessageSize<ReadSingleNakResponse<Cfg>> : std::integral_constant<size_t, MessageSizes<Cfg>::nak> {};
+template <IsConfigurationType Cfg> struct FixedMessageSize<WriteSingleNakResponse<Cfg>> : std::integral_constant<size_t, MessageSizes<Cfg>::nak> {};
+template <IsConfigurationType Cfg> struct FixedMessageSize<ReadSeqNakResponse<Cfg>> : std::integral_constant<size_t, MessageSizes<Cfg>::nak> {};
+template <IsConfigurationType Cfg> struct FixedMessageSize<WriteSeqNakResponse<Cfg>> : std::integral_constant<size_t, MessageSizes<Cfg>::nak> {};
+template <IsConfigurationType Cfg> struct FixedMessageSize<ReadCompNakResponse<Cfg>> : std::integral_constant<size_t, MessageSizes<Cfg>::nak> {};
+template <IsConfigurationType Cfg> struct FixedMessageSize<WriteCompNakResponse<Cfg>> : std::integral_constant<size_t, MessageSizes<Cfg>::nak> {};
+template <IsConfigurationType Cfg> struct FixedMessageSize<ReadmodifywriteSingleNakResponse<Cfg>> : std::integral_constant<size_t, MessageSizes<Cfg>::nak> {};
+
+template <typename Message>
+inline constexpr size_t fixed_message_size_v = FixedMessageSize<Message>::value;
+
+}
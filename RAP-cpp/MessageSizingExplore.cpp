@@ -1,7 +1,11 @@
 #include <RAP/Serdes.h>
 #include <YALF/YALF.h>
+#include "MessageSizes.h"
+#include "SerdesTestCfgs.h"
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/generators/catch_generators_all.hpp>
+#include <type_traits>
+#include <vector>
 
 struct SmallCfg
 {
@@ -141,6 +145,66 @@ TEST_CASE("Collect messages sizes", "[sizing]")
     #endif
 }
 
+// Every message, with any vectors empty, fits the minimum max_message_size Serdes imposes
+template <typename Cfg>
+constexpr bool empty_messages_fit = RAP::Serdes::MessageSizes<Cfg>::largest_empty <= RAP::Serdes::Serdes<Cfg>::minimum_max_message_size;
+static_assert(empty_messages_fit<SmallCfg>);
+static_assert(empty_messages_fit<LargeCfg>);
+static_assert(empty_messages_fit<SmallABigDCfg>);
+static_assert(empty_messages_fit<BigASmallDCfg>);
+static_assert(empty_messages_fit<RAP::ExampleRapCfg>);
+static_assert(empty_messages_fit<Rap_A8D8L1C1>);
+static_assert(empty_messages_fit<Rap_A24D32L2C2>);
+static_assert(empty_messages_fit<Rap_A48D64L2C4>);
+
+// The static_asserts above are only as good as MessageSizes' model of the wire format, so hold it to what Serdes encodes
+template <typename Cfg>
+static
+void checkMessageSizes()
+{
+    using namespace RAP::Serdes;
+    using Sizes = MessageSizes<Cfg>;
+    using AddressType = typename Cfg::AddressType;
+    using DataType = typename Cfg::DataType;
+    auto serdes = Serdes<Cfg>{ 4096 };
+    auto const command = [&](auto const& cmd) { return serdes.encodeCommand(cmd).size(); };
+    auto const response = [&](auto const& resp) { return serdes.encodeResponse(resp).size(); };
+
+    [&]<typename... Commands>(std::type_identity<Commands>...) {
+        ([&] { CHECK(command(Commands{}) == fixed_message_size_v<Commands>); }(), ...);
+    }(std::type_identity<ReadSingleCommand<Cfg>>{}, std::type_identity<WriteSingleCommand<Cfg>>{}, std::type_identity<ReadSeqCommand<Cfg>>{});
+    // Not every test Cfg has the feature, and Serdes refuses the command without it
+    if constexpr (Cfg::FeatureReadModifyWrite)
+        CHECK(command(ReadModifyWriteCommand<Cfg>{}) == fixed_message_size_v<ReadModifyWriteCommand<Cfg>>);
+    [&]<typename... Responses>(std::type_identity<Responses>...) {
+        ([&] { CHECK(response(Responses{}) == fixed_message_size_v<Responses>); }(), ...);
+    }(std::type_identity<ReadSingleAckResponse<Cfg>>{}, std::type_identity<WriteSingleAckResponse<Cfg>>{}, std::type_identity<WriteSeqAckResponse<Cfg>>{},
+        std::type_identity<WriteCompAckResponse<Cfg>>{}, std::type_identity<ReadmodifywriteSingleAckResponse<Cfg>>{},
+        std::type_identity<ReadSingleNakResponse<Cfg>>{}, std::type_identity<WriteSingleNakResponse<Cfg>>{}, std::type_identity<ReadSeqNakResponse<Cfg>>{},
+        std::type_identity<WriteSeqNakResponse<Cfg>>{}, std::type_identity<ReadCompNakResponse<Cfg>>{}, std::type_identity<WriteCompNakResponse<Cfg>>{},
+        std::type_identity<ReadmodifywriteSingleNakResponse<Cfg>>{});
+
+    for (size_t n : { 0, 1, 7 }) {
+        CHECK(command(WriteSeqCommand<Cfg>{ .data = std::vector<DataType>(n) }) == Sizes::writeSeqCommand(n));
+        CHECK(command(ReadCompCommand<Cfg>{ .addresses = std::vector<AddressType>(n) }) == Sizes::readCompCommand(n));
+        CHECK(command(WriteCompCommand<Cfg>{ .addr_data = std::vector<std::pair<AddressType, DataType>>(n) }) == Sizes::writeCompCommand(n));
+        CHECK(response(ReadSeqAckResponse<Cfg>{ .data = std::vector<DataType>(n) }) == Sizes::readSeqAck(n));
+        CHECK(response(ReadCompAckResponse<Cfg>{ .data = std::vector<DataType>(n) }) == Sizes::readCompAck(n));
+    }
+}
+
+TEST_CASE("Message sizes match what Serdes encodes", "[sizing]")
+{
+    checkMessageSizes<SmallCfg>();
+    checkMessageSizes<LargeCfg>();
+    checkMessageSizes<SmallABigDCfg>();
+    checkMessageSizes<BigASmallDCfg>();
+    checkMessageSizes<RAP::ExampleRapCfg>();
+    checkMessageSizes<Rap_A8D8L1C1>();
+    checkMessageSizes<Rap_A24D32L2C2>();
+    checkMessageSizes<Rap_A48D64L2C4>();
+}
+
 template <typename Cfg>
 static inline
 void checkSeqRead(RAP::Serdes::Serdes<Cfg> serdes, char const* sect)
@@ -214,7 +278,10 @@ void checkCompWrite(RAP::Serdes::Serdes<Cfg> serdes, char const* sect)
     }
 }
 
-TEST_CASE("Check maximum message size boundariees", "[sizing]")
+// One test case per Cfg so the sweep spreads across shards (see run_sharded_tests.py)
+template <typename Cfg>
+static inline
+void checkBoundaries()
 {
     using namespace RAP::Serdes;
     //auto const max_message_size = GENERATE(32, 64, 128, 256, 512, 1024, 2048, 4096);
@@ -231,39 +298,29 @@ TEST_CASE("Check maximum message size boundariees", "[sizing]")
     );
     //LOG_NOTICE("Test", "Max Message Size = {}", max_message_size);
 
-    SECTION("SmallCfg")
-    {
-        auto serdes = Serdes<SmallCfg>(max_message_size);
-        checkSeqRead(serdes, "Seq Read");
-        checkSeqWrite(serdes, "Seq Write");
-        checkCompRead(serdes, "Comp Read");
-        checkCompWrite(serdes, "Comp Write");
-    }
+    auto serdes = Serdes<Cfg>(max_message_size);
+    checkSeqRead(serdes, "Seq Read");
+    checkSeqWrite(serdes, "Seq Write");
+    checkCompRead(serdes, "Comp Read");
+    checkCompWrite(serdes, "Comp Write");
+}
 
-    SECTION("LargeCfg")
-    {
-        auto serdes = Serdes<LargeCfg>(max_message_size);
-        checkSeqRead(serdes, "Seq Read");
-        checkSeqWrite(serdes, "Seq Write");
-        checkCompRead(serdes, "Comp Read");
-        checkCompWrite(serdes, "Comp Write");
-    }
+TEST_CASE("Check maximum message size boundariees SmallCfg", "[sizing]")
+{
+    checkBoundaries<SmallCfg>();
+}
 
-    SECTION("SmallABigDCfg")
-    {
-        auto serdes = Serdes<SmallABigDCfg>(max_message_size);
-        checkSeqRead(serdes, "Seq Read");
-        checkSeqWrite(serdes, "Seq Write");
-        checkCompRead(serdes, "Comp Read");
-        checkCompWrite(serdes, "Comp Write");
-    }
+TEST_CASE("Check maximum message size boundariees LargeCfg", "[sizing]")
+{
+    checkBoundaries<LargeCfg>();
+}
 
-    SECTION("BigASmallDCfg")
-    {
-        auto serdes = Serdes<BigASmallDCfg>(max_message_size);
-        checkSeqRead(serdes, "Seq Read");
-        checkSeqWrite(serdes, "Seq Write");
-        checkCompRead(serdes, "Comp Read");
-        checkCompWrite(serdes, "Comp Write");
-    }
+TEST_CASE("Check maximum message size boundariees SmallABigDCfg", "[sizing]")
+{
+    checkBoundaries<SmallABigDCfg>();
+}
+
+TEST_CASE("Check maximum message size boundariees BigASmallDCfg", "[sizing]")
+{
+    checkBoundaries<BigASmallDCfg>();
 }
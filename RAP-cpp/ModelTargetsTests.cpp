@@ -0,0 +1,161 @@
+#include "AdvDummyRegisterTarget.h"
+#include "FifoModelTarget.h"
+#include "RegisterFileTarget.h"
+#include "SerdesTestCfgs.h"
+#include "ServerDispatch.h"
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <numeric>
+#include <random>
+
+TEST_CASE("Ring buffer moves whole spans across the wrap", "[RRT][model]")
+{
+    RingBuffer<uint16_t> ring(6); // Stored in 8 slots, limited to 6
+    std::array<uint16_t, 4> const a{ 1, 2, 3, 4 };
+    std::array<uint16_t, 4> const b{ 5, 6, 7, 8 };
+    std::array<uint16_t, 8> out{};
+
+    CHECK(ring.push(a) == 4);
+    CHECK(ring.pop(std::span{ out }.first(3)) == 3);
+    CHECK(ring.push(b) == 4);
+    CHECK(ring.size() == 5);
+    CHECK(ring.push(a) == 1); // Only one slot left
+    CHECK(ring.pop(out) == 6);
+    CHECK(out == std::array<uint16_t, 8>{ 4, 5, 6, 7, 8, 1, 0, 0 });
+    CHECK(ring.size() == 0);
+}
+
+TEST_CASE("Register file target", "[RRT][model]")
+{
+    using AddressType = uint32_t;
+    using DataType = uint16_t;
+    RegisterFileTarget<AddressType, DataType> target("Register File", 0x1000, 256, 4);
+
+    SECTION("Single, seq and comp access agree")
+    {
+        target.write(0x1000, 0x11);
+        std::array<DataType, 4> const seq{ 1, 2, 3, 4 };
+        target.seqWrite(0x1010, seq, 4);
+        std::vector<std::pair<AddressType, DataType>> const comp{ { 0x1100, 7 }, { 0x1004, 8 }, { 0x1100, 9 } };
+        target.compWrite(comp);
+        target.readModifyWrite(0x1010, 0xF0, 0xF0);
+
+        CHECK(target.read(0x1000) == 0x11);
+        CHECK(target.read(0x1004) == 8);
+        CHECK(target.read(0x1100) == 9); // Last write to a repeated address wins
+        std::array<DataType, 4> seq_out{};
+        target.seqRead(0x1010, seq_out, 4);
+        CHECK(seq_out == std::array<DataType, 4>{ 0xF1, 2, 3, 4 });
+        std::array<AddressType, 3> const addresses{ 0x101C, 0x1000, 0x1100 };
+        std::array<DataType, 3> comp_out{};
+        target.compRead(addresses, comp_out);
+        CHECK(comp_out == std::array<DataType, 3>{ 4, 0x11, 9 });
+        CHECK(target.registers()[4] == 0xF1);
+    }
+    SECTION("Non-unit strides and FIFO access to a plain register")
+    {
+        std::array<DataType, 3> const data{ 5, 6, 7 };
+        target.seqWrite(0x1000, data, 8);
+        CHECK(target.read(0x1008) == 6);
+        CHECK(target.read(0x1004) == 0);
+        target.fifoWrite(0x1020, data);
+        std::array<DataType, 2> out{};
+        target.fifoRead(0x1020, out);
+        CHECK(out == std::array<DataType, 2>{ 7, 7 });
+    }
+    SECTION("Addresses outside the file throw")
+    {
+        CHECK_THROWS(target.write(0x0FFC, 1));
+        CHECK_THROWS(target.write(0x1002, 1));
+        CHECK_THROWS(target.read(0x1000 + 256 * 4));
+        std::array<DataType, 2> const data{ 1, 2 };
+        CHECK_THROWS(target.seqWrite(0x1000 + 255 * 4, data, 4));
+    }
+}
+
+TEST_CASE("FIFO model target", "[RRT][model]")
+{
+    using AddressType = uint32_t;
+    using DataType = uint16_t;
+    auto const regs = std::make_shared<RegisterFileTarget<AddressType, DataType>>("Registers", 0, 64);
+    FifoModelTarget<AddressType, DataType> target(regs);
+    target.addFifo(0x40, 8);
+    CHECK_THROWS(target.addFifo(0x40, 8));
+
+    std::vector<DataType> data(10);
+    std::iota(data.begin(), data.end(), DataType{ 100 });
+    target.fifoWrite(0x40, data);
+    auto stats = target.getStats(0x40);
+    CHECK(stats.occupancy == 8);
+    CHECK(stats.overflows == 2);
+
+    std::array<DataType, 5> device_out{};
+    CHECK(target.devicePop(0x40, device_out) == 5);
+    CHECK(device_out == std::array<DataType, 5>{ 100, 101, 102, 103, 104 });
+
+    std::array<DataType, 2> const device_in{ 7, 8 };
+    CHECK(target.devicePush(0x40, device_in) == 2);
+    std::array<DataType, 6> host_out{};
+    target.fifoRead(0x40, host_out);
+    CHECK(host_out == std::array<DataType, 6>{ 105, 106, 107, 7, 8, 0 });
+    CHECK(target.getStats(0x40).underflows == 1);
+
+    // Comp access mixes FIFO pushes with forwarded register writes, in order
+    std::vector<std::pair<AddressType, DataType>> const comp{ { 0x02, 1 }, { 0x40, 2 }, { 0x04, 3 }, { 0x06, 4 }, { 0x40, 5 } };
+    target.compWrite(comp);
+    CHECK(regs->read(0x02) == 1);
+    CHECK(regs->read(0x06) == 4);
+    std::array<AddressType, 4> const addresses{ 0x04, 0x40, 0x40, 0x02 };
+    std::array<DataType, 4> comp_out{};
+    target.compRead(addresses, comp_out);
+    CHECK(comp_out == std::array<DataType, 4>{ 3, 2, 5, 1 });
+
+    target.write(0x40, 9);
+    CHECK(target.read(0x40) == 9);
+    CHECK_THROWS(target.readModifyWrite(0x40, 1, 1));
+}
+
+TEST_CASE("Measure large WriteComp and FIFO commands against the model targets", "[Explore][RRT][model]")
+{
+    using CFG = Rap_A24D32L2C2;
+    using AddressType = CFG::AddressType;
+    using DataType = CFG::DataType;
+    auto constexpr register_count = size_t{ 1 } << 20;
+    auto constexpr entries = 4096;
+    auto constexpr iterations = 200;
+
+    auto rng = std::mt19937(1234);
+    auto dist = std::uniform_int_distribution<uint32_t>(0, register_count - 1);
+    auto comp = RAP::Serdes::WriteCompCommand<CFG>{ .transaction_id = 1, .posted = false };
+    for (int i = 0; i < entries; i++)
+        comp.addr_data.emplace_back(static_cast<AddressType>(dist(rng) * sizeof(DataType)), static_cast<DataType>(i));
+    auto fifo = RAP::Serdes::WriteSeqCommand<CFG>{ .transaction_id = 2, .posted = false, .start_addr = 0x40, .increment = 0 };
+    fifo.data.resize(entries);
+    std::iota(fifo.data.begin(), fifo.data.end(), DataType{ 0 });
+
+    auto const measure = [&](std::string_view name, RTF::IRegisterTarget<AddressType, DataType>& target, auto const& cmd, auto&& between) {
+        auto total = std::chrono::nanoseconds{};
+        for (int i = 0; i < iterations; i++) {
+            auto const start = std::chrono::steady_clock::now();
+            auto const resp = RAP::RTF::executeCommand<CFG>(target, cmd);
+            total += std::chrono::steady_clock::now() - start;
+            CHECK(resp.has_value());
+            CHECK(std::holds_alternative<typename RAP::Serdes::CommandResponseRelationshipTrait<std::remove_cvref_t<decltype(cmd)>>::AckResponseType>(resp.value()));
+            between();
+        }
+        LOG_INFO("Explore", "{}: {} entries in {:.1f}us", name, entries, std::chrono::duration<double, std::micro>(total).count() / iterations);
+    };
+
+    auto hash_target = AdvDummyRegisterTarget<AddressType, DataType>("Adv Dummy");
+    auto const regs = std::make_shared<RegisterFileTarget<AddressType, DataType>>("Register File", 0, register_count);
+    auto fifo_target = FifoModelTarget<AddressType, DataType>(regs);
+    fifo_target.addFifo(0x40, entries);
+    std::vector<DataType> drained(entries);
+
+    measure("WriteComp, AdvDummyRegisterTarget", hash_target, comp, [] {});
+    measure("WriteComp, RegisterFileTarget", *regs, comp, [] {});
+    measure("FIFO WriteSeq, AdvDummyRegisterTarget", hash_target, fifo, [] {});
+    measure("FIFO WriteSeq, FifoModelTarget", fifo_target, fifo, [&] { CHECK(fifo_target.devicePop(0x40, drained) == entries); });
+    CHECK(drained == fifo.data);
+    CHECK(fifo_target.getStats(0x40).overflows == 0);
+}
@@ -0,0 +1,270 @@
+#include "RapMetrics.h"
+#include "ThreadPlacement.h"
+#include <YALF/YALF.h>
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+
+namespace RAP::Metrics {
+
+std::string_view getSideString(Side side)
+{
+    switch (side) {
+        case Side::Client: return "Client";
+        case Side::Server: return "Server";
+    }
+    return "?";
+}
+
+std::string_view getMessageKindString(MessageKind kind)
+{
+    switch (kind) {
+        case MessageKind::ReadSingle: return "ReadSingleCommand";
+        case MessageKind::WriteSingle: return "WriteSingleCommand";
+        case MessageKind::ReadSeq: return "ReadSeqCommand";
+        case MessageKind::WriteSeq: return "WriteSeqCommand";
+        case MessageKind::ReadComp: return "ReadCompCommand";
+        case MessageKind::WriteComp: return "WriteCompCommand";
+        case MessageKind::ReadModifyWrite: return "ReadModifyWriteCommand";
+    }
+    return "?";
+}
+
+std::string_view getPhaseString(Phase phase)
+{
+    switch (phase) {
+        case Phase::Encode: return "Encode";
+        case Phase::Wire: return "Wire";
+        case Phase::Decode: return "Decode";
+        case Phase::Device: return "Device";
+    }
+    return "?";
+}
+
+std::string_view getCounterString(Counter counter)
+{
+    switch (counter) {
+        case Counter::BytesSent: return "BytesSent";
+        case Counter::BytesReceived: return "BytesReceived";
+        case Counter::Retries: return "Retries";
+        case Counter::Timeouts: return "Timeouts";
+        case Counter::DecodeFailures: return "DecodeFailures";
+        case Counter::CrcFailures: return "CrcFailures";
+        case Counter::Naks: return "Naks";
+    }
+    return "?";
+}
+
+void HistogramSnapshot::add(Histogram const& h)
+{
+    if (h.count.load(std::memory_order_relaxed) == 0)
+        return;
+    for (size_t i = 0; i < this->buckets.size(); i++)
+        this->buckets[i] += h.buckets[i].load(std::memory_order_relaxed);
+    this->count += h.count.load(std::memory_order_relaxed);
+    this->sum_ns += h.sum_ns.load(std::memory_order_relaxed);
+    this->max_ns = std::max(this->max_ns, h.max_ns.load(std::memory_order_relaxed));
+}
+
+uint64_t HistogramSnapshot::valueAtPercentile(double p) const
+{
+    if (this->count == 0)
+        return 0;
+    auto const threshold = static_cast<uint64_t>(std::clamp(p, 0.0, 100.0) / 100.0 * static_cast<double>(this->count) + 0.5);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < this->buckets.size(); i++) {
+        seen += this->buckets[i];
+        if (seen >= std::max<uint64_t>(threshold, 1))
+            return std::min(HistogramLayout::bucketUpperBound(i), this->max_ns);
+    }
+    return this->max_ns;
+}
+
+namespace {
+    struct Registry
+    {
+        std::mutex mutex;
+        // Blocks are never freed so a thread's samples stay in the totals after it exits
+        std::vector<std::unique_ptr<ThreadMetrics>> blocks;
+        // Blocks whose thread has exited, waiting for the next thread to carry on recording into them
+        std::vector<ThreadMetrics*> idle;
+    };
+    Registry& registry()
+    {
+        static Registry r;
+        return r;
+    }
+
+    // Owns the calling thread's claim on a block and gives it back when the thread exits.
+    // Recording only ever bumps counters, so a recycled block keeps adding to what its previous threads left in it.
+    class ThreadBlock
+    {
+    public:
+        ThreadBlock()
+            : block(claim())
+        {
+        }
+        ~ThreadBlock()
+        {
+            auto& r = registry();
+            auto const lock = std::scoped_lock(r.mutex);
+            r.idle.push_back(this->block);
+        }
+        ThreadBlock(ThreadBlock const&) = delete;
+        ThreadBlock& operator=(ThreadBlock const&) = delete;
+
+        ThreadMetrics& metrics() const { return *this->block; }
+
+    private:
+        static ThreadMetrics* claim()
+        {
+            auto& r = registry();
+            auto const lock = std::scoped_lock(r.mutex);
+            if (!r.idle.empty()) {
+                auto* const p = r.idle.back();
+                r.idle.pop_back();
+                return p;
+            }
+            return r.blocks.emplace_back(std::make_unique<ThreadMetrics>()).get();
+        }
+
+        ThreadMetrics* const block;
+    };
+}
+
+ThreadMetrics& threadMetrics()
+{
+    thread_local ThreadBlock const local;
+    return local.metrics();
+}
+
+void recordNak(Side side, MessageKind kind, uint64_t status)
+{
+    auto& tm = threadMetrics();
+    Histogram::bump(tm.counters[size_t(side)][size_t(Counter::Naks)], 1);
+    Histogram::bump(tm.naks_by_kind[size_t(side)][size_t(kind)], 1);
+    for (auto& slot : tm.naks_by_status[size_t(side)]) {
+        if (!slot.used.load(std::memory_order_relaxed)) {
+            slot.status.store(status, std::memory_order_relaxed);
+            slot.count.store(1, std::memory_order_relaxed);
+            slot.used.store(true, std::memory_order_release);
+            return;
+        }
+        if (slot.status.load(std::memory_order_relaxed) == status) {
+            Histogram::bump(slot.count, 1);
+            return;
+        }
+    }
+    Histogram::bump(tm.naks_other_status[size_t(side)], 1);
+}
+
+Snapshot takeSnapshot()
+{
+    Snapshot snap;
+    auto& r = registry();
+    auto const lock = std::scoped_lock(r.mutex);
+    for (auto const& block : r.blocks) {
+        for (size_t s = 0; s < SideCount; s++) {
+            for (size_t k = 0; k < MessageKindCount; k++) {
+                for (size_t p = 0; p < PhaseCount; p++) {
+                    snap.histograms[Snapshot::histogramIndex(Side(s), MessageKind(k), Phase(p))].add(block->histograms[s][k][p]);
+                }
+                snap.naks_by_kind[s][k] += block->naks_by_kind[s][k].load(std::memory_order_relaxed);
+            }
+            for (size_t c = 0; c < CounterCount; c++)
+                snap.counters[s][c] += block->counters[s][c].load(std::memory_order_relaxed);
+            for (auto const& slot : block->naks_by_status[s]) {
+                if (!slot.used.load(std::memory_order_acquire))
+                    break;
+                auto const status = slot.status.load(std::memory_order_relaxed);
+                auto const count = slot.count.load(std::memory_order_relaxed);
+                auto& list = snap.naks_by_status[s];
+                auto const itr = std::find_if(list.begin(), list.end(), [&](auto const& e) { return e.first == status; });
+                if (itr != list.end())
+                    itr->second += count;
+                else
+                    list.emplace_back(status, count);
+            }
+            snap.naks_other_status[s] += block->naks_other_status[s].load(std::memory_order_relaxed);
+        }
+    }
+    for (auto& list : snap.naks_by_status)
+        std::sort(list.begin(), list.end(), [](auto const& a, auto const& b) { return a.second > b.second; });
+    return snap;
+}
+
+void dumpToLog(Snapshot const& snapshot)
+{
+    for (size_t s = 0; s < SideCount; s++) {
+        auto const side = Side(s);
+        for (size_t k = 0; k < MessageKindCount; k++) {
+            auto const kind = MessageKind(k);
+            for (size_t p = 0; p < PhaseCount; p++) {
+                auto const phase = Phase(p);
+                auto const& h = snapshot.histogram(side, kind, phase);
+                if (h.count == 0)
+                    continue;
+                LOG_INFO("RapMetrics", "{} {} {}: n={} mean={}ns p50={}ns p90={}ns p99={}ns p99.9={}ns max={}ns",
+                    getSideString(side), getMessageKindString(kind), getPhaseString(phase), h.count, h.mean(),
+                    h.valueAtPercentile(50), h.valueAtPercentile(90), h.valueAtPercentile(99), h.valueAtPercentile(99.9), h.max_ns);
+            }
+            if (auto const n = snapshot.naks(side, kind))
+                LOG_INFO("RapMetrics", "{} {} Naks: {}", getSideString(side), getMessageKindString(kind), n);
+        }
+        for (size_t c = 0; c < CounterCount; c++)
+            if (auto const n = snapshot.counter(side, Counter(c)))
+                LOG_INFO("RapMetrics", "{} {}: {}", getSideString(side), getCounterString(Counter(c)), n);
+        for (auto const& [status, count] : snapshot.naksByStatus(side))
+            LOG_INFO("RapMetrics", "{} Nak status 0x{:x}: {}", getSideString(side), status, count);
+        if (auto const n = snapshot.naksOtherStatus(side))
+            LOG_INFO("RapMetrics", "{} Nak status (other): {}", getSideString(side), n);
+    }
+}
+
+namespace {
+    struct PeriodicDumper
+    {
+        std::mutex mutex;
+        std::condition_variable_any cv;
+        std::jthread thread;
+    };
+    PeriodicDumper& periodicDumper()
+    {
+        static PeriodicDumper d;
+        return d;
+    }
+}
+
+void startPeriodicDump(std::chrono::milliseconds interval)
+{
+    stopPeriodicDump();
+    auto& d = periodicDumper();
+    LOG_INFO("RapMetrics", "Dumping RAP metrics every {}ms", interval.count());
+    d.thread = std::jthread([&d, interval](std::stop_token stoken) {
+        Threads::placeCurrentThread(Threads::Role::Metrics, "RapMetricsDump");
+        while (true) {
+            {
+                auto lock = std::unique_lock(d.mutex);
+                d.cv.wait_for(lock, stoken, interval, [] { return false; });
+            }
+            if (stoken.stop_requested())
+                return;
+            dumpToLog(takeSnapshot());
+            Threads::dumpSchedulingToLog(Threads::takeSchedulingSnapshot());
+        }
+    });
+}
+
+void stopPeriodicDump()
+{
+    auto& d = periodicDumper();
+    if (d.thread.joinable()) {
+        d.thread.request_stop();
+        d.thread.join();
+    }
+}
+
+}
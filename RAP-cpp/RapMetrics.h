@@ -0,0 +1,216 @@
+#pragma once
+#include <RAP/Serdes.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Always-on RAP client/server instrumentation.
+// Every thread that records gets its own block of histograms and counters; recording is a handful of relaxed atomic
+// stores with no locks or read-modify-write instructions. takeSnapshot() sums all the blocks from any thread.
+// A block outlives its thread so the samples stay in the totals, and is handed to the next thread that starts recording,
+// so memory is bounded by the most threads ever recording at once rather than by how many have come and gone.
+namespace RAP::Metrics {
+
+enum class Side : uint8_t
+{
+    Client,
+    Server,
+};
+inline constexpr size_t SideCount = 2;
+
+enum class MessageKind : uint8_t
+{
+    ReadSingle,
+    WriteSingle,
+    ReadSeq,
+    WriteSeq,
+    ReadComp,
+    WriteComp,
+    ReadModifyWrite,
+};
+inline constexpr size_t MessageKindCount = 7;
+
+enum class Phase : uint8_t
+{
+    Encode, // Serdes encode of the outgoing message
+    Wire,   // Sent until the matching response is received (includes the device)
+    Decode, // Serdes decode of the incoming message
+    Device, // Time spent in the register target servicing the command
+};
+inline constexpr size_t PhaseCount = 4;
+
+enum class Counter : uint8_t
+{
+    BytesSent,
+    BytesReceived,
+    Retries,
+    Timeouts,
+    DecodeFailures, // Bad length, unknown message type, ...; bad CRCs count as CrcFailures
+    CrcFailures,
+    Naks,
+};
+inline constexpr size_t CounterCount = 7;
+
+std::string_view getSideString(Side side);
+std::string_view getMessageKindString(MessageKind kind);
+std::string_view getPhaseString(Phase phase);
+std::string_view getCounterString(Counter counter);
+
+template <typename CmdType> struct MessageKindTrait;
+template <typename Cfg> struct MessageKindTrait<Serdes::ReadSingleCommand<Cfg>> { static constexpr MessageKind value = MessageKind::ReadSingle; };
+template <typename Cfg> struct MessageKindTrait<Serdes::WriteSingleCommand<Cfg>> { static constexpr MessageKind value = MessageKind::WriteSingle; };
+template <typename Cfg> struct MessageKindTrait<Serdes::ReadSeqCommand<Cfg>> { static constexpr MessageKind value = MessageKind::ReadSeq; };
+template <typename Cfg> struct MessageKindTrait<Serdes::WriteSeqCommand<Cfg>> { static constexpr MessageKind value = MessageKind::WriteSeq; };
+template <typename Cfg> struct MessageKindTrait<Serdes::ReadCompCommand<Cfg>> { static constexpr MessageKind value = MessageKind::ReadComp; };
+template <typename Cfg> struct MessageKindTrait<Serdes::WriteCompCommand<Cfg>> { static constexpr MessageKind value = MessageKind::WriteComp; };
+template <typename Cfg> struct MessageKindTrait<Serdes::ReadModifyWriteCommand<Cfg>> { static constexpr MessageKind value = MessageKind::ReadModifyWrite; };
+template <typename CmdType>
+inline constexpr MessageKind message_kind_v = MessageKindTrait<CmdType>::value;
+
+// Log-linear bucketing in the style of HdrHistogram: exact below 16ns, then 16 sub-buckets per power of two (~6% error),
+// saturating at 2^36ns (~68s).
+struct HistogramLayout
+{
+    static constexpr unsigned SubBucketBits = 4;
+    static constexpr uint64_t SubBucketCount = uint64_t(1) << SubBucketBits;
+    static constexpr unsigned MaxExponent = 36;
+    static constexpr size_t BucketCount = SubBucketCount + (MaxExponent - SubBucketBits) * SubBucketCount;
+
+    static constexpr size_t bucketIndex(uint64_t ns)
+    {
+        if (ns < SubBucketCount)
+            return static_cast<size_t>(ns);
+        unsigned const exponent = std::bit_width(ns) - 1;
+        if (exponent >= MaxExponent)
+            return BucketCount - 1;
+        auto const sub_bucket = (ns >> (exponent - SubBucketBits)) - SubBucketCount;
+        return static_cast<size_t>(SubBucketCount + (exponent - SubBucketBits) * SubBucketCount + sub_bucket);
+    }
+    // Highest value that lands in the given bucket
+    static constexpr uint64_t bucketUpperBound(size_t index)
+    {
+        if (index < SubBucketCount)
+            return index;
+        auto const exponent = (index - SubBucketCount) / SubBucketCount + SubBucketBits;
+        auto const sub_bucket = (index - SubBucketCount) % SubBucketCount;
+        auto const shift = exponent - SubBucketBits;
+        return ((SubBucketCount + sub_bucket) << shift) + ((uint64_t(1) << shift) - 1);
+    }
+};
+static_assert(HistogramLayout::bucketIndex(15) == 15);
+static_assert(HistogramLayout::bucketIndex(16) == 16);
+static_assert(HistogramLayout::bucketUpperBound(HistogramLayout::bucketIndex(1000)) >= 1000);
+static_assert(HistogramLayout::bucketUpperBound(HistogramLayout::bucketIndex(1000)) < 1000 + 1000 / 16);
+
+// Single-writer histogram; only the owning thread records into it.
+struct Histogram
+{
+    std::array<std::atomic<uint64_t>, HistogramLayout::BucketCount> buckets{};
+    std::atomic<uint64_t> count{};
+    std::atomic<uint64_t> sum_ns{};
+    std::atomic<uint64_t> max_ns{};
+
+    void record(uint64_t ns)
+    {
+        bump(this->buckets[HistogramLayout::bucketIndex(ns)], 1);
+        bump(this->count, 1);
+        bump(this->sum_ns, ns);
+        if (ns > this->max_ns.load(std::memory_order_relaxed))
+            this->max_ns.store(ns, std::memory_order_relaxed);
+    }
+
+    static void bump(std::atomic<uint64_t>& a, uint64_t n)
+    {
+        a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+};
+
+struct HistogramSnapshot
+{
+    std::array<uint64_t, HistogramLayout::BucketCount> buckets{};
+    uint64_t count = 0;
+    uint64_t sum_ns = 0;
+    uint64_t max_ns = 0;
+
+    void add(Histogram const& h);
+    // p in [0, 100]
+    uint64_t valueAtPercentile(double p) const;
+    uint64_t mean() const { return this->count ? this->sum_ns / this->count : 0; }
+};
+
+struct ThreadMetrics
+{
+    static constexpr size_t NakStatusSlots = 32;
+    struct NakStatusSlot
+    {
+        std::atomic<bool> used{};
+        std::atomic<uint64_t> status{};
+        std::atomic<uint64_t> count{};
+    };
+
+    std::array<std::array<std::array<Histogram, PhaseCount>, MessageKindCount>, SideCount> histograms{};
+    std::array<std::array<std::atomic<uint64_t>, CounterCount>, SideCount> counters{};
+    std::array<std::array<std::atomic<uint64_t>, MessageKindCount>, SideCount> naks_by_kind{};
+    std::array<std::array<NakStatusSlot, NakStatusSlots>, SideCount> naks_by_status{};
+    std::array<std::atomic<uint64_t>, SideCount> naks_other_status{};
+};
+
+// Claims a block for the calling thread on first use (the only time a lock is taken, along with thread exit).
+ThreadMetrics& threadMetrics();
+
+inline
+void recordLatency(Side side, MessageKind kind, Phase phase, std::chrono::nanoseconds duration)
+{
+    auto const ns = static_cast<uint64_t>(std::max<std::chrono::nanoseconds::rep>(duration.count(), 0));
+    threadMetrics().histograms[size_t(side)][size_t(kind)][size_t(phase)].record(ns);
+}
+
+inline
+void addCounter(Side side, Counter counter, uint64_t n = 1)
+{
+    Histogram::bump(threadMetrics().counters[size_t(side)][size_t(counter)], n);
+}
+
+void recordNak(Side side, MessageKind kind, uint64_t status);
+
+// The histograms live on the heap: all of them together are a couple of hundred KB, too much to pass around by value on a stack
+class Snapshot
+{
+public:
+    HistogramSnapshot const& histogram(Side side, MessageKind kind, Phase phase) const { return this->histograms[histogramIndex(side, kind, phase)]; }
+    uint64_t counter(Side side, Counter counter) const { return this->counters[size_t(side)][size_t(counter)]; }
+    uint64_t naks(Side side, MessageKind kind) const { return this->naks_by_kind[size_t(side)][size_t(kind)]; }
+    // (status, count), most frequent first; statuses that didn't fit in the per-thread table are reported as naksOtherStatus()
+    std::vector<std::pair<uint64_t, uint64_t>> const& naksByStatus(Side side) const { return this->naks_by_status[size_t(side)]; }
+    uint64_t naksOtherStatus(Side side) const { return this->naks_other_status[size_t(side)]; }
+
+private:
+    friend Snapshot takeSnapshot();
+
+    static constexpr size_t histogramIndex(Side side, MessageKind kind, Phase phase) { return (size_t(side) * MessageKindCount + size_t(kind)) * PhaseCount + size_t(phase); }
+
+    std::vector<HistogramSnapshot> histograms = std::vector<HistogramSnapshot>(SideCount * MessageKindCount * PhaseCount);
+    std::array<std::array<uint64_t, CounterCount>, SideCount> counters{};
+    std::array<std::array<uint64_t, MessageKindCount>, SideCount> naks_by_kind{};
+    std::array<std::vector<std::pair<uint64_t, uint64_t>>, SideCount> naks_by_status{};
+    std::array<uint64_t, SideCount> naks_other_status{};
+};
+
+Snapshot takeSnapshot();
+
+// Writes every non-empty histogram and counter to the global logger under the "RapMetrics" domain
+void dumpToLog(Snapshot const& snapshot);
+
+// Starts (or restarts) a background thread that calls dumpToLog(takeSnapshot()) every interval, followed by the
+// scheduling counters of every thread placed through ThreadPlacement.h
+void startPeriodicDump(std::chrono::milliseconds interval);
+void stopPeriodicDump();
+
+}
@@ -0,0 +1,65 @@
+#include "RapMetrics.h"
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+TEST_CASE("RAP metrics histogram buckets", "[metrics]")
+{
+    using RAP::Metrics::HistogramLayout;
+    for (uint64_t v : { 0ULL, 1ULL, 15ULL, 16ULL, 17ULL, 31ULL, 32ULL, 1000ULL, 123456ULL, 987654321ULL }) {
+        auto const idx = HistogramLayout::bucketIndex(v);
+        CHECK(HistogramLayout::bucketUpperBound(idx) >= v);
+        CHECK(HistogramLayout::bucketUpperBound(idx) - v <= v / HistogramLayout::SubBucketCount);
+        if (idx > 0)
+            CHECK(HistogramLayout::bucketUpperBound(idx - 1) < v);
+    }
+    CHECK(HistogramLayout::bucketIndex(~uint64_t(0)) == HistogramLayout::BucketCount - 1);
+}
+
+TEST_CASE("RAP metrics histogram percentiles", "[metrics]")
+{
+    auto h = std::make_unique<RAP::Metrics::Histogram>();
+    for (uint64_t v = 1; v <= 1000; v++)
+        h->record(v * 1000);
+    RAP::Metrics::HistogramSnapshot snap;
+    snap.add(*h);
+    CHECK(snap.count == 1000);
+    CHECK(snap.max_ns == 1000000);
+    CHECK(snap.mean() == 500500);
+    auto const within = [](uint64_t actual, uint64_t expected) { return actual >= expected && actual <= expected + expected / 16; };
+    CHECK(within(snap.valueAtPercentile(50), 500000));
+    CHECK(within(snap.valueAtPercentile(99), 990000));
+    CHECK(snap.valueAtPercentile(100) == 1000000);
+}
+
+TEST_CASE("RAP metrics counters and snapshot", "[metrics]")
+{
+    using namespace RAP::Metrics;
+    auto const before = takeSnapshot();
+    addCounter(Side::Server, Counter::Retries, 3);
+    addCounter(Side::Client, Counter::CrcFailures);
+    recordNak(Side::Server, MessageKind::WriteComp, 0xBAD);
+    recordLatency(Side::Server, MessageKind::WriteComp, Phase::Device, std::chrono::microseconds(5));
+    auto const after = takeSnapshot();
+    CHECK(after.counter(Side::Server, Counter::Retries) - before.counter(Side::Server, Counter::Retries) == 3);
+    CHECK(after.counter(Side::Server, Counter::Naks) - before.counter(Side::Server, Counter::Naks) == 1);
+    CHECK(after.counter(Side::Client, Counter::CrcFailures) - before.counter(Side::Client, Counter::CrcFailures) == 1);
+    CHECK(after.counter(Side::Client, Counter::DecodeFailures) == before.counter(Side::Client, Counter::DecodeFailures));
+    CHECK(getCounterString(Counter::CrcFailures) == "CrcFailures");
+    CHECK(after.naks(Side::Server, MessageKind::WriteComp) - before.naks(Side::Server, MessageKind::WriteComp) == 1);
+    CHECK(after.histogram(Side::Server, MessageKind::WriteComp, Phase::Device).count - before.histogram(Side::Server, MessageKind::WriteComp, Phase::Device).count == 1);
+    auto const& statuses = after.naksByStatus(Side::Server);
+    CHECK(std::find_if(statuses.begin(), statuses.end(), [](auto const& e) { return e.first == 0xBAD; }) != statuses.end());
+}
+
+TEST_CASE("RAP metrics outlive the recording thread", "[metrics]")
+{
+    using namespace RAP::Metrics;
+    auto const before = takeSnapshot();
+    // Each thread's block goes back to the pool when it exits and the next one carries on in it; nothing is lost either way
+    for (int i = 0; i < 4; i++)
+        std::thread([]() { recordLatency(Side::Client, MessageKind::ReadSeq, Phase::Wire, std::chrono::microseconds(7)); }).join();
+    auto const after = takeSnapshot();
+    CHECK(after.histogram(Side::Client, MessageKind::ReadSeq, Phase::Wire).count - before.histogram(Side::Client, MessageKind::ReadSeq, Phase::Wire).count == 4);
+}
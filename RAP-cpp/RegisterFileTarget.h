@@ -0,0 +1,166 @@
+#pragma once
+#include <RTF/RTF.h>
+#include <YALF/YALF.h>
+#include "BinaryLog.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <format>
+#include <stdexcept>
+#include <vector>
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <xmmintrin.h>
+#endif
+
+// Register file modelled as a flat array: register i lives at base_addr + i * stride.
+// Unlike AdvDummyRegisterTarget's hash map, every access is index arithmetic plus an array access, seqWrite/seqRead
+// with a unit stride are a single copy, and compWrite/compRead compute and prefetch a batch of register slots before
+// touching any of them, so a large scattered batch overlaps its cache misses instead of taking them one at a time.
+// Addresses outside the file (or not on a register boundary) throw std::out_of_range, which the server NAKs.
+template <typename AddressType, typename DataType>
+class RegisterFileTarget : public RTF::IRegisterTarget<AddressType, DataType>
+{
+public:
+    RegisterFileTarget(std::string_view name, AddressType base_addr, size_t register_count, size_t stride = sizeof(DataType))
+        : RTF::IRegisterTarget<AddressType, DataType>(name)
+        , regs(register_count)
+        , base_addr(base_addr)
+        , stride(stride)
+        , stride_shift(std::has_single_bit(stride) ? std::countr_zero(stride) : -1)
+    {
+        if (stride == 0)
+            throw std::invalid_argument("RegisterFileTarget stride must be non-zero");
+    }
+    virtual std::string_view getDomain() const override { return "RegisterFileTarget"; }
+
+    virtual void write(AddressType addr, DataType data) override
+    {
+        BLOG_NOISE(this, "write(0x{:0{}x}, 0x{:0{}x})", addr, sizeof(AddressType) * 2, data, sizeof(DataType) * 2);
+        this->regs[this->indexOf(addr)] = data;
+    }
+    virtual DataType read(AddressType addr) override
+    {
+        DataType const rv = this->regs[this->indexOf(addr)];
+        BLOG_NOISE(this, "read(0x{:0{}x}) -> 0x{:0{}x}", addr, sizeof(AddressType) * 2, rv, sizeof(DataType) * 2);
+        return rv;
+    }
+    virtual void readModifyWrite(AddressType addr, DataType new_data, DataType mask) override
+    {
+        BLOG_NOISE(this, "readModifyWrite(0x{:0{}x}, 0x{:0{}x}, 0x{:0{}x})", addr, sizeof(AddressType) * 2, new_data, sizeof(DataType) * 2, mask, sizeof(DataType) * 2);
+        auto& reg = this->regs[this->indexOf(addr)];
+        reg = static_cast<DataType>((reg & ~mask) | (new_data & mask));
+    }
+    virtual void seqWrite(AddressType start_addr, std::span<DataType const> data, size_t increment = sizeof(DataType)) override
+    {
+        BLOG_NOISE(this, "seqWrite(0x{:0{}x}, {}.., {})", start_addr, sizeof(AddressType) * 2, data.size(), increment);
+        if (data.empty())
+            return;
+        if (increment == this->stride) {
+            auto const first = this->rangeOf(start_addr, data.size());
+            std::copy(data.begin(), data.end(), this->regs.begin() + first);
+            return;
+        }
+        for (size_t i = 0; i < data.size(); i++)
+            this->regs[this->indexOf(static_cast<AddressType>(start_addr + increment * i))] = data[i];
+    }
+    virtual void seqRead(AddressType start_addr, std::span<DataType> out_data, size_t increment = sizeof(DataType)) override
+    {
+        BLOG_NOISE(this, "seqRead(0x{:0{}x}, {}.., {})", start_addr, sizeof(AddressType) * 2, out_data.size(), increment);
+        if (out_data.empty())
+            return;
+        if (increment == this->stride) {
+            auto const first = this->rangeOf(start_addr, out_data.size());
+            std::copy_n(this->regs.begin() + first, out_data.size(), out_data.begin());
+            return;
+        }
+        for (size_t i = 0; i < out_data.size(); i++)
+            out_data[i] = this->regs[this->indexOf(static_cast<AddressType>(start_addr + increment * i))];
+    }
+    // A plain register keeps only the last value written and reads back the same value every time
+    virtual void fifoWrite(AddressType fifo_addr, std::span<DataType const> data) override
+    {
+        BLOG_NOISE(this, "fifoWrite(0x{:0{}x}, {}..)", fifo_addr, sizeof(AddressType) * 2, data.size());
+        auto const index = this->indexOf(fifo_addr);
+        if (!data.empty())
+            this->regs[index] = data.back();
+    }
+    virtual void fifoRead(AddressType fifo_addr, std::span<DataType> out_data) override
+    {
+        BLOG_NOISE(this, "fifo_read(0x{:0{}x}, {}..)", fifo_addr, sizeof(AddressType) * 2, out_data.size());
+        std::fill(out_data.begin(), out_data.end(), this->regs[this->indexOf(fifo_addr)]);
+    }
+    virtual void compWrite(std::span<std::pair<AddressType, DataType> const> addr_data) override
+    {
+        BLOG_NOISE(this, "compWrite({}..)", addr_data.size());
+        std::array<DataType*, PrefetchBatch> slots;
+        for (size_t offset = 0; offset < addr_data.size(); offset += PrefetchBatch) {
+            auto const batch = addr_data.subspan(offset, std::min(PrefetchBatch, addr_data.size() - offset));
+            for (size_t i = 0; i < batch.size(); i++) {
+                slots[i] = &this->regs[this->indexOf(batch[i].first)];
+                prefetch(slots[i]);
+            }
+            // In order, so a repeated address still ends up with its last value
+            for (size_t i = 0; i < batch.size(); i++)
+                *slots[i] = batch[i].second;
+        }
+    }
+    virtual void compRead(std::span<AddressType const> const addresses, std::span<DataType> out_data) override
+    {
+        assert(addresses.size() == out_data.size());
+        BLOG_NOISE(this, "compRead({}..)", addresses.size());
+        std::array<DataType const*, PrefetchBatch> slots;
+        for (size_t offset = 0; offset < addresses.size(); offset += PrefetchBatch) {
+            auto const batch = addresses.subspan(offset, std::min(PrefetchBatch, addresses.size() - offset));
+            for (size_t i = 0; i < batch.size(); i++) {
+                slots[i] = &this->regs[this->indexOf(batch[i])];
+                prefetch(slots[i]);
+            }
+            for (size_t i = 0; i < batch.size(); i++)
+                out_data[offset + i] = *slots[i];
+        }
+    }
+
+    std::span<DataType const> registers() const { return this->regs; }
+    std::span<DataType> registers() { return this->regs; }
+
+private:
+    static constexpr size_t PrefetchBatch = 16;
+
+    static void prefetch(void const* p)
+    {
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+        _mm_prefetch(static_cast<char const*>(p), _MM_HINT_T0);
+#elif defined(__GNUC__)
+        __builtin_prefetch(p, 1);
+#else
+        (void)p;
+#endif
+    }
+
+    size_t indexOf(AddressType addr) const
+    {
+        auto const a = static_cast<uint64_t>(addr);
+        auto const offset = a - static_cast<uint64_t>(this->base_addr);
+        // Strides are almost always a power of two; a shift and mask is several times cheaper than the divisions
+        auto const aligned = this->stride_shift >= 0 ? (offset & (this->stride - 1)) == 0 : offset % this->stride == 0;
+        auto const index = this->stride_shift >= 0 ? offset >> this->stride_shift : offset / this->stride;
+        if (a < this->base_addr || !aligned || index >= this->regs.size())
+            throw std::out_of_range(std::format("{}: address 0x{:x} is not a register in this file", this->getName(), a));
+        return static_cast<size_t>(index);
+    }
+    // Index of the first of count consecutive registers, all of which must be in the file
+    size_t rangeOf(AddressType start_addr, size_t count) const
+    {
+        auto const first = this->indexOf(start_addr);
+        if (count > this->regs.size() - first)
+            throw std::out_of_range(std::format("{}: {} registers from 0x{:x} run past the end of this file", this->getName(), count, static_cast<uint64_t>(start_addr)));
+        return first;
+    }
+
+    std::vector<DataType> regs;
+    AddressType base_addr;
+    size_t stride;
+    int stride_shift; // -1 if the stride isn't a power of two
+};
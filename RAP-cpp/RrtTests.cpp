@@ -1,84 +1,10 @@
 #include <RAP/RegisterTarget.h>
 #include <RAP/ServerAdapter.h>
+#include "AdvDummyRegisterTarget.h"
 #include <YALF/YALF.h>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/generators/catch_generators_all.hpp>
 
-template <typename AddressType, typename DataType>
-class AdvDummyRegisterTarget : public RTF::IRegisterTarget<AddressType, DataType>
-{
-public:
-    AdvDummyRegisterTarget(std::string_view name)
-        : RTF::IRegisterTarget<AddressType, DataType>(name)
-    {}
-    virtual std::string_view getDomain() const override { return "AdvDummyRegisterTarget"; }
-
-    virtual void write(AddressType addr, DataType data) override
-    {
-        LOG_NOISE(this, "write(0x{:0{}x}, 0x{:0{}x})", addr, sizeof(AddressType) * 2, data, sizeof(DataType) * 2);
-        this->regs[addr] = data;
-    }
-    virtual DataType read(AddressType addr) override
-    {
-        DataType const rv = this->regs[addr];
-        LOG_NOISE(this, "read(0x{:0{}x}) -> 0x{:0{}x}", addr, sizeof(AddressType) * 2, rv, sizeof(DataType) * 2);
-        return rv;
-    }
-    virtual void readModifyWrite(AddressType addr, DataType new_data, DataType mask) override
-    {
-        LOG_NOISE(this, "readModifyWrite(0x{:0{}x}, 0x{:0{}x}, 0x{:0{}x})", addr, sizeof(AddressType) * 2, new_data, sizeof(DataType) * 2, mask, sizeof(DataType) * 2);
-        DataType v = this->regs[addr];
-        v &= ~mask;
-        v |= new_data & mask;
-        this->regs[addr] = v;
-    }
-    virtual void seqWrite(AddressType start_addr, std::span<DataType const> data, size_t increment = sizeof(DataType)) override
-    {
-        LOG_NOISE(this, "seqWrite(0x{:0{}x}, {}.., {})", start_addr, sizeof(AddressType) * 2, data.size(), increment);
-        for (size_t i = 0; i < data.size(); i++) {
-            this->regs[start_addr + (increment * i)] = data[i];
-        }
-    }
-    virtual void seqRead(AddressType start_addr, std::span<DataType> out_data, size_t increment = sizeof(DataType)) override
-    {
-        LOG_NOISE(this, "seqRead(0x{:0{}x}, {}.., {})", start_addr, sizeof(AddressType) * 2, out_data.size(), increment);
-        for (size_t i = 0; i < out_data.size(); i++) {
-            out_data[i] = this->regs[start_addr + (increment * i)];
-        }
-    }
-    virtual void fifoWrite(AddressType fifo_addr, std::span<DataType const> data) override
-    {
-        LOG_NOISE(this, "fifoWrite(0x{:0{}x}, {}..)", fifo_addr, sizeof(AddressType) * 2, data.size());
-        for (auto const d : data) {
-            this->regs[fifo_addr] = d;
-        }
-    }
-    virtual void fifoRead(AddressType fifo_addr, std::span<DataType> out_data) override
-    {
-        LOG_NOISE(this, "fifo_read(0x{:0{}x}, {}..)", fifo_addr, sizeof(AddressType) * 2, out_data.size());
-        for (auto& d : out_data) {
-            d = this->regs[fifo_addr];
-        }
-    }
-    virtual void compWrite(std::span<std::pair<AddressType, DataType> const> addr_data) override
-    {
-        LOG_NOISE(this, "compWrite({}..)", addr_data.size());
-        for (auto const ad : addr_data) {
-            this->regs[ad.first] = ad.second;
-        }
-    }
-    virtual void compRead(std::span<AddressType const> const addresses, std::span<DataType> out_data) override
-    {
-        assert(addresses.size() == out_data.size());
-        LOG_NOISE(this, "compRead({}..)", addresses.size());
-        for (size_t i = 0; i < addresses.size(); i++) {
-            out_data[i] = this->regs[addresses[i]];
-        }
-    }
-protected:
-    std::unordered_map<AddressType, DataType> regs;
-};
-
 struct RapCfg {
     using AddressType = uint32_t;
     static constexpr uint8_t AddressBits = 8;
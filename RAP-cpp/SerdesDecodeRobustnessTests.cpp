@@ -0,0 +1,179 @@
+#include <RAP/Serdes.h>
+#include "CheckedDecode.h"
+#include "SerdesTestCfgs.h"
+#include <YALF/YALF.h>
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <optional>
+#include <vector>
+
+template <RAP::IsConfigurationType Cfg>
+static
+std::vector<std::byte> encodeValidCommand()
+{
+    auto serdes = RAP::Serdes::Serdes<Cfg>(4096);
+    auto const buf = serdes.encodeCommand(RAP::Serdes::WriteSingleCommand<Cfg>{ .transaction_id = 7, .posted = false, .addr = 0x10, .data = 0x5A });
+    auto const bytes = std::as_bytes(std::span{ buf });
+    return { bytes.begin(), bytes.end() };
+}
+
+template <RAP::IsConfigurationType Cfg>
+static
+void checkRejections()
+{
+    using RAP::Serdes::DecodeStatus;
+    using WireFormat = RAP::Serdes::WireFormat<Cfg>;
+    auto decoder = RAP::Serdes::CheckedDecoder<Cfg>(4096);
+    typename RAP::Serdes::CheckedDecoder<Cfg>::CommandType cmd;
+    auto const valid = encodeValidCommand<Cfg>();
+
+    CHECK(decoder.tryDecodeCommand(valid, cmd) == DecodeStatus::Ok);
+    CHECK(std::get<RAP::Serdes::WriteSingleCommand<Cfg>>(cmd).data == 0x5A);
+    CHECK(decoder.minCommandSize() <= valid.size());
+    if constexpr (WireFormat::checks_lengths)
+        CHECK(WireFormat::expectedCommandSize(valid) == valid.size());
+
+    CHECK(decoder.tryDecodeCommand({}, cmd) == DecodeStatus::Empty);
+    CHECK(decoder.tryDecodeCommand(std::span{ valid }.first(decoder.minCommandSize() - 1), cmd) == DecodeStatus::Truncated);
+    CHECK(decoder.tryDecodeCommand(std::vector<std::byte>(4097), cmd) == DecodeStatus::Oversized);
+
+    auto bad_crc = valid;
+    bad_crc.back() ^= std::byte{ 0xFF };
+    // Without a stated FrameDefinition these reach Serdes, which rejects them by throwing
+    CHECK(decoder.tryDecodeCommand(bad_crc, cmd) == (WireFormat::checks_crc ? DecodeStatus::BadCrc : DecodeStatus::Malformed));
+
+    auto bad_length = valid;
+    bad_length.push_back(std::byte{ 0 });
+    CHECK(decoder.tryDecodeCommand(bad_length, cmd) == (WireFormat::checks_lengths ? DecodeStatus::BadLength : DecodeStatus::Malformed));
+
+    // A count field promising one more item than the frame carries
+    auto const seq_buf = decoder.getSerdes().encodeCommand(RAP::Serdes::WriteSeqCommand<Cfg>{
+        .transaction_id = 8,
+        .posted = false,
+        .start_addr = 0x20,
+        .increment = 0, // FIFO
+        .data = std::vector<typename Cfg::DataType>{ 0x11, 0x22, 0x33 },
+    });
+    auto const seq_bytes = std::as_bytes(std::span{ seq_buf });
+    auto short_seq = std::vector<std::byte>(seq_bytes.begin(), seq_bytes.end());
+    CHECK(decoder.tryDecodeCommand(short_seq, cmd) == DecodeStatus::Ok);
+    short_seq.erase(short_seq.end() - Cfg::CrcBytes - Cfg::DataBytes, short_seq.end() - Cfg::CrcBytes);
+    CHECK(decoder.tryDecodeCommand(short_seq, cmd) == (WireFormat::checks_lengths ? DecodeStatus::BadLength : DecodeStatus::Malformed));
+}
+
+TEST_CASE("Checked decode reports rejections as status codes", "[serdes]")
+{
+    checkRejections<RAP::ExampleRapCfg>();
+    checkRejections<Rap_A24D32L2C2>();
+    checkRejections<Rap_A8D8L1C1>();
+    checkRejections<Rap_A48D64L2C4>();
+}
+
+// A Cfg with a made-up FrameDefinition. Every frame below breaks it, so none reaches Serdes, which knows nothing of it.
+struct Rap_StatedFrame : RAP::ExampleRapCfg {};
+template <>
+struct RAP::Serdes::FrameDefinition<Rap_StatedFrame>
+{
+    static constexpr size_t type_offset = 0;
+    static constexpr std::optional<FrameLength> commandLength(uint8_t type)
+    {
+        if (type == 0x01)
+            return FrameLength{ .size = 8 };
+        if (type == 0x02)
+            return FrameLength{ .size = 8, .item = 4, .count_offset = 5, .count_big_endian = true };
+        return std::nullopt;
+    }
+    static constexpr std::optional<FrameLength> responseLength(uint8_t) { return std::nullopt; }
+    static constexpr size_t crc_first = 0;
+    static constexpr bool crc_big_endian = false;
+    static auto const& crcParameters() { return CRC::CRC_16_ARC(); }
+};
+
+TEST_CASE("Checked decode enforces a stated frame definition before Serdes", "[serdes]")
+{
+    using RAP::Serdes::DecodeStatus;
+    using WireFormat = RAP::Serdes::WireFormat<Rap_StatedFrame>;
+    static_assert(WireFormat::checks_lengths && WireFormat::checks_crc);
+    auto decoder = RAP::Serdes::CheckedDecoder<Rap_StatedFrame>(4096);
+    typename RAP::Serdes::CheckedDecoder<Rap_StatedFrame>::CommandType cmd;
+
+    auto fixed = std::vector<std::byte>(9, std::byte{ 0 });
+    fixed[0] = std::byte{ 0x01 };
+    CHECK(WireFormat::expectedCommandSize(fixed) == 8);
+    CHECK(decoder.tryDecodeCommand(fixed, cmd) == DecodeStatus::BadLength);
+
+    // Two items: 8 + 2 * 4 bytes, with the count big-endian at bytes 5 and 6
+    auto counted = std::vector<std::byte>(16, std::byte{ 0 });
+    counted[0] = std::byte{ 0x02 };
+    counted[6] = std::byte{ 0x02 };
+    CHECK(WireFormat::expectedCommandSize(counted) == 16);
+    counted.pop_back();
+    CHECK(decoder.tryDecodeCommand(counted, cmd) == DecodeStatus::BadLength);
+    counted.push_back(std::byte{ 0 });
+
+    // Right size, wrong CRC
+    auto const crc = CRC::Calculate(counted.data(), counted.size() - 2, CRC::CRC_16_ARC());
+    counted[14] = static_cast<std::byte>(crc ^ 0xFF);
+    counted[15] = static_cast<std::byte>(crc >> 8);
+    CHECK_FALSE(WireFormat::crcMatches(counted));
+    CHECK(decoder.tryDecodeCommand(counted, cmd) == DecodeStatus::BadCrc);
+    counted[14] = static_cast<std::byte>(crc);
+    CHECK(WireFormat::crcMatches(counted));
+}
+
+template <RAP::IsConfigurationType Cfg>
+static
+void measureRejection(std::string_view cfg_name)
+{
+    constexpr size_t iterations = 100000;
+    using Clock = std::chrono::steady_clock;
+    auto serdes = RAP::Serdes::Serdes<Cfg>(4096);
+    auto decoder = RAP::Serdes::CheckedDecoder<Cfg>(4096);
+    using BufferType = typename RAP::Serdes::CheckedDecoder<Cfg>::BufferType;
+    using ElementType = typename BufferType::value_type;
+    auto const valid = encodeValidCommand<Cfg>();
+
+    auto bad_crc = valid;
+    bad_crc.back() ^= std::byte{ 0xFF };
+    auto bad_length = valid;
+    bad_length.push_back(std::byte{ 0 });
+    auto truncated = std::vector<std::byte>(valid.begin(), valid.begin() + (decoder.minCommandSize() - 1));
+
+    for (auto const& [frame_name, frame] : { std::pair{ "bad CRC", &bad_crc }, std::pair{ "bad length", &bad_length }, std::pair{ "truncated", &truncated } }) {
+        auto const* const p = reinterpret_cast<ElementType const*>(frame->data());
+        auto const buf = BufferType(p, p + frame->size() / sizeof(ElementType));
+
+        size_t thrown = 0;
+        auto const throwing_start = Clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            try {
+                auto const cmd = serdes.decodeCommand(buf);
+            }
+            catch (std::exception const&) {
+                thrown++;
+            }
+        }
+        auto const throwing_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - throwing_start).count();
+
+        size_t rejected = 0;
+        typename RAP::Serdes::CheckedDecoder<Cfg>::CommandType cmd;
+        auto const checked_start = Clock::now();
+        for (size_t i = 0; i < iterations; i++)
+            if (decoder.tryDecodeCommand(*frame, cmd) != RAP::Serdes::DecodeStatus::Ok)
+                rejected++;
+        auto const checked_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - checked_start).count();
+
+        CHECK(thrown == iterations);
+        CHECK(rejected == iterations);
+        LOG_INFO(cfg_name, "{:>10}: throwing {:>6.1f} ns/frame, tryDecode {:>6.1f} ns/frame",
+            frame_name, double(throwing_ns) / iterations, double(checked_ns) / iterations);
+    }
+}
+
+TEST_CASE("Measure corrupt frame rejection cost", "[Explore][serdes]")
+{
+    measureRejection<RAP::ExampleRapCfg>("RAP::ExampleRapCfg");
+    measureRejection<Rap_A24D32L2C2>("Rap_A24D32L2C2");
+    measureRejection<Rap_A8D8L1C1>("Rap_A8D8L1C1");
+    measureRejection<Rap_A48D64L2C4>("Rap_A48D64L2C4");
+}
@@ -1,41 +1,8 @@
+#pragma once
 #include <RAP/Serdes.h>
-#include <YALF/YALF.h>
-#include <catch2/catch_test_macros.hpp>
-#include <catch2/generators/catch_generators_all.hpp>
+#include <cstdint>
 
-template <RAP::IsConfigurationType Cfg, typename CmdType>
-static inline
-void checkCmd(CmdType const& in)
-{
-    auto serdes = RAP::Serdes::Serdes<Cfg>(256);
-    //LOG_INFO(&in, "Checking");
-    auto const buf = serdes.encodeCommand(in);
-    auto const out = serdes.decodeCommand(buf);
-    auto const buf2 = serdes.encodeCommand(out);
-    //REQUIRE(in == out);
-    REQUIRE(buf == buf2);
-}
-
-template <RAP::IsConfigurationType Cfg, typename RespType>
-static inline
-void checkResp(RespType const& in)
-{
-    auto serdes = RAP::Serdes::Serdes<Cfg>(256);
-    //LOG_INFO(&in, "Checking");
-    auto const buf = serdes.encodeResponse(in);
-    auto const out = serdes.decodeResponse(buf);
-    auto const buf2 = serdes.encodeResponse(out);
-    //REQUIRE(in == out);
-    REQUIRE(buf == buf2);
-}
-
-#define GEN_TXN_ID     GENERATE(Catch::Generators::take(8, Catch::Generators::random<uint8_t>(0, 0xff)))
-#define GEN_ADDR       GENERATE(Catch::Generators::take(1, Catch::Generators::random<CFG::AddressType>(0, (1ULL << CFG::AddressBits) - 1)))
-#define GEN_DATA       GENERATE(Catch::Generators::take(1, Catch::Generators::random<CFG::DataType>(0, (1ULL << CFG::DataBits) - 1)))
-#define GEN_ADDR_RNG   GENERATE(Catch::Generators::take(1, Catch::Generators::chunk(8, Catch::Generators::random<CFG::AddressType>(0, (1ULL << CFG::AddressBits) - 1))))
-#define GEN_DATA_RNG   GENERATE(Catch::Generators::take(1, Catch::Generators::chunk(8, Catch::Generators::random<CFG::DataType>(0, (1ULL << CFG::DataBits) - 1))))
-#define GEN_POSTED     GENERATE(false, true)
-#define GEN_COUNT      GENERATE(uint8_t(31)) // Rap_A48D64L2C4 ReadSeqCommand has a limit of 31
+// Wire configurations the Serdes tests, fuzzer and benchmarks all run against (alongside RAP::ExampleRapCfg)
 
 struct Rap_A24D32L2C2 {
     using AddressType = uint32_t;
@@ -97,23 +64,8 @@ struct Rap_A48D64L2C4 {
 };
 static_assert(RAP::IsConfigurationType<Rap_A48D64L2C4>);
 
-#define CFG RAP::ExampleRapCfg
-#define CFG_NAME "RAP::ExampleRapCfg"
-#include "SerdesTestsTemplate.inc"
-#undef CFG
-#undef CFG_NAME
-#define CFG Rap_A24D32L2C2
-#define CFG_NAME "Rap_A24D32L2C2"
-#include "SerdesTestsTemplate.inc"
-#undef CFG
-#undef CFG_NAME
-#define CFG Rap_A8D8L1C1
-#define CFG_NAME "Rap_A8D8L1C1"
-#include "SerdesTestsTemplate.inc"
-#undef CFG
-#undef CFG_NAME
-#define CFG Rap_A48D64L2C4
-#define CFG_NAME "Rap_A48D64L2C4"
-#include "SerdesTestsTemplate.inc"
-#undef CFG
-#undef CFG_NAME
+// Explicitly instantiated once each, in the matching SerdesTests_*.cpp, so including this header doesn't recompile Serdes<Cfg>
+extern template class RAP::Serdes::Serdes<RAP::ExampleRapCfg>;
+extern template class RAP::Serdes::Serdes<Rap_A24D32L2C2>;
+extern template class RAP::Serdes::Serdes<Rap_A8D8L1C1>;
+extern template class RAP::Serdes::Serdes<Rap_A48D64L2C4>;
@@ -0,0 +1,41 @@
+#pragma once
+#include <RAP/Serdes.h>
+#include "SerdesTestCfgs.h"
+#include <YALF/YALF.h>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators_all.hpp>
+
+template <RAP::IsConfigurationType Cfg, typename CmdType>
+static inline
+void checkCmd(CmdType const& in)
+{
+    auto serdes = RAP::Serdes::Serdes<Cfg>(256);
+    //LOG_INFO(&in, "Checking");
+    auto const buf = serdes.encodeCommand(in);
+    auto const out = serdes.decodeCommand(buf);
+    auto const buf2 = serdes.encodeCommand(out);
+    //REQUIRE(in == out);
+    REQUIRE(buf == buf2);
+}
+
+template <RAP::IsConfigurationType Cfg, typename RespType>
+static inline
+void checkResp(RespType const& in)
+{
+    auto serdes = RAP::Serdes::Serdes<Cfg>(256);
+    //LOG_INFO(&in, "Checking");
+    auto const buf = serdes.encodeResponse(in);
+    auto const out = serdes.decodeResponse(buf);
+    auto const buf2 = serdes.encodeResponse(out);
+    //REQUIRE(in == out);
+    REQUIRE(buf == buf2);
+}
+
+// Shared by the per-Cfg SerdesTests_*.cpp translation units, each of which includes SerdesTestsTemplate.inc once
+#define GEN_TXN_ID     GENERATE(Catch::Generators::take(8, Catch::Generators::random<uint8_t>(0, 0xff)))
+#define GEN_ADDR       GENERATE(Catch::Generators::take(1, Catch::Generators::random<CFG::AddressType>(0, (1ULL << CFG::AddressBits) - 1)))
+#define GEN_DATA       GENERATE(Catch::Generators::take(1, Catch::Generators::random<CFG::DataType>(0, (1ULL << CFG::DataBits) - 1)))
+#define GEN_ADDR_RNG   GENERATE(Catch::Generators::take(1, Catch::Generators::chunk(8, Catch::Generators::random<CFG::AddressType>(0, (1ULL << CFG::AddressBits) - 1))))
+#define GEN_DATA_RNG   GENERATE(Catch::Generators::take(1, Catch::Generators::chunk(8, Catch::Generators::random<CFG::DataType>(0, (1ULL << CFG::DataBits) - 1))))
+#define GEN_POSTED     GENERATE(false, true)
+#define GEN_COUNT      GENERATE(uint8_t(31)) // Rap_A48D64L2C4 ReadSeqCommand has a limit of 31
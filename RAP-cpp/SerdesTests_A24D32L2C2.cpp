@@ -0,0 +1,10 @@
+#include "SerdesTestsCommon.h"
+
+// This TU owns the one instantiation of Serdes<Rap_A24D32L2C2>; SerdesTestCfgs.h declares it extern everywhere else
+template class RAP::Serdes::Serdes<Rap_A24D32L2C2>;
+
+#define CFG Rap_A24D32L2C2
+#define CFG_NAME "Rap_A24D32L2C2"
+#include "SerdesTestsTemplate.inc"
+#undef CFG
+#undef CFG_NAME
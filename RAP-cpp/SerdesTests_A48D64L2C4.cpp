@@ -0,0 +1,10 @@
+#include "SerdesTestsCommon.h"
+
+// This TU owns the one instantiation of Serdes<Rap_A48D64L2C4>; SerdesTestCfgs.h declares it extern everywhere else
+template class RAP::Serdes::Serdes<Rap_A48D64L2C4>;
+
+#define CFG Rap_A48D64L2C4
+#define CFG_NAME "Rap_A48D64L2C4"
+#include "SerdesTestsTemplate.inc"
+#undef CFG
+#undef CFG_NAME
@@ -0,0 +1,10 @@
+#include "SerdesTestsCommon.h"
+
+// This TU owns the one instantiation of Serdes<Rap_A8D8L1C1>; SerdesTestCfgs.h declares it extern everywhere else
+template class RAP::Serdes::Serdes<Rap_A8D8L1C1>;
+
+#define CFG Rap_A8D8L1C1
+#define CFG_NAME "Rap_A8D8L1C1"
+#include "SerdesTestsTemplate.inc"
+#undef CFG
+#undef CFG_NAME
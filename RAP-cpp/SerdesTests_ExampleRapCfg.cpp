@@ -0,0 +1,10 @@
+#include "SerdesTestsCommon.h"
+
+// This TU owns the one instantiation of Serdes<RAP::ExampleRapCfg>; SerdesTestCfgs.h declares it extern everywhere else
+template class RAP::Serdes::Serdes<RAP::ExampleRapCfg>;
+
+#define CFG RAP::ExampleRapCfg
+#define CFG_NAME "RAP::ExampleRapCfg"
+#include "SerdesTestsTemplate.inc"
+#undef CFG
+#undef CFG_NAME
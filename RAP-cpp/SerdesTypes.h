@@ -0,0 +1,17 @@
+#pragma once
+#include <RAP/Serdes.h>
+#include <utility>
+
+namespace RAP::Serdes {
+
+// Names for the types Serdes<Cfg> produces, for code that has to store or forward them
+template <IsConfigurationType Cfg>
+struct SerdesTypes
+{
+    using BufferType = decltype(std::declval<Serdes<Cfg>&>().encodeCommand(ReadSingleCommand<Cfg>{}));
+    using CommandType = decltype(std::declval<Serdes<Cfg>&>().decodeCommand(std::declval<BufferType const&>()));
+    using ResponseType = decltype(std::declval<Serdes<Cfg>&>().decodeResponse(std::declval<BufferType const&>()));
+    using TransactionIdType = decltype(ReadSingleCommand<Cfg>{}.transaction_id);
+};
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <RAP/Serdes.h>
+#include <RTF/RTF.h>
+#include <YALF/YALF.h>
+#include "SerdesTypes.h"
+#include <optional>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace RAP::RTF {
+
+// Status reported in a NAK when the register target throws while servicing a command
+inline constexpr uint64_t NakStatusTargetException = 1;
+
+// Executes one decoded command against a register target and builds its response, the way a RAP server does.
+// Returns std::nullopt for posted writes, which get no response.
+template <IsConfigurationType Cfg>
+std::optional<typename Serdes::SerdesTypes<Cfg>::ResponseType> executeCommand(::RTF::IRegisterTarget<typename Cfg::AddressType, typename Cfg::DataType>& target, typename Serdes::SerdesTypes<Cfg>::CommandType const& command)
+{
+    using namespace RAP::Serdes;
+    using DataType = typename Cfg::DataType;
+    using ResponseType = typename SerdesTypes<Cfg>::ResponseType;
+
+    return std::visit([&](auto const& cmd) -> std::optional<ResponseType> {
+        using CmdType = std::remove_cvref_t<decltype(cmd)>;
+        using AckType = typename CommandResponseRelationshipTrait<CmdType>::AckResponseType;
+        using NakType = typename CommandResponseRelationshipTrait<CmdType>::NakResponseType;
+        try {
+            if constexpr (std::is_same_v<CmdType, ReadSingleCommand<Cfg>>) {
+                return AckType{ .transaction_id = cmd.transaction_id, .data = target.read(cmd.addr) };
+            }
+            else if constexpr (std::is_same_v<CmdType, WriteSingleCommand<Cfg>>) {
+                target.write(cmd.addr, cmd.data);
+                if (cmd.posted)
+                    return std::nullopt;
+                return AckType{ .transaction_id = cmd.transaction_id };
+            }
+            else if constexpr (std::is_same_v<CmdType, ReadSeqCommand<Cfg>>) {
+                auto ack = AckType{ .transaction_id = cmd.transaction_id };
+                ack.data.resize(static_cast<size_t>(cmd.count));
+                if (cmd.increment == 0)
+                    target.fifoRead(cmd.start_addr, ack.data);
+                else
+                    target.seqRead(cmd.start_addr, ack.data, static_cast<size_t>(cmd.increment));
+                return ack;
+            }
+            else if constexpr (std::is_same_v<CmdType, WriteSeqCommand<Cfg>>) {
+                auto const data = std::span<DataType const>(cmd.data);
+                if (cmd.increment == 0)
+                    target.fifoWrite(cmd.start_addr, data);
+                else
+                    target.seqWrite(cmd.start_addr, data, static_cast<size_t>(cmd.increment));
+                if (cmd.posted)
+                    return std::nullopt;
+                return AckType{ .transaction_id = cmd.transaction_id };
+            }
+            else if constexpr (std::is_same_v<CmdType, ReadCompCommand<Cfg>>) {
+                auto ack = AckType{ .transaction_id = cmd.transaction_id };
+                ack.data.resize(cmd.addresses.size());
+                target.compRead(cmd.addresses, ack.data);
+                return ack;
+            }
+            else if constexpr (std::is_same_v<CmdType, WriteCompCommand<Cfg>>) {
+                target.compWrite(cmd.addr_data);
+                if (cmd.posted)
+                    return std::nullopt;
+                return AckType{ .transaction_id = cmd.transaction_id };
+            }
+            else if constexpr (std::is_same_v<CmdType, ReadModifyWriteCommand<Cfg>>) {
+                target.readModifyWrite(cmd.addr, cmd.data, cmd.mask);
+                if (cmd.posted)
+                    return std::nullopt;
+                return AckType{ .transaction_id = cmd.transaction_id };
+            }
+            else {
+                static_assert(!sizeof(CmdType*), "Unhandled command type");
+            }
+        }
+        catch (std::exception const& ex) {
+            LOG_WARN("ServerDispatch", "Target threw while servicing transaction {}: {}", cmd.transaction_id, ex.what());
+            if constexpr (requires { cmd.posted; }) {
+                if (cmd.posted)
+                    return std::nullopt;
+            }
+            return NakType{ .transaction_id = cmd.transaction_id, .status = static_cast<DataType>(NakStatusTargetException) };
+        }
+    }, command);
+}
+
+}
@@ -0,0 +1,317 @@
+#pragma once
+#include <RTF/RTF.h>
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Keeps a shadow copy of registers declared non-volatile and drops writes that wouldn't change them.
+// Sits in front of another target (typically a RapRegisterTarget), so a bring-up script that rewrites a register with the
+// value it already holds costs nothing on the wire. The shadow learns values from every write and read that reaches the
+// target; an address it hasn't seen yet is always written. Addresses outside the declared ranges, FIFO accesses and
+// registers the hardware can change on its own must not be declared, and pass straight through.
+// sync() applies a whole configuration block at once, sending only the words that differ from the shadow as WriteSeq
+// runs where they are consecutive and a single WriteComp for the rest.
+// Like the targets it wraps, it isn't thread-safe.
+template <typename AddressType, typename DataType>
+class ShadowRegisterTarget : public RTF::IRegisterTarget<AddressType, DataType>
+{
+public:
+    using TargetType = RTF::IRegisterTarget<AddressType, DataType>;
+
+    struct Stats
+    {
+        uint64_t words_written = 0;    // Reached the target, from writes and syncs
+        uint64_t words_suppressed = 0; // Dropped because the shadow already held the value
+    };
+
+    struct SyncOptions
+    {
+        // Shorter runs go in the WriteComp instead: a WriteSeq saves an address per word but costs a message of its own
+        size_t min_seq_run = 4;
+        bool use_seq = true;  // False if the target has no FeatureSequential
+        bool use_comp = true; // False if the target has no FeatureCompressed; leftover words are then written one by one
+    };
+
+    explicit ShadowRegisterTarget(std::shared_ptr<TargetType> target)
+        : RTF::IRegisterTarget<AddressType, DataType>(target->getName())
+        , target(std::move(target))
+    {}
+    virtual std::string_view getDomain() const override { return this->target->getDomain(); }
+
+    // Registers first_addr, first_addr + stride, ... (count of them) only change when written
+    void declareNonVolatile(AddressType first_addr, size_t count, size_t stride = sizeof(DataType))
+    {
+        if (stride == 0 || count == 0)
+            throw std::invalid_argument("ShadowRegisterTarget ranges need a non-zero count and stride");
+        auto const first = static_cast<uint64_t>(first_addr);
+        auto const end = first + count * stride;
+        auto const next = this->ranges.lower_bound(first);
+        if ((next != this->ranges.end() && next->first < end) || (next != this->ranges.begin() && std::prev(next)->second.end() > first))
+            throw std::invalid_argument(std::format("{}: non-volatile range at 0x{:x} overlaps another", this->getName(), first));
+        this->ranges.emplace(first, Range{ first, stride, std::vector<DataType>(count), std::vector<bool>(count) });
+    }
+    // Forget what the shadow holds, e.g. after the device was reset behind its back
+    void invalidate()
+    {
+        for (auto& [first, range] : this->ranges)
+            std::fill(range.known.begin(), range.known.end(), false);
+    }
+    void invalidate(AddressType addr)
+    {
+        if (auto const slot = this->find(addr))
+            slot.forget();
+    }
+
+    Stats const& getStats() const { return this->stats; }
+
+    virtual void write(AddressType addr, DataType data) override
+    {
+        auto const slot = this->find(addr);
+        if (slot && slot.holds(data)) {
+            this->stats.words_suppressed++;
+            return;
+        }
+        this->forward({ &slot, 1 }, [&]() { this->target->write(addr, data); });
+        this->stats.words_written++;
+        if (slot)
+            slot.set(data);
+    }
+    virtual DataType read(AddressType addr) override
+    {
+        auto const slot = this->find(addr);
+        auto const data = this->target->read(addr);
+        if (slot)
+            slot.set(data);
+        return data;
+    }
+    virtual void readModifyWrite(AddressType addr, DataType new_data, DataType mask) override
+    {
+        auto const slot = this->find(addr);
+        auto const merged = static_cast<DataType>((slot.value() & ~mask) | (new_data & mask));
+        if (slot && slot.holds(merged)) {
+            this->stats.words_suppressed++;
+            return;
+        }
+        this->forward({ &slot, 1 }, [&]() { this->target->readModifyWrite(addr, new_data, mask); });
+        this->stats.words_written++;
+        // Without a known value, the bits outside the mask are still unknown
+        if (slot && slot.known())
+            slot.set(merged);
+    }
+    virtual void seqWrite(AddressType start_addr, std::span<DataType const> data, size_t increment = sizeof(DataType)) override
+    {
+        auto const slots = this->findAll(start_addr, data.size(), increment);
+        // Within a single range the unchanged words at either end can be trimmed off; the middle is sent as one run
+        size_t first = 0;
+        size_t last = data.size();
+        if (increment != 0 && std::ranges::all_of(slots, [&](Slot const& s) { return s.range == slots.front().range; })) {
+            while (first < last && slots[first] && slots[first].holds(data[first]))
+                first++;
+            while (last > first && slots[last - 1] && slots[last - 1].holds(data[last - 1]))
+                last--;
+        }
+        this->stats.words_suppressed += data.size() - (last - first);
+        if (first == last)
+            return;
+        auto const sent = data.subspan(first, last - first);
+        this->forward(slots, [&]() { this->target->seqWrite(static_cast<AddressType>(start_addr + increment * first), sent, increment); });
+        this->stats.words_written += sent.size();
+        for (size_t i = first; i < last; i++)
+            if (slots[i])
+                slots[i].set(data[i]);
+    }
+    virtual void seqRead(AddressType start_addr, std::span<DataType> out_data, size_t increment = sizeof(DataType)) override
+    {
+        auto const slots = this->findAll(start_addr, out_data.size(), increment);
+        this->target->seqRead(start_addr, out_data, increment);
+        for (size_t i = 0; i < out_data.size(); i++)
+            if (slots[i])
+                slots[i].set(out_data[i]);
+    }
+    // FIFO data isn't a register value; a declared address used as a FIFO just loses its shadow
+    virtual void fifoWrite(AddressType fifo_addr, std::span<DataType const> data) override
+    {
+        this->invalidate(fifo_addr);
+        this->target->fifoWrite(fifo_addr, data);
+        this->stats.words_written += data.size();
+    }
+    virtual void fifoRead(AddressType fifo_addr, std::span<DataType> out_data) override
+    {
+        this->invalidate(fifo_addr);
+        this->target->fifoRead(fifo_addr, out_data);
+    }
+    virtual void compWrite(std::span<std::pair<AddressType, DataType> const> addr_data) override
+    {
+        // In order, so a repeated address is compared against the value the pair before it leaves behind
+        std::vector<std::pair<AddressType, DataType>> sent;
+        std::vector<Slot> slots;
+        sent.reserve(addr_data.size());
+        slots.reserve(addr_data.size());
+        for (auto const& [addr, data] : addr_data) {
+            auto const slot = this->find(addr);
+            if (slot && slot.holds(data)) {
+                this->stats.words_suppressed++;
+                continue;
+            }
+            sent.emplace_back(addr, data);
+            slots.push_back(slot);
+            if (slot)
+                slot.set(data);
+        }
+        if (sent.empty())
+            return;
+        this->forward(slots, [&]() { this->target->compWrite(sent); });
+        this->stats.words_written += sent.size();
+    }
+    virtual void compRead(std::span<AddressType const> const addresses, std::span<DataType> out_data) override
+    {
+        this->target->compRead(addresses, out_data);
+        for (size_t i = 0; i < addresses.size(); i++)
+            if (auto const slot = this->find(addresses[i]))
+                slot.set(out_data[i]);
+    }
+
+    // Brings every register in config to its value, writing only the ones the shadow doesn't already hold.
+    // Writes go out sorted by address rather than in config order, so this is for configuration registers whose write
+    // order doesn't matter; a repeated address takes its last value. Every address must be in a declared range.
+    // Returns the number of words written.
+    size_t sync(std::span<std::pair<AddressType, DataType> const> config, SyncOptions const& options = {})
+    {
+        std::vector<std::pair<AddressType, DataType>> sorted(config.begin(), config.end());
+        std::ranges::stable_sort(sorted, {}, [](auto const& p) { return static_cast<uint64_t>(p.first); });
+        std::vector<std::pair<AddressType, DataType>> changed;
+        std::vector<Slot> slots;
+        for (size_t i = 0; i < sorted.size(); i++) {
+            if (i + 1 < sorted.size() && sorted[i + 1].first == sorted[i].first)
+                continue;
+            auto const slot = this->find(sorted[i].first);
+            if (!slot)
+                throw std::invalid_argument(std::format("{}: sync address 0x{:x} isn't declared non-volatile", this->getName(), static_cast<uint64_t>(sorted[i].first)));
+            if (slot.holds(sorted[i].second)) {
+                this->stats.words_suppressed++;
+                continue;
+            }
+            changed.push_back(sorted[i]);
+            slots.push_back(slot);
+        }
+        if (changed.empty())
+            return 0;
+
+        this->forward(slots, [&]() {
+            std::vector<std::pair<AddressType, DataType>> comp;
+            std::vector<DataType> run;
+            for (size_t first = 0; first < changed.size();) {
+                // A run is consecutive registers of one range
+                auto last = first + 1;
+                while (last < changed.size() && slots[last].range == slots[first].range && slots[last].index == slots[last - 1].index + 1)
+                    last++;
+                if (options.use_seq && last - first >= std::max<size_t>(options.min_seq_run, 2)) {
+                    run.clear();
+                    for (auto i = first; i < last; i++)
+                        run.push_back(changed[i].second);
+                    this->target->seqWrite(changed[first].first, run, slots[first].range->stride);
+                }
+                else {
+                    comp.insert(comp.end(), changed.begin() + first, changed.begin() + last);
+                }
+                first = last;
+            }
+            if (options.use_comp && !comp.empty())
+                this->target->compWrite(comp);
+            else
+                for (auto const& [addr, data] : comp)
+                    this->target->write(addr, data);
+        });
+        this->stats.words_written += changed.size();
+        for (size_t i = 0; i < changed.size(); i++)
+            slots[i].set(changed[i].second);
+        return changed.size();
+    }
+    // Same for a block of consecutive registers of one declared range, starting at start_addr
+    size_t sync(AddressType start_addr, std::span<DataType const> block, SyncOptions const& options = {})
+    {
+        auto const slot = this->find(start_addr);
+        if (!slot)
+            throw std::invalid_argument(std::format("{}: sync address 0x{:x} isn't declared non-volatile", this->getName(), static_cast<uint64_t>(start_addr)));
+        std::vector<std::pair<AddressType, DataType>> config;
+        config.reserve(block.size());
+        for (size_t i = 0; i < block.size(); i++)
+            config.emplace_back(static_cast<AddressType>(start_addr + slot.range->stride * i), block[i]);
+        return this->sync(config, options);
+    }
+
+private:
+    struct Range
+    {
+        uint64_t first;
+        size_t stride;
+        std::vector<DataType> values;
+        std::vector<bool> known;
+
+        uint64_t end() const { return this->first + this->values.size() * this->stride; }
+    };
+    // One register's place in the shadow; empty for addresses that aren't declared
+    struct Slot
+    {
+        Range* range = nullptr;
+        size_t index = 0;
+
+        explicit operator bool() const { return this->range != nullptr; }
+        bool known() const { return this->range->known[this->index]; }
+        DataType value() const { return this->range ? this->range->values[this->index] : DataType{}; }
+        bool holds(DataType data) const { return this->known() && this->range->values[this->index] == data; }
+        void set(DataType data) const
+        {
+            this->range->values[this->index] = data;
+            this->range->known[this->index] = true;
+        }
+        void forget() const { this->range->known[this->index] = false; }
+    };
+
+    Slot find(AddressType addr)
+    {
+        auto const a = static_cast<uint64_t>(addr);
+        auto it = this->ranges.upper_bound(a);
+        if (it == this->ranges.begin())
+            return {};
+        auto& range = std::prev(it)->second;
+        auto const offset = a - range.first;
+        if (offset % range.stride != 0 || offset / range.stride >= range.values.size())
+            return {};
+        return { &range, static_cast<size_t>(offset / range.stride) };
+    }
+    std::vector<Slot> findAll(AddressType start_addr, size_t count, size_t increment)
+    {
+        std::vector<Slot> slots(count);
+        if (!this->ranges.empty())
+            for (size_t i = 0; i < count; i++)
+                slots[i] = this->find(static_cast<AddressType>(start_addr + increment * i));
+        return slots;
+    }
+
+    // If the target throws, some of the words may have reached the device and some not, so none of them can be trusted
+    template <typename F>
+    void forward(std::span<Slot const> slots, F&& f)
+    {
+        try {
+            f();
+        }
+        catch (...) {
+            for (auto const& slot : slots)
+                if (slot)
+                    slot.forget();
+            throw;
+        }
+    }
+
+    std::shared_ptr<TargetType> target;
+    std::map<uint64_t, Range> ranges; // Keyed by first address
+    Stats stats;
+};
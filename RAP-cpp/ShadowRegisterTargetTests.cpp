@@ -0,0 +1,166 @@
+#include <RAP/RegisterTarget.h>
+#include <RAP/ServerAdapter.h>
+#include "RegisterFileTarget.h"
+#include "SerdesTestCfgs.h"
+#include "ShadowRegisterTarget.h"
+#include <catch2/catch_test_macros.hpp>
+#include <numeric>
+
+// Register file that counts the commands reaching it, standing in for the wire
+template <typename AddressType, typename DataType>
+class CountingRegisterFile : public RegisterFileTarget<AddressType, DataType>
+{
+public:
+    using RegisterFileTarget<AddressType, DataType>::RegisterFileTarget;
+
+    virtual void write(AddressType addr, DataType data) override
+    {
+        this->writes++;
+        RegisterFileTarget<AddressType, DataType>::write(addr, data);
+    }
+    virtual void readModifyWrite(AddressType addr, DataType new_data, DataType mask) override
+    {
+        this->rmws++;
+        RegisterFileTarget<AddressType, DataType>::readModifyWrite(addr, new_data, mask);
+    }
+    virtual void seqWrite(AddressType start_addr, std::span<DataType const> data, size_t increment = sizeof(DataType)) override
+    {
+        this->seq_writes++;
+        this->seq_words += data.size();
+        RegisterFileTarget<AddressType, DataType>::seqWrite(start_addr, data, increment);
+    }
+    virtual void compWrite(std::span<std::pair<AddressType, DataType> const> addr_data) override
+    {
+        this->comp_writes++;
+        this->comp_words += addr_data.size();
+        RegisterFileTarget<AddressType, DataType>::compWrite(addr_data);
+    }
+
+    size_t writes = 0;
+    size_t rmws = 0;
+    size_t seq_writes = 0;
+    size_t seq_words = 0;
+    size_t comp_writes = 0;
+    size_t comp_words = 0;
+};
+
+TEST_CASE("Shadow register target", "[RRT][shadow]")
+{
+    using AddressType = uint32_t;
+    using DataType = uint16_t;
+    auto const device = std::make_shared<CountingRegisterFile<AddressType, DataType>>("Device", 0, 256, 4);
+    ShadowRegisterTarget<AddressType, DataType> shadow(device);
+    shadow.declareNonVolatile(0x000, 64, 4);
+    shadow.declareNonVolatile(0x200, 64, 4);
+    CHECK_THROWS(shadow.declareNonVolatile(0x0FC, 4, 4));
+    CHECK_THROWS(shadow.declareNonVolatile(0x1F0, 8, 4));
+
+    SECTION("Unchanged writes are dropped")
+    {
+        shadow.write(0x4, 0x2);
+        shadow.write(0x4, 0x2);
+        shadow.write(0x4, 0x3);
+        CHECK(device->writes == 2);
+        CHECK(shadow.getStats().words_suppressed == 1);
+
+        // A read teaches the shadow what the register holds
+        device->write(0x8, 7);
+        CHECK(shadow.read(0x8) == 7);
+        shadow.write(0x8, 7);
+        CHECK(device->writes == 3);
+
+        shadow.readModifyWrite(0x4, 0x1, 0x1);
+        shadow.readModifyWrite(0x4, 0x3, 0x3);
+        CHECK(device->rmws == 0);
+
+        // Undeclared registers always go through
+        shadow.write(0x100, 1);
+        shadow.write(0x100, 1);
+        CHECK(device->writes == 5);
+
+        shadow.invalidate();
+        shadow.write(0x4, 0x3);
+        CHECK(device->writes == 6);
+    }
+    SECTION("Seq and comp writes send only what changed")
+    {
+        std::vector<DataType> data(8);
+        std::iota(data.begin(), data.end(), DataType{ 1 });
+        shadow.seqWrite(0x10, data, 4);
+        data[2] = 30;
+        data[4] = 50;
+        shadow.seqWrite(0x10, data, 4);
+        CHECK(device->seq_writes == 2);
+        CHECK(device->seq_words == 8 + 3); // Trimmed to words 2..4
+        shadow.seqWrite(0x10, data, 4);
+        CHECK(device->seq_writes == 2);
+
+        std::vector<std::pair<AddressType, DataType>> const comp{ { 0x10, 1 }, { 0x14, 9 }, { 0x14, 2 }, { 0x100, 4 } };
+        shadow.compWrite(comp);
+        CHECK(device->comp_words == 3);
+        CHECK(device->read(0x14) == 2);
+    }
+    SECTION("Sync writes the diff as seq runs and one comp")
+    {
+        std::vector<DataType> config(64);
+        std::iota(config.begin(), config.end(), DataType{ 100 });
+        CHECK(shadow.sync(0x200, config) == 64);
+        CHECK(device->seq_writes == 1);
+        CHECK(shadow.sync(0x200, config) == 0);
+        CHECK(device->seq_writes == 1);
+
+        for (size_t i = 10; i < 20; i++)
+            config[i] = 0;
+        config[3] = 0;
+        config[40] = 0;
+        config[42] = 0;
+        CHECK(shadow.sync(0x200, config) == 13);
+        CHECK(device->seq_writes == 2);
+        CHECK(device->seq_words == 64 + 10);
+        CHECK(device->comp_writes == 1);
+        CHECK(device->comp_words == 3);
+        for (size_t i = 0; i < config.size(); i++)
+            CHECK(device->registers()[0x200 / 4 + i] == config[i]);
+
+        std::vector<std::pair<AddressType, DataType>> const outside{ { 0x100, 1 } };
+        CHECK_THROWS(shadow.sync(outside));
+    }
+    SECTION("A failed write leaves the shadow unsure")
+    {
+        shadow.declareNonVolatile(0x400, 4, 4); // Past the end of the device's register file
+        shadow.write(0x4, 5);
+        std::vector<std::pair<AddressType, DataType>> const comp{ { 0x4, 6 }, { 0x400, 1 } };
+        CHECK_THROWS(shadow.compWrite(comp));
+        shadow.write(0x4, 6);
+        CHECK(device->writes == 2);
+        CHECK(device->read(0x4) == 6);
+    }
+}
+
+TEST_CASE("Re-applying a configuration over RAP costs nothing", "[RRT][shadow]")
+{
+    using CFG = Rap_A24D32L2C2;
+    auto [client_xport, server_xport] = RAP::Transport::makeSyncPairedIpcTransport(4096); // The first sync is one 300-entry WriteComp
+    client_xport->setTimeout(std::chrono::seconds(1));
+    auto const rap_target = std::make_shared<RAP::RTF::RapRegisterTarget<CFG>>("Rap Target", std::move(client_xport));
+    auto const device = std::make_shared<CountingRegisterFile<CFG::AddressType, CFG::DataType>>("Device", 0, 1024);
+    auto rap_server_adapter = RAP::RTF::RapServerAdapter<CFG>(std::move(server_xport), device);
+
+    auto shadow = std::make_shared<ShadowRegisterTarget<CFG::AddressType, CFG::DataType>>(rap_target);
+    shadow->declareNonVolatile(0, 1024);
+    auto fluent_target = RTF::FluentRegisterTarget{ *shadow };
+
+    std::vector<std::pair<CFG::AddressType, CFG::DataType>> config;
+    for (CFG::AddressType i = 0; i < 300; i++)
+        config.emplace_back((i * 7 % 1024) * 4, i);
+    for (int pass = 0; pass < 3; pass++) {
+        fluent_target
+            .write(0x4, 0x2)
+            .write(0x4, 0x2);
+        shadow->sync(config);
+    }
+    CHECK(device->writes == 1);
+    CHECK(device->comp_words + device->seq_words == 300);
+    CHECK(device->read(0x4) == 0x2);
+    CHECK(device->read((299 * 7 % 1024) * 4) == 299);
+}
@@ -0,0 +1,414 @@
+#include "ThreadPlacement.h"
+#include <YALF/YALF.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <utility>
+#if defined(_WIN32)
+#include <Windows.h>
+#include <TlHelp32.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace RAP::Threads {
+
+std::string_view getRoleString(Role role)
+{
+    switch (role) {
+        case Role::TransportReceive: return "TransportReceive";
+        case Role::ServerWorker: return "ServerWorker";
+        case Role::Logger: return "Logger";
+        case Role::Metrics: return "Metrics";
+    }
+    return "?";
+}
+
+std::optional<std::vector<unsigned>> parseCpuList(std::string_view list)
+{
+    std::vector<unsigned> cpus;
+    auto const parseNumber = [](std::string_view s) -> std::optional<unsigned> {
+        while (!s.empty() && s.front() == ' ')
+            s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\n'))
+            s.remove_suffix(1);
+        unsigned v = 0;
+        auto const [end, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+        if (s.empty() || ec != std::errc{} || end != s.data() + s.size())
+            return std::nullopt;
+        return v;
+    };
+    while (!list.empty()) {
+        auto const comma = list.find(',');
+        auto const item = list.substr(0, comma);
+        list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+        auto const dash = item.find('-');
+        auto const first = parseNumber(item.substr(0, dash));
+        auto const last = dash == std::string_view::npos ? first : parseNumber(item.substr(dash + 1));
+        if (!first || !last || last.value() < first.value())
+            return std::nullopt;
+        for (auto cpu = first.value(); cpu <= last.value(); cpu++)
+            cpus.push_back(cpu);
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+std::string formatCpuList(std::vector<unsigned> const& cpus)
+{
+    std::string rv;
+    for (size_t i = 0; i < cpus.size();) {
+        auto j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+            j++;
+        if (!rv.empty())
+            rv += ',';
+        rv += j == i ? std::format("{}", cpus[i]) : std::format("{}-{}", cpus[i], cpus[j]);
+        i = j + 1;
+    }
+    return rv;
+}
+
+namespace {
+    struct Registration
+    {
+        std::string name;
+        Role role;
+#if !defined(_WIN32)
+        pid_t tid;
+#endif
+    };
+
+    struct State
+    {
+        std::mutex mutex;
+        std::array<Placement, RoleCount> placements;
+        std::vector<std::shared_ptr<Registration>> threads;
+    };
+    State& state()
+    {
+        static State s;
+        return s;
+    }
+
+    // Unregisters the thread when it exits, so snapshots only ever list live threads
+    struct RegistrationGuard
+    {
+        std::shared_ptr<Registration> registration;
+        ~RegistrationGuard()
+        {
+            if (!this->registration)
+                return;
+            auto& s = state();
+            auto const lock = std::scoped_lock(s.mutex);
+            std::erase(s.threads, this->registration);
+        }
+    };
+    thread_local RegistrationGuard registration_guard;
+#if defined(_WIN32)
+    thread_local ScopedPlacement* innermost_scope = nullptr;
+#endif
+
+    // Placement runs before the logger exists for the Logger role's own threads
+    void warn(std::string const& message)
+    {
+        if (YALF::hasGlobalLogger())
+            LOG_WARN("Threads", "{}", message);
+    }
+
+    std::vector<unsigned> nodeCpus(unsigned node)
+    {
+#if defined(_WIN32)
+        GROUP_AFFINITY affinity{};
+        if (!::GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity)) {
+            warn(std::format("NUMA node {} not found", node));
+            return {};
+        }
+        std::vector<unsigned> cpus;
+        for (unsigned bit = 0; bit < 64; bit++)
+            if (affinity.Mask & (KAFFINITY{ 1 } << bit))
+                cpus.push_back(affinity.Group * 64 + bit);
+        return cpus;
+#else
+        auto is = std::ifstream(std::format("/sys/devices/system/node/node{}/cpulist", node));
+        std::string list;
+        if (!std::getline(is, list)) {
+            warn(std::format("NUMA node {} not found", node));
+            return {};
+        }
+        return parseCpuList(list).value_or(std::vector<unsigned>{});
+#endif
+    }
+
+    std::vector<unsigned> resolveCpus(Placement const& placement)
+    {
+        if (!placement.cpus.empty())
+            return placement.cpus;
+        if (placement.numa_node)
+            return nodeCpus(placement.numa_node.value());
+        return {};
+    }
+
+#if defined(_WIN32)
+    // Plain affinity masks only cover the calling thread's processor group
+    DWORD_PTR affinityMask(std::vector<unsigned> const& cpus)
+    {
+        DWORD_PTR mask = 0;
+        for (auto const cpu : cpus)
+            if (cpu < 64)
+                mask |= DWORD_PTR{ 1 } << cpu;
+        return mask;
+    }
+
+    // IDs of every thread in the process, sorted
+    std::vector<unsigned long> processThreads()
+    {
+        std::vector<unsigned long> ids;
+        auto const snapshot = ::CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+        if (snapshot == INVALID_HANDLE_VALUE)
+            return ids;
+        auto const pid = ::GetCurrentProcessId();
+        THREADENTRY32 entry{};
+        entry.dwSize = sizeof(entry);
+        for (auto ok = ::Thread32First(snapshot, &entry); ok; ok = ::Thread32Next(snapshot, &entry))
+            if (entry.th32OwnerProcessID == pid)
+                ids.push_back(entry.th32ThreadID);
+        ::CloseHandle(snapshot);
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    }
+
+    void pinThread(unsigned long id, std::vector<unsigned> const& cpus)
+    {
+        auto const thread = ::OpenThread(THREAD_SET_INFORMATION | THREAD_QUERY_INFORMATION, FALSE, id);
+        if (!thread)
+            return; // Already gone
+        if (::SetThreadAffinityMask(thread, affinityMask(cpus)) == 0)
+            warn(std::format("Can't pin thread {} to CPUs {} (error {})", id, formatCpuList(cpus), ::GetLastError()));
+        ::CloseHandle(thread);
+    }
+#endif
+
+    // Returns the CPU set the thread had before, or std::nullopt if the OS refused the new one
+    std::optional<std::vector<unsigned>> pinCurrentThread(std::vector<unsigned> const& cpus)
+    {
+#if defined(_WIN32)
+        auto const previous_mask = ::SetThreadAffinityMask(::GetCurrentThread(), affinityMask(cpus));
+        if (previous_mask == 0) {
+            warn(std::format("Can't pin thread to CPUs {} (error {})", formatCpuList(cpus), ::GetLastError()));
+            return std::nullopt;
+        }
+        std::vector<unsigned> previous;
+        for (unsigned bit = 0; bit < 64; bit++)
+            if (previous_mask & (DWORD_PTR{ 1 } << bit))
+                previous.push_back(bit);
+        return previous;
+#else
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        std::vector<unsigned> previous;
+        if (::sched_getaffinity(0, sizeof(set), &set) == 0)
+            for (unsigned cpu = 0; cpu < CPU_SETSIZE; cpu++)
+                if (CPU_ISSET(cpu, &set))
+                    previous.push_back(cpu);
+        CPU_ZERO(&set);
+        for (auto const cpu : cpus)
+            if (cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &set);
+        if (::sched_setaffinity(0, sizeof(set), &set) != 0) {
+            warn(std::format("Can't pin thread to CPUs {} (errno {})", formatCpuList(cpus), errno));
+            return std::nullopt;
+        }
+        return previous;
+#endif
+    }
+
+    void preferNode([[maybe_unused]] unsigned node)
+    {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+        // MPOL_PREFERRED, without needing libnuma's headers
+        constexpr int mpol_preferred = 1;
+        unsigned long mask[4]{};
+        if (node >= sizeof(mask) * 8)
+            return;
+        mask[node / (sizeof(unsigned long) * 8)] = 1ul << (node % (sizeof(unsigned long) * 8));
+        if (::syscall(SYS_set_mempolicy, mpol_preferred, mask, sizeof(mask) * 8) != 0)
+            warn(std::format("Can't prefer NUMA node {} for allocations (errno {})", node, errno));
+#endif
+    }
+
+    void nameCurrentThread(std::string_view name)
+    {
+#if defined(_WIN32)
+        auto const wide = std::wstring(name.begin(), name.end());
+        ::SetThreadDescription(::GetCurrentThread(), wide.c_str());
+#elif defined(__linux__)
+        // Linux thread names are limited to 15 characters
+        ::pthread_setname_np(::pthread_self(), std::string{ name.substr(0, 15) }.c_str());
+#else
+        (void)name;
+#endif
+    }
+
+#if !defined(_WIN32)
+    std::optional<uint64_t> findCounter(std::string const& path, std::string_view key)
+    {
+        auto is = std::ifstream(path);
+        std::string line;
+        while (std::getline(is, line)) {
+            if (!line.starts_with(key))
+                continue;
+            auto const colon = line.find(':', key.size());
+            if (colon == std::string::npos)
+                continue;
+            auto const value = std::string_view{ line }.substr(colon + 1);
+            auto const start = value.find_first_not_of(" \t");
+            uint64_t v = 0;
+            if (start != std::string_view::npos && std::from_chars(value.data() + start, value.data() + value.size(), v).ec == std::errc{})
+                return v;
+        }
+        return std::nullopt;
+    }
+
+    std::optional<unsigned> lastCpu(std::string const& stat_path)
+    {
+        auto is = std::ifstream(stat_path);
+        std::string stat;
+        if (!std::getline(is, stat))
+            return std::nullopt;
+        // The command name can contain spaces, so count fields after its closing parenthesis; processor is field 39
+        auto fields = std::istringstream(stat.substr(stat.rfind(')') + 1));
+        std::string field;
+        for (int i = 3; i <= 39; i++)
+            if (!(fields >> field))
+                return std::nullopt;
+        unsigned cpu = 0;
+        if (std::from_chars(field.data(), field.data() + field.size(), cpu).ec != std::errc{})
+            return std::nullopt;
+        return cpu;
+    }
+#endif
+}
+
+void setPlacement(Role role, Placement placement)
+{
+    auto& s = state();
+    auto const lock = std::scoped_lock(s.mutex);
+    s.placements[size_t(role)] = std::move(placement);
+}
+
+Placement getPlacement(Role role)
+{
+    auto& s = state();
+    auto const lock = std::scoped_lock(s.mutex);
+    return s.placements[size_t(role)];
+}
+
+void placeCurrentThread(Role role, std::string_view name)
+{
+    auto const placement = getPlacement(role);
+    if (auto const cpus = resolveCpus(placement); !cpus.empty() && pinCurrentThread(cpus))
+        LOG_DEBUG("Threads", "{} ({}) pinned to CPUs {}", name, getRoleString(role), formatCpuList(cpus));
+    if (placement.numa_node)
+        preferNode(placement.numa_node.value());
+    nameCurrentThread(name);
+
+    auto registration = std::make_shared<Registration>();
+    registration->name = std::string{ name };
+    registration->role = role;
+#if !defined(_WIN32)
+    registration->tid = static_cast<pid_t>(::syscall(SYS_gettid));
+#endif
+    auto& s = state();
+    auto const lock = std::scoped_lock(s.mutex);
+    if (registration_guard.registration)
+        std::erase(s.threads, registration_guard.registration);
+    s.threads.push_back(registration);
+    registration_guard.registration = std::move(registration);
+}
+
+ScopedPlacement::ScopedPlacement(Role role)
+#if defined(_WIN32)
+    : outer(std::exchange(innermost_scope, this))
+#endif
+{
+    auto cpus = resolveCpus(getPlacement(role));
+    if (cpus.empty())
+        return;
+    this->previous = pinCurrentThread(cpus);
+#if defined(_WIN32)
+    this->threads_before = processThreads();
+    this->cpus = std::move(cpus);
+#endif
+}
+
+ScopedPlacement::~ScopedPlacement()
+{
+#if defined(_WIN32)
+    innermost_scope = this->outer;
+    if (!this->cpus.empty()) {
+        auto const self = ::GetCurrentThreadId();
+        std::vector<unsigned long> pinned;
+        for (auto const id : processThreads()) {
+            if (id != self && !std::binary_search(this->threads_before.begin(), this->threads_before.end(), id)) {
+                pinThread(id, this->cpus);
+                pinned.push_back(id);
+            }
+        }
+        // So that an enclosing scope leaves them where this one put them
+        if (this->outer) {
+            auto& before = this->outer->threads_before;
+            before.insert(before.end(), pinned.begin(), pinned.end());
+            std::sort(before.begin(), before.end());
+        }
+    }
+#endif
+    if (this->previous && !this->previous->empty())
+        pinCurrentThread(this->previous.value());
+}
+
+std::vector<SchedulingCounters> takeSchedulingSnapshot()
+{
+    std::vector<std::shared_ptr<Registration>> threads;
+    {
+        auto& s = state();
+        auto const lock = std::scoped_lock(s.mutex);
+        threads = s.threads;
+    }
+
+    std::vector<SchedulingCounters> rv;
+    rv.reserve(threads.size());
+    for (auto const& thread : threads) {
+        auto& counters = rv.emplace_back();
+        counters.name = thread->name;
+        counters.role = thread->role;
+#if !defined(_WIN32)
+        auto const task = std::format("/proc/self/task/{}/", thread->tid);
+        counters.voluntary_switches = findCounter(task + "status", "voluntary_ctxt_switches");
+        counters.involuntary_switches = findCounter(task + "status", "nonvoluntary_ctxt_switches");
+        counters.migrations = findCounter(task + "sched", "se.nr_migrations");
+        counters.last_cpu = lastCpu(task + "stat");
+#endif
+    }
+    return rv;
+}
+
+void dumpSchedulingToLog(std::vector<SchedulingCounters> const& snapshot)
+{
+    auto const str = [](auto const& v) { return v ? std::format("{}", v.value()) : std::string{ "n/a" }; };
+    for (auto const& thread : snapshot)
+        LOG_INFO("Threads", "{} ({}): CPU {}, {} voluntary and {} involuntary context switches, {} migrations",
+            thread.name, getRoleString(thread.role), str(thread.last_cpu), str(thread.voluntary_switches), str(thread.involuntary_switches), str(thread.migrations));
+}
+
+}
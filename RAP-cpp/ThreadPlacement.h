@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Where RAP's long-running threads are allowed to run.
+// Each kind of thread has a Role with an optional Placement (a CPU set and/or a NUMA node, configured from the
+// [ThreadPlacement "<Role>"] sections of Config.txt). Threads this tree owns call placeCurrentThread() when they start;
+// threads created inside YALF or the RAP library are placed by constructing their owner inside a ScopedPlacement.
+// Buffers a placed thread allocates afterwards are NUMA-local: the thread prefers its node's memory on Linux, and under
+// the default first-touch policy on both Linux and Windows pages land on the node of the thread that first writes them.
+// Placement is best effort: a CPU set the OS refuses is logged and the thread runs unpinned.
+namespace RAP::Threads {
+
+enum class Role : uint8_t
+{
+    TransportReceive, // Transport receive loops and the io_context threads that run them
+    ServerWorker,     // RapServerAdapter / BatchingServerAdapter dispatch threads
+    Logger,           // YALF deferred sink writers
+    Metrics,          // RapMetrics periodic dump
+};
+inline constexpr size_t RoleCount = 4;
+
+std::string_view getRoleString(Role role);
+
+struct Placement
+{
+    std::vector<unsigned> cpus;        // Empty: every CPU of numa_node, or anywhere if that is unset too
+    std::optional<unsigned> numa_node;
+
+    bool empty() const { return this->cpus.empty() && !this->numa_node; }
+};
+
+// "0-3,8,10-11" style CPU lists, as in Linux's cpulist files; std::nullopt if malformed
+std::optional<std::vector<unsigned>> parseCpuList(std::string_view list);
+std::string formatCpuList(std::vector<unsigned> const& cpus);
+
+void setPlacement(Role role, Placement placement);
+Placement getPlacement(Role role);
+
+// Pins the calling thread as role, names it, and registers it for the scheduling counters below.
+// Call it first thing in the thread, before it allocates anything it will use for long.
+void placeCurrentThread(Role role, std::string_view name);
+
+// Pins the calling thread as role for the lifetime of the scope, then restores its previous CPU set.
+// Threads started in the scope inherit the placement on Linux. Windows threads start with the process affinity instead,
+// so there the destructor pins every thread the process started while the scope was open (including any that another
+// thread happened to start meanwhile) and that a nested scope hasn't already pinned. Until then those threads run
+// unpinned, and pages they touch first may be on another node, so keep the scope short: construct the thread's owner
+// and nothing else.
+class ScopedPlacement
+{
+public:
+    explicit ScopedPlacement(Role role);
+    ~ScopedPlacement();
+    ScopedPlacement(ScopedPlacement const&) = delete;
+    ScopedPlacement& operator=(ScopedPlacement const&) = delete;
+
+private:
+    std::optional<std::vector<unsigned>> previous;
+#if defined(_WIN32)
+    std::vector<unsigned> cpus;
+    std::vector<unsigned long> threads_before; // Thread IDs, sorted
+    ScopedPlacement* outer;
+#endif
+};
+
+// Per-thread scheduler counters, cumulative since the thread started. Unavailable counters (all of them outside
+// Linux) are std::nullopt.
+struct SchedulingCounters
+{
+    std::string name;
+    Role role;
+    std::optional<uint64_t> voluntary_switches;   // Blocked: waiting on a socket, lock or condition
+    std::optional<uint64_t> involuntary_switches; // Preempted: something else wanted the CPU
+    std::optional<uint64_t> migrations;           // Moved to another CPU, losing its cache
+    std::optional<unsigned> last_cpu;
+};
+
+// Every thread registered through placeCurrentThread() that is still running
+std::vector<SchedulingCounters> takeSchedulingSnapshot();
+// Writes the snapshot to the global logger under the "Threads" domain
+void dumpSchedulingToLog(std::vector<SchedulingCounters> const& snapshot);
+
+}
@@ -0,0 +1,53 @@
+#include "ThreadPlacement.h"
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <thread>
+
+TEST_CASE("Thread placement CPU lists", "[threads]")
+{
+    using namespace RAP::Threads;
+    SECTION("Parse")
+    {
+        CHECK(parseCpuList("") == std::vector<unsigned>{});
+        CHECK(parseCpuList("3") == std::vector<unsigned>{ 3 });
+        CHECK(parseCpuList("0-3,8") == std::vector<unsigned>{ 0, 1, 2, 3, 8 });
+        CHECK(parseCpuList(" 10-11 , 2\n") == std::vector<unsigned>{ 2, 10, 11 });
+        CHECK(parseCpuList("1,1,0-1") == std::vector<unsigned>{ 0, 1 });
+    }
+    SECTION("Malformed")
+    {
+        CHECK(!parseCpuList("a"));
+        CHECK(!parseCpuList("3-1"));
+        CHECK(!parseCpuList("1,,2"));
+        CHECK(!parseCpuList("1-"));
+        CHECK(!parseCpuList("-1"));
+    }
+    SECTION("Format")
+    {
+        CHECK(formatCpuList({}) == "");
+        CHECK(formatCpuList({ 0, 1, 2, 3, 8 }) == "0-3,8");
+        CHECK(formatCpuList({ 1, 3, 4 }) == "1,3-4");
+        CHECK(parseCpuList(formatCpuList({ 0, 2, 3, 4, 7, 9, 10 })) == std::vector<unsigned>{ 0, 2, 3, 4, 7, 9, 10 });
+    }
+}
+
+TEST_CASE("Thread placement registers placed threads", "[threads]")
+{
+    using namespace RAP::Threads;
+    auto const registered = [](std::string_view name) {
+        auto const snapshot = takeSchedulingSnapshot();
+        return std::ranges::any_of(snapshot, [&](SchedulingCounters const& c) { return c.name == name && c.role == Role::ServerWorker; });
+    };
+    // Unconfigured roles leave the thread where it was, but it is still named and counted
+    auto const previous = getPlacement(Role::ServerWorker);
+    setPlacement(Role::ServerWorker, {});
+    // Catch2 assertions only belong on the test's own thread
+    bool registered_while_running = false;
+    std::thread([&]() {
+        placeCurrentThread(Role::ServerWorker, "PlacementTest");
+        registered_while_running = registered("PlacementTest");
+    }).join();
+    CHECK(registered_while_running);
+    CHECK(!registered("PlacementTest"));
+    setPlacement(Role::ServerWorker, previous);
+}
@@ -0,0 +1,100 @@
+// Offline decoder for BinaryLogSink segments (the [Logger "PbFileSink"] output): formats every entry as text, optionally filtered.
+// Built by BinaryLogDump.vcxproj (it has its own main, so it isn't part of RAP-cpp.vcxproj); elsewhere build it
+// alongside BinaryLog.cpp and MappedFile.cpp, e.g.
+//   g++ -std=c++20 -O2 -I.. -I<YALF include dir> BinaryLogDump.cpp ../BinaryLog.cpp ../MappedFile.cpp -o BinaryLogDump
+// or with MSVC: cl /std:c++20 /O2 /EHsc /I.. ...
+// Usage: BinaryLogDump [--level <max level>] [--domain <domain>] [--grep <text>] <segment or sink filename>...
+// A sink filename (e.g. Logs/Demo_2024.01.01_12.00.00.pbin) expands to all of its rotated segments, oldest first.
+#define YALF_IMPLEMENTATION
+#include <YALF/YALF.h>
+#include "../BinaryLog.h"
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace RAP::BinaryLog;
+
+static
+int usage()
+{
+    std::fputs("Usage: BinaryLogDump [--level <max level>] [--domain <domain>] [--grep <text>] <segment or sink filename>...\n", stderr);
+    return 2;
+}
+
+int main(int argc, char** argv)
+{
+    std::optional<YALF::LogLevel> max_level;
+    std::optional<std::string_view> domain_filter;
+    std::optional<std::string_view> grep;
+    std::vector<std::filesystem::path> inputs;
+    for (int i = 1; i < argc; i++) {
+        auto const arg = std::string_view{ argv[i] };
+        if (i + 1 < argc && arg == "--level") {
+            max_level = YALF::parseLogLevelString(argv[++i]);
+            if (!max_level)
+                return usage();
+        }
+        else if (i + 1 < argc && arg == "--domain")
+            domain_filter = argv[++i];
+        else if (i + 1 < argc && arg == "--grep")
+            grep = argv[++i];
+        else if (arg.starts_with("--"))
+            return usage();
+        else
+            inputs.emplace_back(arg);
+    }
+    if (inputs.empty())
+        return usage();
+
+    // SegmentReader reports truncated segments through YALF
+    auto logger = std::make_unique<YALF::Logger>();
+    logger->addSink("ConsoleSink", YALF::makeConsoleSink());
+    YALF::setGlobalLogger(std::move(logger));
+
+    std::vector<std::filesystem::path> segments;
+    for (auto const& input : inputs) {
+        if (std::filesystem::exists(input)) {
+            segments.push_back(input);
+            continue;
+        }
+        auto const found = findSegments(input);
+        if (found.empty()) {
+            std::fputs(std::format("No segments found for {}\n", input.string()).c_str(), stderr);
+            return 1;
+        }
+        segments.insert(segments.end(), found.begin(), found.end());
+    }
+
+    size_t printed = 0;
+    for (auto const& segment : segments) {
+        try {
+            auto const reader = SegmentReader(segment);
+            for (auto const& entry : reader.entries()) {
+                if (max_level && static_cast<int>(entry.format->level) > static_cast<int>(max_level.value()))
+                    continue;
+                if (domain_filter && entry.domain != domain_filter.value())
+                    continue;
+                auto const message = formatMessage(entry);
+                if (grep && message.find(grep.value()) == std::string::npos)
+                    continue;
+                auto const filename = std::filesystem::path(entry.format->file).filename().string();
+                auto const line = std::format("{:%y/%m/%d %H:%M:%S} {}:{} {} {}:  {}\n",
+                    std::chrono::floor<std::chrono::microseconds>(entry.timestamp), filename, entry.format->line,
+                    entry.domain, YALF::getLogLevelString(entry.format->level), message);
+                std::fputs(line.c_str(), stdout);
+                printed++;
+            }
+        }
+        catch (std::exception const& ex) {
+            std::fputs(std::format("{}: {}\n", segment.string(), ex.what()).c_str(), stderr);
+            return 1;
+        }
+    }
+    return printed > 0 ? 0 : 1;
+}
@@ -0,0 +1,450 @@
+// Sustained-load and soak-test driver for RapServerAdapter: N client RapRegisterTargets, each on its own transport and
+// thread, issue a weighted mix of RAP commands for a fixed duration and the tool reports throughput and latency percentiles
+// every report interval and at the end.
+// - ClosedLoop: every client issues its next command as soon as the previous one completes (concurrency = Clients).
+// - OpenLoop: commands are scheduled at RatePerSecond across all clients regardless of how fast they complete. Latency
+//   is measured from when a command was scheduled, not when a stalled client got round to sending it, so a server
+//   that falls behind shows up in the percentiles instead of silently lowering the offered load (coordinated omission).
+// Each client draws its commands from its own generator seeded with Seed + client index, so a run is reproducible
+// command for command.
+// Transport = Ipc serves every client from an in-process RapServerAdapter over a paired IPC transport; Transport = Udp
+// talks to a remote server (or to in-process ones on localhost with ServeLocally = true).
+// [LoadGenerator "Mix"] gives each command kind a relative weight (kinds left out are never sent); ReadSeq, WriteSeq,
+// ReadFifo and WriteFifo move SeqLength words and ReadComp/WriteComp CompLength pairs, at random registers among the
+// first RegisterCount. In UDP mode client i talks to FirstRemotePort + i from FirstLocalPort + i.
+// Built by LoadGenerator.vcxproj (it has its own main, so it isn't part of RAP-cpp.vcxproj); elsewhere build it with the
+// RAP, RTF, YALF and ACFP sources, e.g.
+//   g++ -std=c++20 -O2 -I.. LoadGenerator.cpp ../ConfigureLogger.cpp ../ConfigureThreads.cpp ../BinaryLog.cpp ../MappedFile.cpp
+//       ../RapMetrics.cpp ../ThreadPlacement.cpp ../RAP/SyncPairedIpcTransports.cpp ../RAP/SyncUdpTransport.cpp -o LoadGenerator
+// Usage: LoadGenerator [config file, default LoadGenerator.txt]
+#define YALF_IMPLEMENTATION
+#define RTF_IMPLEMENTATION
+#include <YALF/YALF.h>
+#include <ACFP/ACFP.h>
+#include <RTF/RTF.h>
+#include <RAP/RegisterTarget.h>
+#include <RAP/ServerAdapter.h>
+#include "../RapMetrics.h"
+#include "../RegisterFileTarget.h"
+#include "../ThreadPlacement.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <format>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std::literals::string_view_literals;
+
+void configureThreads(ACFP::SectionGroup const& config_group);
+void configureLogger(ACFP::SectionGroup const& config_group, ACFP::SectionGroup const& dll_config_group);
+
+struct LoadGenCfg {
+    using AddressType = uint32_t;
+    static constexpr uint8_t AddressBits = 24;
+    static constexpr uint8_t AddressBytes = 3;
+    using DataType = uint32_t;
+    static constexpr uint8_t DataBits = 32;
+    static constexpr uint8_t DataBytes = 4;
+    using LengthType = uint16_t;
+    static constexpr uint8_t LengthBytes = 2;
+    using CrcType = uint16_t;
+    static constexpr uint8_t CrcBytes = 2;
+    static constexpr bool FeatureSequential = true;
+    static constexpr bool FeatureFifo = true;
+    static constexpr bool FeatureIncrement = true;
+    static constexpr bool FeatureCompressed = true;
+    static constexpr bool FeatureInterrupt = false;
+    static constexpr bool FeatureReadModifyWrite = true;
+};
+static_assert(RAP::IsConfigurationType<LoadGenCfg>);
+
+using AddressType = LoadGenCfg::AddressType;
+using DataType = LoadGenCfg::DataType;
+using Clock = std::chrono::steady_clock;
+
+enum class OpKind : uint8_t
+{
+    Read,
+    Write,
+    ReadModifyWrite,
+    ReadSeq,
+    WriteSeq,
+    ReadFifo,
+    WriteFifo,
+    ReadComp,
+    WriteComp,
+};
+inline constexpr size_t OpKindCount = 9;
+// Also the keys of the [LoadGenerator "Mix"] section
+inline constexpr std::array<std::string_view, OpKindCount> op_kind_names{
+    "Read"sv, "Write"sv, "ReadModifyWrite"sv, "ReadSeq"sv, "WriteSeq"sv, "ReadFifo"sv, "WriteFifo"sv, "ReadComp"sv, "WriteComp"sv,
+};
+
+struct LoadOptions
+{
+    enum class Mode { OpenLoop, ClosedLoop };
+
+    Mode mode = Mode::ClosedLoop;
+    bool ipc = true;
+    size_t clients = 4;
+    double rate_per_second = 10000; // OpenLoop, across all clients
+    std::chrono::milliseconds warmup{ 2000 };
+    std::chrono::milliseconds duration{ 30000 };
+    std::chrono::milliseconds report_interval{ 1000 };
+    std::chrono::milliseconds timeout{ 1000 };
+    uint64_t seed = 1;
+    size_t register_count = 65536;
+    size_t seq_length = 32;
+    size_t comp_length = 16;
+    size_t ipc_size = 512;
+    std::array<unsigned, OpKindCount> mix{ 40, 40, 0, 5, 5, 0, 0, 5, 5 };
+
+    std::string remote_host = "localhost";
+    uint16_t first_remote_port = 4400;
+    uint16_t first_local_port = 1400;
+    bool serve_locally = false;
+
+    static LoadOptions fromConfig(ACFP::SectionGroup const& group)
+    {
+        auto const& config = group[""];
+        LoadOptions options;
+        if (auto const mode = config["Mode"]) {
+            if (mode.value() == "OpenLoop"sv)
+                options.mode = Mode::OpenLoop;
+            else if (mode.value() != "ClosedLoop"sv)
+                throw std::invalid_argument(std::format("Unknown Mode '{}' (OpenLoop or ClosedLoop)", mode.value()));
+        }
+        if (auto const transport = config["Transport"]) {
+            if (transport.value() == "Udp"sv)
+                options.ipc = false;
+            else if (transport.value() != "Ipc"sv)
+                throw std::invalid_argument(std::format("Unknown Transport '{}' (Ipc or Udp)", transport.value()));
+        }
+        options.clients = ACFP::parse<size_t>(config["Clients"]).value_or(options.clients);
+        options.rate_per_second = ACFP::parse<double>(config["RatePerSecond"]).value_or(options.rate_per_second);
+        options.warmup = std::chrono::milliseconds(ACFP::parse<unsigned>(config["WarmupMs"]).value_or(static_cast<unsigned>(options.warmup.count())));
+        options.duration = std::chrono::milliseconds(ACFP::parse<unsigned>(config["DurationMs"]).value_or(static_cast<unsigned>(options.duration.count())));
+        options.report_interval = std::chrono::milliseconds(ACFP::parse<unsigned>(config["ReportIntervalMs"]).value_or(static_cast<unsigned>(options.report_interval.count())));
+        options.timeout = std::chrono::milliseconds(ACFP::parse<unsigned>(config["TimeoutMs"]).value_or(static_cast<unsigned>(options.timeout.count())));
+        options.seed = ACFP::parse<uint64_t>(config["Seed"]).value_or(options.seed);
+        options.register_count = ACFP::parse<size_t>(config["RegisterCount"]).value_or(options.register_count);
+        options.seq_length = ACFP::parse<size_t>(config["SeqLength"]).value_or(options.seq_length);
+        options.comp_length = ACFP::parse<size_t>(config["CompLength"]).value_or(options.comp_length);
+        options.ipc_size = ACFP::parse<size_t>(config["IpcSize"]).value_or(options.ipc_size);
+
+        // Only the kinds listed replace the defaults, so a Mix section of "Read = 1" is a pure read workload
+        auto const& mix = group["Mix"];
+        bool mix_given = false;
+        std::array<unsigned, OpKindCount> weights{};
+        for (size_t i = 0; i < OpKindCount; i++) {
+            if (auto const weight = ACFP::parse<unsigned>(mix[op_kind_names[i]])) {
+                weights[i] = weight.value();
+                mix_given = true;
+            }
+        }
+        if (mix_given)
+            options.mix = weights;
+
+        auto const& udp = group["Udp"];
+        options.remote_host = std::string{ udp["RemoteHost"].value_or(options.remote_host) };
+        options.first_remote_port = ACFP::parse<uint16_t>(udp["FirstRemotePort"]).value_or(options.first_remote_port);
+        options.first_local_port = ACFP::parse<uint16_t>(udp["FirstLocalPort"]).value_or(options.first_local_port);
+        options.serve_locally = ACFP::parse<bool>(udp["ServeLocally"]).value_or(options.serve_locally);
+
+        if (options.clients == 0 || options.register_count == 0)
+            throw std::invalid_argument("Clients and RegisterCount must be non-zero");
+        if (options.seq_length == 0 || options.seq_length > options.register_count || options.comp_length == 0)
+            throw std::invalid_argument("SeqLength and CompLength must be non-zero, and SeqLength at most RegisterCount");
+        if (options.mode == Mode::OpenLoop && !(options.rate_per_second > 0))
+            throw std::invalid_argument("OpenLoop needs a positive RatePerSecond");
+        if (std::all_of(options.mix.begin(), options.mix.end(), [](unsigned w) { return w == 0; }))
+            throw std::invalid_argument("Every command in the mix has a weight of zero");
+        return options;
+    }
+};
+
+// One per client thread; only that thread records, the reporter reads concurrently
+struct ClientStats
+{
+    std::array<RAP::Metrics::Histogram, OpKindCount> latency{};
+    std::atomic<uint64_t> errors{};
+};
+
+// Everything a client sends is decided by its generator, never by timing, so a seed replays the same traffic
+class Client
+{
+public:
+    Client(size_t index, LoadOptions const& options, std::shared_ptr<RTF::IRegisterTarget<AddressType, DataType>> target)
+        : index(index)
+        , options(options)
+        , target(std::move(target))
+        , rng(options.seed + index)
+        , pick(options.mix.begin(), options.mix.end())
+        , register_dist(0, options.register_count - 1)
+        , seq_start_dist(0, options.register_count - options.seq_length)
+        , seq_data(options.seq_length)
+        , comp_addresses(options.comp_length)
+        , comp_data(options.comp_length)
+        , comp_addr_data(options.comp_length)
+    {}
+
+    ClientStats const& getStats() const { return this->stats; }
+
+    void run(Clock::time_point start, Clock::time_point measure_from, Clock::time_point end)
+    {
+        auto const interval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(static_cast<double>(this->options.clients) / this->options.rate_per_second));
+        // Clients' open-loop schedules are interleaved rather than all firing at once
+        auto next = start + interval * static_cast<Clock::rep>(this->index) / static_cast<Clock::rep>(this->options.clients);
+
+        while (true) {
+            auto const open_loop = this->options.mode == LoadOptions::Mode::OpenLoop;
+            auto const intended = open_loop ? next : Clock::now();
+            if (intended >= end)
+                return;
+            if (open_loop) {
+                next += interval;
+                // Behind schedule means sending straight away; the lateness is charged to this command's latency
+                if (intended > Clock::now())
+                    std::this_thread::sleep_until(intended);
+            }
+
+            auto const kind = static_cast<OpKind>(this->pick(this->rng));
+            try {
+                this->execute(kind);
+            }
+            catch (std::exception const& ex) {
+                // A timed out or NAKed command still counts, with however long it took to fail
+                this->stats.errors.fetch_add(1, std::memory_order_relaxed);
+                LOG_DEBUG("LoadGenerator", "Client {} {} failed: {}", this->index, op_kind_names[size_t(kind)], ex.what());
+            }
+            if (intended >= measure_from)
+                this->stats.latency[size_t(kind)].record(static_cast<uint64_t>(std::chrono::nanoseconds(Clock::now() - intended).count()));
+        }
+    }
+
+private:
+    AddressType randomAddress()
+    {
+        return static_cast<AddressType>(this->register_dist(this->rng) * sizeof(DataType));
+    }
+    DataType randomData()
+    {
+        return static_cast<DataType>(this->rng());
+    }
+
+    void execute(OpKind kind)
+    {
+        auto& target = *this->target;
+        switch (kind) {
+        case OpKind::Read:
+            (void)target.read(this->randomAddress());
+            break;
+        case OpKind::Write:
+            target.write(this->randomAddress(), this->randomData());
+            break;
+        case OpKind::ReadModifyWrite:
+            target.readModifyWrite(this->randomAddress(), this->randomData(), this->randomData());
+            break;
+        case OpKind::ReadSeq:
+            target.seqRead(static_cast<AddressType>(this->seq_start_dist(this->rng) * sizeof(DataType)), this->seq_data);
+            break;
+        case OpKind::WriteSeq:
+            for (auto& data : this->seq_data)
+                data = this->randomData();
+            target.seqWrite(static_cast<AddressType>(this->seq_start_dist(this->rng) * sizeof(DataType)), this->seq_data);
+            break;
+        case OpKind::ReadFifo:
+            target.fifoRead(this->randomAddress(), this->seq_data);
+            break;
+        case OpKind::WriteFifo:
+            for (auto& data : this->seq_data)
+                data = this->randomData();
+            target.fifoWrite(this->randomAddress(), this->seq_data);
+            break;
+        case OpKind::ReadComp:
+            for (auto& addr : this->comp_addresses)
+                addr = this->randomAddress();
+            target.compRead(this->comp_addresses, this->comp_data);
+            break;
+        case OpKind::WriteComp:
+            for (auto& addr_data : this->comp_addr_data)
+                addr_data = { this->randomAddress(), this->randomData() };
+            target.compWrite(this->comp_addr_data);
+            break;
+        }
+    }
+
+    size_t index;
+    LoadOptions const& options;
+    std::shared_ptr<RTF::IRegisterTarget<AddressType, DataType>> target;
+    std::mt19937_64 rng;
+    std::discrete_distribution<size_t> pick;
+    std::uniform_int_distribution<size_t> register_dist;
+    std::uniform_int_distribution<size_t> seq_start_dist;
+    std::vector<DataType> seq_data;
+    std::vector<AddressType> comp_addresses;
+    std::vector<DataType> comp_data;
+    std::vector<std::pair<AddressType, DataType>> comp_addr_data;
+    ClientStats stats;
+};
+
+static
+RAP::Metrics::HistogramSnapshot snapshotOf(std::vector<std::unique_ptr<Client>> const& clients, std::optional<OpKind> kind = std::nullopt)
+{
+    RAP::Metrics::HistogramSnapshot snapshot;
+    for (auto const& client : clients) {
+        for (size_t k = 0; k < OpKindCount; k++)
+            if (!kind || size_t(kind.value()) == k)
+                snapshot.add(client->getStats().latency[k]);
+    }
+    return snapshot;
+}
+
+// What was recorded between two cumulative snapshots; the interval's max is only known to bucket precision
+static
+RAP::Metrics::HistogramSnapshot difference(RAP::Metrics::HistogramSnapshot const& now, RAP::Metrics::HistogramSnapshot const& before)
+{
+    RAP::Metrics::HistogramSnapshot rv;
+    for (size_t i = 0; i < rv.buckets.size(); i++) {
+        rv.buckets[i] = now.buckets[i] - before.buckets[i];
+        if (rv.buckets[i])
+            rv.max_ns = RAP::Metrics::HistogramLayout::bucketUpperBound(i);
+    }
+    rv.count = now.count - before.count;
+    rv.sum_ns = now.sum_ns - before.sum_ns;
+    rv.max_ns = std::min(rv.max_ns, now.max_ns);
+    return rv;
+}
+
+static
+std::string formatUs(uint64_t ns)
+{
+    return std::format("{:.1f}us", static_cast<double>(ns) / 1000.0);
+}
+
+static
+uint64_t totalErrors(std::vector<std::unique_ptr<Client>> const& clients)
+{
+    uint64_t errors = 0;
+    for (auto const& client : clients)
+        errors += client->getStats().errors.load(std::memory_order_relaxed);
+    return errors;
+}
+
+static
+int runLoad(LoadOptions const& options)
+{
+    using Target = RTF::IRegisterTarget<AddressType, DataType>;
+    // Declared before the clients so the servers outlive every client still talking to them
+    // Held by pointer: each adapter's worker thread uses it in place, so growing the vector mustn't move one
+    std::vector<std::unique_ptr<RAP::RTF::RapServerAdapter<LoadGenCfg>>> servers;
+    std::vector<std::unique_ptr<Client>> clients;
+
+    auto const serve = [&](std::unique_ptr<RAP::Transport::ITransport> server_xport, size_t i) {
+        // One register file per server, as each would be a separate device
+        auto device = std::make_shared<RegisterFileTarget<AddressType, DataType>>(std::format("Device {}", i), 0, options.register_count);
+        // The adapter's worker thread starts inside this placement (and is pinned as the scope ends on Windows)
+        auto const placement = RAP::Threads::ScopedPlacement(RAP::Threads::Role::ServerWorker);
+        servers.push_back(std::make_unique<RAP::RTF::RapServerAdapter<LoadGenCfg>>(std::move(server_xport), std::move(device)));
+    };
+    for (size_t i = 0; i < options.clients; i++) {
+        std::unique_ptr<RAP::Transport::ITransport> client_xport;
+        // Transports allocate their receive buffers (and start any receive threads) when they are made
+        auto const placement = RAP::Threads::ScopedPlacement(RAP::Threads::Role::TransportReceive);
+        if (options.ipc) {
+            auto [client_side, server_side] = RAP::Transport::makeSyncPairedIpcTransport(options.ipc_size);
+            serve(std::move(server_side), i);
+            client_xport = std::move(client_side);
+        }
+        else {
+            auto const local_port = static_cast<uint16_t>(options.first_local_port + i);
+            auto const remote_port = static_cast<uint16_t>(options.first_remote_port + i);
+            if (options.serve_locally)
+                serve(RAP::Transport::makeSyncUdpTransport("localhost", remote_port, "localhost", local_port, false), i);
+            client_xport = RAP::Transport::makeSyncUdpTransport("localhost", local_port, options.remote_host, remote_port, true);
+        }
+        client_xport->setTimeout(options.timeout);
+        auto target = std::make_shared<RAP::RTF::RapRegisterTarget<LoadGenCfg>>(std::format("Client {}", i), std::move(client_xport));
+        clients.push_back(std::make_unique<Client>(i, options, std::shared_ptr<Target>(std::move(target))));
+    }
+
+    LOG_INFO("LoadGenerator", "{} clients over {}, {}, {}ms warmup then {}ms, seed {}",
+        options.clients, options.ipc ? "IPC" : std::format("UDP to {}", options.remote_host),
+        options.mode == LoadOptions::Mode::OpenLoop ? std::format("open loop at {} commands/s", options.rate_per_second) : std::string{ "closed loop" },
+        options.warmup.count(), options.duration.count(), options.seed);
+
+    auto const start = Clock::now();
+    auto const measure_from = start + options.warmup;
+    auto const end = measure_from + options.duration;
+    std::vector<std::jthread> threads;
+    for (auto& client : clients)
+        threads.emplace_back([&client, start, measure_from, end]() { client->run(start, measure_from, end); });
+
+    // Per-interval lines show drift and stalls over a soak that the final percentiles would average away
+    std::this_thread::sleep_until(measure_from);
+    auto previous = snapshotOf(clients);
+    auto previous_errors = totalErrors(clients);
+    auto previous_time = measure_from;
+    for (auto next = measure_from + options.report_interval; next <= end; next += options.report_interval) {
+        std::this_thread::sleep_until(next);
+        auto const current = snapshotOf(clients);
+        auto const errors = totalErrors(clients);
+        auto const interval = difference(current, previous);
+        auto const seconds = std::chrono::duration<double>(next - previous_time).count();
+        LOG_INFO("LoadGenerator", "{:7.1f}s {:9.0f}/s p50 {} p99 {} p99.9 {} max {} errors {}",
+            std::chrono::duration<double>(next - measure_from).count(), static_cast<double>(interval.count) / seconds,
+            formatUs(interval.valueAtPercentile(50)), formatUs(interval.valueAtPercentile(99)), formatUs(interval.valueAtPercentile(99.9)),
+            formatUs(interval.max_ns), errors - previous_errors);
+        previous = current;
+        previous_errors = errors;
+        previous_time = next;
+    }
+    threads.clear();
+
+    // An open-loop run that fell behind is still working through its backlog at the end of the duration, so
+    // throughput is what completed over the time it actually took rather than the offered rate
+    auto const seconds = std::chrono::duration<double>(Clock::now() - measure_from).count();
+    auto const total = snapshotOf(clients);
+    LOG_INFO("LoadGenerator", "Total: {} commands, {:.0f}/s, {} errors", total.count, static_cast<double>(total.count) / seconds, totalErrors(clients));
+    for (size_t k = 0; k < OpKindCount; k++) {
+        auto const h = snapshotOf(clients, OpKind(k));
+        if (h.count == 0)
+            continue;
+        LOG_INFO("LoadGenerator", "{:>15}: {:9} mean {} p50 {} p90 {} p99 {} p99.9 {} p99.99 {} max {}",
+            op_kind_names[k], h.count, formatUs(h.mean()), formatUs(h.valueAtPercentile(50)), formatUs(h.valueAtPercentile(90)),
+            formatUs(h.valueAtPercentile(99)), formatUs(h.valueAtPercentile(99.9)), formatUs(h.valueAtPercentile(99.99)), formatUs(h.max_ns));
+    }
+    RAP::Metrics::dumpToLog(RAP::Metrics::takeSnapshot());
+    return totalErrors(clients) == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 2) {
+        std::fputs("Usage: LoadGenerator [config file, default LoadGenerator.txt]\n", stderr);
+        return 2;
+    }
+    try {
+        auto const config = ACFP::parseConfigFile(argc == 2 ? argv[1] : "LoadGenerator.txt");
+        configureThreads(config["ThreadPlacement"]);
+        configureLogger(config["Logger"], config["DomainLogLevels"]);
+        return runLoad(LoadOptions::fromConfig(config["LoadGenerator"]));
+    }
+    catch (std::exception const& ex) {
+        if (YALF::hasGlobalLogger())
+            LOG_CRIT("main", "Uncaught exception bubbled up to main: {}", ex.what());
+        else
+            std::fputs(std::format("Uncaught exception bubbled up to main (before logging set up): {}\n", ex.what()).c_str(), stderr);
+        return 1;
+    }
+}
@@ -0,0 +1,227 @@
+#include "TrafficCapture.h"
+#include <YALF/YALF.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+namespace RAP::Capture {
+
+namespace {
+    constexpr char FileMagic[8] = { 'R', 'A', 'P', 'C', 'A', 'P', '0', '2' };
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t header_size;
+        uint32_t record_header_size;
+        int64_t start_unix_ns;
+        // Written after the record they cover, so they never claim more than is in the file
+        uint64_t used_bytes;
+        uint64_t record_count;
+    };
+    static_assert(sizeof(FileHeader) == 40);
+
+    struct RecordHeader
+    {
+        uint64_t timestamp_ns;
+        uint32_t length;
+        uint8_t message_class;
+        uint8_t direction;
+        uint8_t stream;
+        uint8_t reserved;
+    };
+    static_assert(sizeof(RecordHeader) == 16);
+}
+
+CaptureWriter::CaptureWriter(std::filesystem::path const& filename, size_t initial_size)
+    : file(MappedFile::create(filename, std::max(initial_size, sizeof(FileHeader) + 4096)))
+    , start(std::chrono::steady_clock::now())
+{
+    FileHeader hdr{};
+    std::memcpy(hdr.magic, FileMagic, sizeof(FileMagic));
+    hdr.header_size = sizeof(FileHeader);
+    hdr.record_header_size = sizeof(RecordHeader);
+    hdr.start_unix_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    hdr.used_bytes = sizeof(FileHeader);
+    hdr.record_count = 0;
+    std::memcpy(this->file.data().data(), &hdr, sizeof(hdr));
+    this->used = sizeof(hdr);
+    LOG_INFO("TrafficCapture", "Capturing RAP traffic to {}", filename.string());
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    auto const lock = std::scoped_lock(this->mutex);
+    this->file.close(this->used);
+}
+
+void CaptureWriter::record(MessageClass message_class, Direction direction, uint8_t stream, std::span<std::byte const> payload)
+{
+    auto const now = std::chrono::steady_clock::now();
+    RecordHeader const rh{
+        .timestamp_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - this->start).count()),
+        .length = static_cast<uint32_t>(payload.size()),
+        .message_class = static_cast<uint8_t>(message_class),
+        .direction = static_cast<uint8_t>(direction),
+        .stream = stream,
+        .reserved = 0,
+    };
+
+    auto const lock = std::scoped_lock(this->mutex);
+    auto const needed = this->used + sizeof(rh) + payload.size();
+    if (needed > this->file.size())
+        this->file.resize(std::max(needed, this->file.size() * 2));
+    auto* const dst = this->file.data().data() + this->used;
+    std::memcpy(dst, &rh, sizeof(rh));
+    if (!payload.empty())
+        std::memcpy(dst + sizeof(rh), payload.data(), payload.size());
+    this->used = needed;
+    this->records++;
+    uint64_t const used_bytes = this->used;
+    uint64_t const record_count = this->records;
+    std::memcpy(this->file.data().data() + offsetof(FileHeader, used_bytes), &used_bytes, sizeof(used_bytes));
+    std::memcpy(this->file.data().data() + offsetof(FileHeader, record_count), &record_count, sizeof(record_count));
+}
+
+size_t CaptureWriter::recordCount() const
+{
+    auto const lock = std::scoped_lock(this->mutex);
+    return this->records;
+}
+
+void CaptureWriter::flush()
+{
+    auto const lock = std::scoped_lock(this->mutex);
+    this->file.flush();
+}
+
+CaptureReader::CaptureReader(std::filesystem::path const& filename)
+    : file(MappedFile::openRead(filename))
+{
+    auto const bytes = this->file.data();
+    FileHeader hdr{};
+    if (bytes.size() < sizeof(hdr))
+        throw std::runtime_error(std::format("{} is too small to be a RAP capture", filename.string()));
+    std::memcpy(&hdr, bytes.data(), sizeof(hdr));
+    if (std::memcmp(hdr.magic, FileMagic, sizeof(FileMagic)) != 0 || hdr.record_header_size != sizeof(RecordHeader))
+        throw std::runtime_error(std::format("{} is not a RAP capture (or is from an incompatible version)", filename.string()));
+    this->start_time = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(hdr.start_unix_ns)));
+
+    if (hdr.used_bytes > bytes.size())
+        LOG_WARN("TrafficCapture", "{}: header claims {} bytes but the file has {}, reading what is there", filename.string(), hdr.used_bytes, bytes.size());
+    auto const end = static_cast<size_t>(std::min<uint64_t>(hdr.used_bytes, bytes.size()));
+    size_t offset = hdr.header_size;
+    this->all_records.reserve(static_cast<size_t>(std::min<uint64_t>(hdr.record_count, (end - std::min(end, offset)) / sizeof(RecordHeader))));
+    while (this->all_records.size() < hdr.record_count && offset + sizeof(RecordHeader) <= end) {
+        RecordHeader rh{};
+        std::memcpy(&rh, bytes.data() + offset, sizeof(rh));
+        offset += sizeof(rh);
+        if (offset + rh.length > end) {
+            LOG_WARN("TrafficCapture", "{}: truncated record at offset {}, ignoring the rest", filename.string(), offset - sizeof(rh));
+            break;
+        }
+        this->all_records.push_back(CaptureRecord{
+            .timestamp = std::chrono::nanoseconds(rh.timestamp_ns),
+            .message_class = static_cast<MessageClass>(rh.message_class),
+            .direction = static_cast<Direction>(rh.direction),
+            .stream = rh.stream,
+            .payload = bytes.subspan(offset, rh.length),
+        });
+        offset += rh.length;
+    }
+}
+
+class CapturingTransport : public Transport::ITransport
+{
+public:
+    CapturingTransport(std::unique_ptr<Transport::ITransport> next, std::shared_ptr<CaptureWriter> writer, Role role, uint8_t stream)
+        : Transport::ITransport()
+        , next(std::move(next))
+        , writer(std::move(writer))
+        , sent_class(role == Role::Client ? MessageClass::Command : MessageClass::Response)
+        , received_class(role == Role::Client ? MessageClass::Response : MessageClass::Command)
+        , stream(stream)
+    {}
+
+    virtual void send(std::span<std::byte const> buf) override
+    {
+        this->writer->record(this->sent_class, Direction::Sent, this->stream, buf);
+        this->next->send(buf);
+    }
+
+    virtual std::vector<std::byte> recv() override
+    {
+        auto buf = this->next->recv();
+        this->writer->record(this->received_class, Direction::Received, this->stream, buf);
+        return buf;
+    }
+
+    virtual void setTimeout(std::chrono::milliseconds timeout) override
+    {
+        this->next->setTimeout(timeout);
+    }
+
+private:
+    std::unique_ptr<Transport::ITransport> next;
+    std::shared_ptr<CaptureWriter> writer;
+    MessageClass sent_class;
+    MessageClass received_class;
+    uint8_t stream;
+};
+
+std::unique_ptr<Transport::ITransport> makeCapturingTransport(std::unique_ptr<Transport::ITransport> xport, std::shared_ptr<CaptureWriter> writer, Role role, uint8_t stream)
+{
+    return std::make_unique<CapturingTransport>(std::move(xport), std::move(writer), role, stream);
+}
+
+class CapturingAsyncTransport : public Transport::IAsyncTransport
+{
+public:
+    CapturingAsyncTransport(std::unique_ptr<Transport::IAsyncTransport> next, std::shared_ptr<CaptureWriter> writer, Role role, uint8_t stream)
+        : Transport::IAsyncTransport()
+        , next(std::move(next))
+        , writer(std::move(writer))
+        , sent_class(role == Role::Client ? MessageClass::Command : MessageClass::Response)
+        , received_class(role == Role::Client ? MessageClass::Response : MessageClass::Command)
+        , stream(stream)
+    {}
+
+    virtual asio::any_io_executor getExecutor() override
+    {
+        return this->next->getExecutor();
+    }
+
+    virtual asio::awaitable<void> sendAsync(std::span<std::byte const> buf) override
+    {
+        this->writer->record(this->sent_class, Direction::Sent, this->stream, buf);
+        co_await this->next->sendAsync(buf);
+    }
+
+    virtual asio::awaitable<size_t> recvAsync(std::span<std::byte> buf) override
+    {
+        auto const n = co_await this->next->recvAsync(buf);
+        this->writer->record(this->received_class, Direction::Received, this->stream, buf.first(n));
+        co_return n;
+    }
+
+    virtual void close() override
+    {
+        this->next->close();
+    }
+
+private:
+    std::unique_ptr<Transport::IAsyncTransport> next;
+    std::shared_ptr<CaptureWriter> writer;
+    MessageClass sent_class;
+    MessageClass received_class;
+    uint8_t stream;
+};
+
+std::unique_ptr<Transport::IAsyncTransport> makeCapturingAsyncTransport(std::unique_ptr<Transport::IAsyncTransport> xport, std::shared_ptr<CaptureWriter> writer, Role role, uint8_t stream)
+{
+    return std::make_unique<CapturingAsyncTransport>(std::move(xport), std::move(writer), role, stream);
+}
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <RAP/RegisterTarget.h>
+#include "AsyncTransports.h"
+#include "MappedFile.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+// Record-and-replay of RAP wire traffic.
+// A capture is a small file header followed by back-to-back records: a 16-byte record header and the message bytes
+// exactly as they crossed the transport. Files are written through a growing memory mapping and read back zero-copy.
+// The file header carries the length and record count written so far, updated after every record, so a reader stops
+// there rather than parsing the zero-filled tail of the mapping of a capture that is still open or whose writer crashed.
+namespace RAP::Capture {
+
+enum class MessageClass : uint8_t
+{
+    Command,
+    Response,
+};
+
+enum class Direction : uint8_t
+{
+    Sent,
+    Received,
+};
+
+// Which end of the link the capture was taken on; decides whether sent messages are commands or responses
+enum class Role : uint8_t
+{
+    Client,
+    Server,
+};
+
+struct CaptureRecord
+{
+    std::chrono::nanoseconds timestamp; // Since the capture was started
+    MessageClass message_class;
+    Direction direction;
+    uint8_t stream; // Distinguishes transports sharing one capture
+    std::span<std::byte const> payload;
+};
+
+class CaptureWriter
+{
+public:
+    explicit CaptureWriter(std::filesystem::path const& filename, size_t initial_size = 16 * 1024 * 1024);
+    ~CaptureWriter();
+    CaptureWriter(CaptureWriter const&) = delete;
+    CaptureWriter& operator=(CaptureWriter const&) = delete;
+
+    void record(MessageClass message_class, Direction direction, uint8_t stream, std::span<std::byte const> payload);
+    size_t recordCount() const;
+    void flush();
+
+private:
+    mutable std::mutex mutex;
+    MappedFile file;
+    size_t used = 0;
+    size_t records = 0;
+    std::chrono::steady_clock::time_point start;
+};
+
+class CaptureReader
+{
+public:
+    explicit CaptureReader(std::filesystem::path const& filename);
+
+    std::chrono::system_clock::time_point startTime() const { return this->start_time; }
+    // Records point into the mapping and stay valid for the reader's lifetime
+    std::vector<CaptureRecord> const& records() const { return this->all_records; }
+
+private:
+    MappedFile file;
+    std::chrono::system_clock::time_point start_time;
+    std::vector<CaptureRecord> all_records;
+};
+
+// Records everything passing through a sync transport, e.g. the one given to RapRegisterTarget or RapServerAdapter
+std::unique_ptr<Transport::ITransport> makeCapturingTransport(std::unique_ptr<Transport::ITransport> xport, std::shared_ptr<CaptureWriter> writer, Role role, uint8_t stream = 0);
+
+// Records everything passing through an async transport
+std::unique_ptr<Transport::IAsyncTransport> makeCapturingAsyncTransport(std::unique_ptr<Transport::IAsyncTransport> xport, std::shared_ptr<CaptureWriter> writer, Role role, uint8_t stream = 0);
+
+}
@@ -0,0 +1,118 @@
+#include <RAP/RegisterTarget.h>
+#include <RAP/ServerAdapter.h>
+#include "AdvDummyRegisterTarget.h"
+#include "RegisterFileTarget.h"
+#include "TrafficCapture.h"
+#include "TrafficReplay.h"
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <stdexcept>
+
+TEST_CASE("Capture round trip and in-process replay", "[capture]")
+{
+    using CFG = RAP::ExampleRapCfg;
+    auto const filename = std::filesystem::temp_directory_path() / "RAP-cpp_capture_test.rapcap";
+    auto serdes = RAP::Serdes::Serdes<CFG>(4096);
+
+    std::vector<decltype(serdes.encodeCommand(RAP::Serdes::ReadSingleCommand<CFG>{}))> sent;
+    sent.push_back(serdes.encodeCommand(RAP::Serdes::WriteSingleCommand<CFG>{ .transaction_id = 0, .posted = false, .addr = 0x10, .data = 0xAB }));
+    sent.push_back(serdes.encodeCommand(RAP::Serdes::WriteSingleCommand<CFG>{ .transaction_id = 1, .posted = true, .addr = 0x14, .data = 0xCD }));
+    sent.push_back(serdes.encodeCommand(RAP::Serdes::WriteSeqCommand<CFG>{ .transaction_id = 2, .posted = false, .start_addr = 0x20, .increment = sizeof(CFG::DataType), .data = { 1, 2, 3 } }));
+    sent.push_back(serdes.encodeCommand(RAP::Serdes::WriteCompCommand<CFG>{ .transaction_id = 3, .posted = false, .addr_data = { { 0x40, 0x44 }, { 0x50, 0x55 } } }));
+    sent.push_back(serdes.encodeCommand(RAP::Serdes::ReadSingleCommand<CFG>{ .transaction_id = 4, .addr = 0x10 }));
+
+    {
+        RAP::Capture::CaptureWriter writer(filename, 64); // Deliberately tiny so the mapping has to grow
+        for (auto const& buf : sent) {
+            writer.record(RAP::Capture::MessageClass::Command, RAP::Capture::Direction::Sent, 0, std::as_bytes(std::span{ buf }));
+            writer.record(RAP::Capture::MessageClass::Response, RAP::Capture::Direction::Received, 0, {});
+        }
+        std::array<std::byte, 3> const garbage{ std::byte{ 0xFF }, std::byte{ 0xFF }, std::byte{ 0xFF } };
+        writer.record(RAP::Capture::MessageClass::Command, RAP::Capture::Direction::Sent, 0, garbage);
+        CHECK(writer.recordCount() == sent.size() * 2 + 1);
+
+        // The mapping is still open with a zero-filled tail; only what was recorded may come back
+        writer.flush();
+        RAP::Capture::CaptureReader live(filename);
+        CHECK(live.records().size() == sent.size() * 2 + 1);
+    }
+
+    {
+        RAP::Capture::CaptureReader reader(filename);
+        auto const& records = reader.records();
+        REQUIRE(records.size() == sent.size() * 2 + 1);
+        for (size_t i = 0; i < sent.size(); i++) {
+            auto const expected = std::as_bytes(std::span{ sent[i] });
+            CHECK(records[i * 2].message_class == RAP::Capture::MessageClass::Command);
+            CHECK(std::equal(records[i * 2].payload.begin(), records[i * 2].payload.end(), expected.begin(), expected.end()));
+            CHECK(records[i * 2].timestamp <= records[i * 2 + 1].timestamp);
+        }
+
+        AdvDummyRegisterTarget<CFG::AddressType, CFG::DataType> target("Replay Target");
+        auto const result = RAP::Capture::replayCommands<CFG>(reader, target, RAP::Capture::ReplaySpeed::Maximum);
+        CHECK(result.commands == sent.size());
+        CHECK(result.responses == sent.size() - 1); // One posted write
+        CHECK(result.decode_failures == 1);
+        CHECK(target.read(0x10) == 0xAB);
+        CHECK(target.read(0x14) == 0xCD);
+        CHECK(target.read(0x20 + 2 * sizeof(CFG::DataType)) == 3);
+        CHECK(target.read(0x50) == 0x55);
+    }
+    std::filesystem::remove(filename);
+}
+
+TEST_CASE("Capture a sync RAP link and replay it", "[capture]")
+{
+    using CFG = RAP::ExampleRapCfg;
+    auto const filename = std::filesystem::temp_directory_path() / "RAP-cpp_sync_capture_test.rapcap";
+    {
+        auto const writer = std::make_shared<RAP::Capture::CaptureWriter>(filename);
+        auto [client_xport, server_xport] = RAP::Transport::makeSyncPairedIpcTransport(512);
+        client_xport = RAP::Capture::makeCapturingTransport(std::move(client_xport), writer, RAP::Capture::Role::Client);
+        client_xport->setTimeout(std::chrono::seconds(1));
+        auto const rap_target = std::make_shared<RAP::RTF::RapRegisterTarget<CFG>>("Rap Target", std::move(client_xport));
+        auto const device = std::make_shared<RegisterFileTarget<CFG::AddressType, CFG::DataType>>("Device", 0, 64);
+        // Both ends into one capture, each on its own stream
+        server_xport = RAP::Capture::makeCapturingTransport(std::move(server_xport), writer, RAP::Capture::Role::Server, 1);
+        auto rap_server_adapter = RAP::RTF::RapServerAdapter<CFG>(std::move(server_xport), device);
+
+        rap_target->write(0x10, 0x12);
+        rap_target->write(0x14, 0x34);
+        CHECK(rap_target->read(0x10) == 0x12);
+        CHECK(writer->recordCount() == 12);
+    }
+
+    RAP::Capture::CaptureReader reader(filename);
+    CHECK(reader.records().size() == 12);
+    for (uint8_t const stream : { 0, 1 }) {
+        RegisterFileTarget<CFG::AddressType, CFG::DataType> target("Replay Target", 0, 64);
+        auto const result = RAP::Capture::replayCommands<CFG>(reader, target, RAP::Capture::ReplaySpeed::Maximum, stream);
+        CHECK(result.commands == 3);
+        CHECK(result.responses == 3);
+        CHECK(result.decode_failures == 0);
+        CHECK(target.read(0x10) == 0x12);
+        CHECK(target.read(0x14) == 0x34);
+    }
+    std::filesystem::remove(filename);
+}
+
+TEST_CASE("Replay refuses a stream holding both ends of a link", "[capture]")
+{
+    using CFG = RAP::ExampleRapCfg;
+    auto const filename = std::filesystem::temp_directory_path() / "RAP-cpp_two_ended_capture_test.rapcap";
+    auto serdes = RAP::Serdes::Serdes<CFG>(4096);
+    auto const cmd = serdes.encodeCommand(RAP::Serdes::ReadSingleCommand<CFG>{ .transaction_id = 0, .addr = 0x10 });
+    {
+        RAP::Capture::CaptureWriter writer(filename);
+        writer.record(RAP::Capture::MessageClass::Command, RAP::Capture::Direction::Sent, 0, std::as_bytes(std::span{ cmd }));
+        writer.record(RAP::Capture::MessageClass::Command, RAP::Capture::Direction::Received, 0, std::as_bytes(std::span{ cmd }));
+        writer.record(RAP::Capture::MessageClass::Command, RAP::Capture::Direction::Sent, 1, std::as_bytes(std::span{ cmd }));
+    }
+
+    RAP::Capture::CaptureReader reader(filename);
+    AdvDummyRegisterTarget<CFG::AddressType, CFG::DataType> target("Replay Target");
+    CHECK_THROWS_AS(RAP::Capture::replayCommands<CFG>(reader, target, RAP::Capture::ReplaySpeed::Maximum), std::invalid_argument);
+    CHECK_THROWS_AS(RAP::Capture::replayCommands<CFG>(reader, target, RAP::Capture::ReplaySpeed::Maximum, 0), std::invalid_argument);
+    CHECK(RAP::Capture::replayCommands<CFG>(reader, target, RAP::Capture::ReplaySpeed::Maximum, 1).commands == 1);
+    std::filesystem::remove(filename);
+}
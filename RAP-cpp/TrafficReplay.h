@@ -0,0 +1,168 @@
+#pragma once
+#include <RAP/Serdes.h>
+#include <RTF/RTF.h>
+#include <YALF/YALF.h>
+#include "AsyncTransports.h"
+#include "SerdesTypes.h"
+#include "ServerDispatch.h"
+#include "TrafficCapture.h"
+#include <asio.hpp>
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <format>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+namespace RAP::Capture {
+
+enum class ReplaySpeed
+{
+    Original, // Honour the captured inter-message timing
+    Maximum,  // Back to back
+};
+
+struct ReplayResult
+{
+    size_t commands = 0;
+    size_t responses = 0;
+    size_t decode_failures = 0;
+    std::chrono::nanoseconds elapsed{};
+    std::chrono::nanoseconds captured_duration{};
+};
+
+inline
+bool inStream(CaptureRecord const& rec, std::optional<uint8_t> stream)
+{
+    return !stream || rec.stream == stream.value();
+}
+
+// A command is recorded as Sent on the client and as Received on the server. A stream that has both was captured at both ends
+// of one link, and replaying it would run every command twice; such captures have to give each end its own stream.
+inline
+void requireOneEndPerStream(CaptureReader const& capture, std::optional<uint8_t> stream)
+{
+    auto directions = std::array<std::bitset<2>, 256>{};
+    for (auto const& rec : capture.records())
+        if (rec.message_class == MessageClass::Command && inStream(rec, stream))
+            directions[rec.stream][static_cast<size_t>(rec.direction)] = true;
+    for (size_t s = 0; s < directions.size(); s++)
+        if (directions[s].all())
+            throw std::invalid_argument(std::format("Capture stream {} holds commands from both ends of a link", s));
+}
+
+// Feeds every captured command through Serdes::decodeCommand, the server-side dispatch and encodeResponse,
+// against the given target, in-process. This is the server's whole per-message path minus the socket.
+// Only the given stream is replayed, if there is one; a capture of both ends of a link needs it to replay either end.
+template <IsConfigurationType Cfg>
+ReplayResult replayCommands(CaptureReader const& capture, ::RTF::IRegisterTarget<typename Cfg::AddressType, typename Cfg::DataType>& target, ReplaySpeed speed, std::optional<uint8_t> stream = std::nullopt, size_t max_message_size = 4096)
+{
+    requireOneEndPerStream(capture, stream);
+    auto serdes = Serdes::Serdes<Cfg>(max_message_size);
+    using BufferType = typename Serdes::SerdesTypes<Cfg>::BufferType;
+    using ElementType = typename BufferType::value_type;
+
+    ReplayResult result;
+    auto buf = BufferType{};
+    std::chrono::nanoseconds first_ts{ -1 };
+    auto const start = std::chrono::steady_clock::now();
+    for (auto const& rec : capture.records()) {
+        if (rec.message_class != MessageClass::Command || !inStream(rec, stream))
+            continue;
+        if (first_ts.count() < 0)
+            first_ts = rec.timestamp;
+        result.captured_duration = rec.timestamp - first_ts;
+        if (speed == ReplaySpeed::Original)
+            std::this_thread::sleep_until(start + (rec.timestamp - first_ts));
+
+        auto const* const p = reinterpret_cast<ElementType const*>(rec.payload.data());
+        buf.assign(p, p + rec.payload.size() / sizeof(ElementType));
+        try {
+            auto const cmd = serdes.decodeCommand(buf);
+            result.commands++;
+            if (auto const resp = RAP::RTF::executeCommand<Cfg>(target, cmd)) {
+                // Encoded only for its cost, which is part of the path being replayed
+                (void)serdes.encodeResponse(resp.value());
+                result.responses++;
+            }
+        }
+        catch (std::exception const& ex) {
+            result.decode_failures++;
+            LOG_DEBUG("TrafficReplay", "Skipping undecodable command at +{}ns: {}", rec.timestamp.count(), ex.what());
+        }
+    }
+    result.elapsed = std::chrono::steady_clock::now() - start;
+    LOG_INFO("TrafficReplay", "Replayed {} commands ({} responses, {} undecodable) in {}us; captured span was {}us",
+        result.commands, result.responses, result.decode_failures,
+        std::chrono::duration_cast<std::chrono::microseconds>(result.elapsed).count(),
+        std::chrono::duration_cast<std::chrono::microseconds>(result.captured_duration).count());
+    return result;
+}
+
+// Re-sends the captured command bytes, unmodified, to a live server (e.g. a RapServerAdapter) over the given transport,
+// and counts what comes back until every captured response is accounted for or drain_timeout passes.
+// The transport is dedicated to the replay and is closed when it finishes. stream selects what is replayed as for replayCommands.
+inline
+asio::awaitable<ReplayResult> replayToServer(CaptureReader const& capture, Transport::IAsyncTransport& xport, ReplaySpeed speed, std::optional<uint8_t> stream = std::nullopt, std::chrono::milliseconds drain_timeout = std::chrono::seconds(1), size_t max_message_size = 4096)
+{
+    requireOneEndPerStream(capture, stream);
+    struct State
+    {
+        size_t expected_responses = 0;
+        size_t responses = 0;
+        asio::steady_timer done;
+    };
+    auto state = std::make_shared<State>(State{ 0, 0, asio::steady_timer(xport.getExecutor(), asio::steady_timer::time_point::max()) });
+    for (auto const& rec : capture.records())
+        if (rec.message_class == MessageClass::Response && inStream(rec, stream))
+            state->expected_responses++;
+
+    asio::co_spawn(xport.getExecutor(), [&xport, state, max_message_size]() -> asio::awaitable<void> {
+        auto buf = std::vector<std::byte>(max_message_size);
+        while (true) {
+            try {
+                co_await xport.recvAsync(buf);
+            }
+            catch (asio::system_error const&) {
+                co_return;
+            }
+            if (++state->responses >= state->expected_responses)
+                state->done.cancel();
+        }
+    }, asio::detached);
+
+    ReplayResult result;
+    auto timer = asio::steady_timer(xport.getExecutor());
+    std::chrono::nanoseconds first_ts{ -1 };
+    auto const start = std::chrono::steady_clock::now();
+    for (auto const& rec : capture.records()) {
+        if (rec.message_class != MessageClass::Command || !inStream(rec, stream))
+            continue;
+        if (first_ts.count() < 0)
+            first_ts = rec.timestamp;
+        result.captured_duration = rec.timestamp - first_ts;
+        if (speed == ReplaySpeed::Original) {
+            timer.expires_at(start + (rec.timestamp - first_ts));
+            co_await timer.async_wait(asio::use_awaitable);
+        }
+        co_await xport.sendAsync(rec.payload);
+        result.commands++;
+    }
+
+    if (state->responses < state->expected_responses) {
+        state->done.expires_after(drain_timeout);
+        asio::error_code ec;
+        co_await state->done.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+    }
+    result.elapsed = std::chrono::steady_clock::now() - start;
+    result.responses = state->responses;
+    xport.close();
+    LOG_INFO("TrafficReplay", "Sent {} commands, got {} of {} captured responses back in {}us",
+        result.commands, result.responses, state->expected_responses,
+        std::chrono::duration_cast<std::chrono::microseconds>(result.elapsed).count());
+    co_return result;
+}
+
+}
@@ -0,0 +1,190 @@
+#include "UdpBatchSend.h"
+#include <YALF/YALF.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#if defined(__linux__)
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <cerrno>
+#endif
+
+namespace RAP::Transport {
+
+// The kernel splits a segmentation offload send (UDP GSO on Linux, USO on Windows) into equal segments for a single destination
+[[maybe_unused]] static
+bool canUseGso(std::span<DatagramSlice const> slices)
+{
+    constexpr size_t max_gso_bytes = 65000;
+    constexpr size_t max_gso_segments = 64;
+    if (slices.size() < 2 || slices.size() > max_gso_segments)
+        return false;
+    size_t total = 0;
+    for (size_t i = 0; i < slices.size(); i++) {
+        if (slices[i].destination != slices.front().destination)
+            return false;
+        if (slices[i].size != slices.front().size)
+            return false;
+        if (i > 0 && slices[i].offset != slices[i - 1].offset + slices[i - 1].size)
+            return false;
+        total += slices[i].size;
+    }
+    return total <= max_gso_bytes;
+}
+
+[[maybe_unused]] static
+size_t sendEach(asio::ip::udp::socket& socket, std::span<std::byte const> arena, std::span<DatagramSlice const> slices)
+{
+    for (auto const& slice : slices) {
+        asio::error_code ec;
+        socket.send_to(asio::buffer(arena.data() + slice.offset, slice.size), slice.destination, 0, ec);
+        if (ec)
+            LOG_WARN("UdpBatchSender", "send_to failed: {}; dropping one response", ec.message());
+    }
+    return slices.size();
+}
+
+#if defined(__linux__)
+
+// The fd may have been put in non-blocking mode by asio's async machinery, so EAGAIN means "wait for room", not failure
+static
+bool waitWritable(int fd)
+{
+    pollfd pfd{ .fd = fd, .events = POLLOUT, .revents = 0 };
+    return ::poll(&pfd, 1, -1) > 0;
+}
+
+size_t UdpBatchSender::send(std::span<std::byte const> arena, std::span<DatagramSlice const> slices)
+{
+    int const fd = this->socket.native_handle();
+    size_t syscalls = 0;
+
+#if defined(UDP_SEGMENT)
+    if (this->gso_enabled && canUseGso(slices)) {
+        auto const& first = slices.front();
+        iovec iov{ .iov_base = const_cast<std::byte*>(arena.data() + first.offset), .iov_len = first.size * slices.size() };
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+        msghdr msg{};
+        msg.msg_name = const_cast<sockaddr*>(first.destination.data());
+        msg.msg_namelen = static_cast<socklen_t>(first.destination.size());
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        auto* const cm = CMSG_FIRSTHDR(&msg);
+        cm->cmsg_level = SOL_UDP;
+        cm->cmsg_type = UDP_SEGMENT;
+        cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        uint16_t const segment_size = static_cast<uint16_t>(first.size);
+        std::memcpy(CMSG_DATA(cm), &segment_size, sizeof(segment_size));
+        while (true) {
+            syscalls++;
+            if (::sendmsg(fd, &msg, 0) >= 0)
+                return syscalls;
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && waitWritable(fd))
+                continue;
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        LOG_INFO("UdpBatchSender", "UDP GSO send refused ({}), falling back to sendmmsg", std::strerror(errno));
+        this->gso_enabled = false;
+    }
+#endif
+
+    constexpr size_t max_per_call = 64;
+    std::array<mmsghdr, max_per_call> msgs;
+    std::array<iovec, max_per_call> iovs;
+    size_t done = 0;
+    while (done < slices.size()) {
+        auto const count = std::min(max_per_call, slices.size() - done);
+        for (size_t i = 0; i < count; i++) {
+            auto const& slice = slices[done + i];
+            iovs[i] = iovec{ .iov_base = const_cast<std::byte*>(arena.data() + slice.offset), .iov_len = slice.size };
+            msgs[i] = mmsghdr{};
+            msgs[i].msg_hdr.msg_name = const_cast<sockaddr*>(slice.destination.data());
+            msgs[i].msg_hdr.msg_namelen = static_cast<socklen_t>(slice.destination.size());
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        syscalls++;
+        auto const sent = ::sendmmsg(fd, msgs.data(), static_cast<unsigned int>(count), 0);
+        if (sent > 0) {
+            done += static_cast<size_t>(sent);
+            continue;
+        }
+        if ((errno == EAGAIN || errno == EWOULDBLOCK) && waitWritable(fd))
+            continue;
+        if (errno == EINTR)
+            continue;
+        // UDP send errors (e.g. ICMP port unreachable reported late) are per datagram; skip it and carry on like send_to would
+        LOG_WARN("UdpBatchSender", "sendmmsg failed: {}; dropping one response", std::strerror(errno));
+        done++;
+    }
+    return syscalls;
+}
+
+#elif defined(_WIN32)
+
+// Same as on Linux: a non-blocking socket reports WSAEWOULDBLOCK when it's out of room
+static
+bool waitWritable(SOCKET fd)
+{
+    WSAPOLLFD pfd{ .fd = fd, .events = POLLWRNORM, .revents = 0 };
+    return ::WSAPoll(&pfd, 1, -1) > 0;
+}
+
+size_t UdpBatchSender::send(std::span<std::byte const> arena, std::span<DatagramSlice const> slices)
+{
+    size_t syscalls = 0;
+
+#if defined(UDP_SEND_MSG_SIZE)
+    if (this->gso_enabled && canUseGso(slices)) {
+        auto const fd = this->socket.native_handle();
+        auto const& first = slices.front();
+        WSABUF buffer{ .len = static_cast<ULONG>(first.size * slices.size()), .buf = reinterpret_cast<CHAR*>(const_cast<std::byte*>(arena.data() + first.offset)) };
+        alignas(WSACMSGHDR) char control[WSA_CMSG_SPACE(sizeof(DWORD))] = {};
+        WSAMSG msg{};
+        msg.name = const_cast<sockaddr*>(first.destination.data());
+        msg.namelen = static_cast<INT>(first.destination.size());
+        msg.lpBuffers = &buffer;
+        msg.dwBufferCount = 1;
+        msg.Control = WSABUF{ .len = sizeof(control), .buf = control };
+        auto* const cm = WSA_CMSG_FIRSTHDR(&msg);
+        cm->cmsg_level = IPPROTO_UDP;
+        cm->cmsg_type = UDP_SEND_MSG_SIZE;
+        cm->cmsg_len = WSA_CMSG_LEN(sizeof(DWORD));
+        DWORD const segment_size = static_cast<DWORD>(first.size);
+        std::memcpy(WSA_CMSG_DATA(cm), &segment_size, sizeof(segment_size));
+        int error = 0;
+        while (true) {
+            syscalls++;
+            DWORD sent = 0;
+            if (::WSASendMsg(fd, &msg, 0, &sent, nullptr, nullptr) == 0)
+                return syscalls;
+            error = ::WSAGetLastError();
+            if (error == WSAEWOULDBLOCK && waitWritable(fd))
+                continue;
+            break;
+        }
+        // Older Windows versions, and NICs/drivers without USO, reject the control message
+        LOG_INFO("UdpBatchSender", "UDP send offload refused (WSA error {}), falling back to one send per datagram", error);
+        this->gso_enabled = false;
+    }
+#endif
+
+    return syscalls + sendEach(this->socket, arena, slices);
+}
+
+#else
+
+size_t UdpBatchSender::send(std::span<std::byte const> arena, std::span<DatagramSlice const> slices)
+{
+    return sendEach(this->socket, arena, slices);
+}
+
+#endif
+
+}
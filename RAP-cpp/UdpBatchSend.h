@@ -0,0 +1,39 @@
+#pragma once
+#include <asio.hpp>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace RAP::Transport {
+
+// One outgoing datagram, as a slice of a shared arena
+struct DatagramSlice
+{
+    size_t offset = 0;
+    size_t size = 0;
+    asio::ip::udp::endpoint destination;
+};
+
+// Sends many datagrams, all carved out of one contiguous arena, in as few syscalls as the platform allows.
+// When every datagram goes to the same peer and has the same size (the common "burst of acks" case) that's one segmentation
+// offload send: a UDP GSO sendmsg on Linux, a WSASendMsg with UDP_SEND_MSG_SIZE (USO) on Windows. Otherwise Linux uses sendmmsg,
+// and Windows, which has no batched send for mixed datagrams, and other platforms send one send_to per datagram.
+class UdpBatchSender
+{
+public:
+    explicit UdpBatchSender(asio::ip::udp::socket& socket)
+        : socket(socket)
+    {}
+
+    // Returns the number of send syscalls it took
+    size_t send(std::span<std::byte const> arena, std::span<DatagramSlice const> slices);
+
+    // Cleared the first time the kernel refuses a segmentation offload send, after which datagrams go out as described above
+    bool gsoEnabled() const { return this->gso_enabled; }
+
+private:
+    asio::ip::udp::socket& socket;
+    bool gso_enabled = true;
+};
+
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <RAP/Serdes.h>
+#include <RAP/CRCpp/inc/CRC.h>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+namespace RAP::Serdes {
+
+// How a frame's size follows from its type: a fixed size, or size + count * item with the count read from the frame
+struct FrameLength
+{
+    size_t size = 0; // With no items
+    size_t item = 0; // 0 for fixed-size types
+    size_t count_offset = 0;
+    bool count_big_endian = false;
+};
+
+// The RAP frame layout of Cfg as the protocol defines it, for receive paths that check frames before handing them to Serdes.
+// Serdes<Cfg> doesn't publish its layout yet; once it does this should forward to it. Until then nothing is stated by default,
+// and a Cfg's layout can be stated by specializing this with either or both of:
+//   static constexpr size_t type_offset;
+//   static constexpr std::optional<FrameLength> commandLength(uint8_t type); // and responseLength; nullopt for unknown types
+// and
+//   static constexpr size_t crc_first; // The trailing CRC covers the frame from here up to the CRC itself
+//   static constexpr bool crc_big_endian;
+//   static CRC::Parameters<CrcWord, CrcWidth> const& crcParameters();
+// Whatever is stated is enforced: a frame that disagrees with it never reaches Serdes.
+template <IsConfigurationType Cfg>
+struct FrameDefinition
+{};
+
+template <typename Definition>
+concept StatesFrameLengths = requires(uint8_t type) {
+    { Definition::type_offset } -> std::convertible_to<size_t>;
+    { Definition::commandLength(type) } -> std::same_as<std::optional<FrameLength>>;
+    { Definition::responseLength(type) } -> std::same_as<std::optional<FrameLength>>;
+};
+
+template <typename Definition>
+concept StatesFrameCrc = requires {
+    { Definition::crc_first } -> std::convertible_to<size_t>;
+    { Definition::crc_big_endian } -> std::convertible_to<bool>;
+    Definition::crcParameters().MakeTable();
+};
+
+// Checks frames against FrameDefinition<Cfg>. A check the definition doesn't state passes every frame and leaves the verdict to Serdes.
+template <IsConfigurationType Cfg>
+struct WireFormat
+{
+    using Definition = FrameDefinition<Cfg>;
+    static constexpr bool checks_lengths = StatesFrameLengths<Definition>;
+    static constexpr bool checks_crc = StatesFrameCrc<Definition>;
+
+    // Size the frame must have for its type byte and count field; nullopt if lengths aren't stated or its type is unknown
+    static std::optional<size_t> expectedCommandSize(std::span<std::byte const> frame)
+    {
+        if constexpr (checks_lengths)
+            return expectedSize(frame, [](uint8_t type) { return Definition::commandLength(type); });
+        else
+            return std::nullopt;
+    }
+    static std::optional<size_t> expectedResponseSize(std::span<std::byte const> frame)
+    {
+        if constexpr (checks_lengths)
+            return expectedSize(frame, [](uint8_t type) { return Definition::responseLength(type); });
+        else
+            return std::nullopt;
+    }
+
+    // False only if the CRC is stated and the frame's trailing CRC doesn't match the bytes it covers
+    static bool crcMatches(std::span<std::byte const> frame)
+    {
+        if constexpr (checks_crc) {
+            static auto const table = Definition::crcParameters().MakeTable();
+            if (frame.size() < Definition::crc_first + Cfg::CrcBytes)
+                return false;
+            auto const computed = CRC::Calculate(frame.data() + Definition::crc_first, frame.size() - Cfg::CrcBytes - Definition::crc_first, table);
+            return computed == readUnsigned(frame.last(Cfg::CrcBytes), Definition::crc_big_endian);
+        } else {
+            return true;
+        }
+    }
+
+private:
+    static uint64_t readUnsigned(std::span<std::byte const> bytes, bool big_endian)
+    {
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes.size(); i++)
+            value = (value << 8) | std::to_integer<uint64_t>(bytes[big_endian ? i : bytes.size() - 1 - i]);
+        return value;
+    }
+
+    template <typename LengthOf>
+    static
+    std::optional<size_t> expectedSize(std::span<std::byte const> frame, LengthOf length_of)
+    {
+        if (frame.size() <= Definition::type_offset)
+            return std::nullopt;
+        auto const rule = length_of(std::to_integer<uint8_t>(frame[Definition::type_offset]));
+        if (!rule)
+            return std::nullopt;
+        if (rule->item == 0 || frame.size() < rule->count_offset + Cfg::LengthBytes)
+            return rule->size;
+        auto const count = readUnsigned(frame.subspan(rule->count_offset, Cfg::LengthBytes), rule->count_big_endian);
+        return rule->size + count * rule->item;
+    }
+};
+
+}
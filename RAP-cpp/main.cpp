@@ -3,20 +3,29 @@
 #include "YALF/YALF.h"
 #include "ACFP/ACFP.h"
 #include "RTF/RTF.h"
+#include "BinaryLog.h"
+#include "RapMetrics.h"
 #include <catch2/catch_session.hpp>
 
 using namespace std::literals::string_view_literals;
 
+void configureThreads(ACFP::SectionGroup const& config_group);
 void configureLogger(ACFP::SectionGroup const& config_group, ACFP::SectionGroup const& dll_config_group);
 void configureRtf(ACFP::Section const& config);
+void configureMetrics(ACFP::Section const& config);
 
 int main(int argc, char** argv)
 {
     try {
         auto const config = ACFP::parseConfigFile("Config.txt");
+        configureThreads(config["ThreadPlacement"]);
         configureLogger(config["Logger"], config["DomainLogLevels"]);
         configureRtf(config["RegisterOperationLogging"][""]);
-        return Catch::Session().run(argc, argv);
+        configureMetrics(config["RapMetrics"][""]);
+        auto const rv = Catch::Session().run(argc, argv);
+        RAP::Metrics::stopPeriodicDump();
+        RAP::BinaryLog::setGlobalSink(nullptr);
+        return rv;
     }
     catch (std::exception const& ex) {
         if (YALF::hasGlobalLogger()) {
@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""Runs the RAP-cpp Catch2 test executable as N parallel shards (Catch2's --shard-count/--shard-index).
+
+Usage: run_sharded_tests.py <path to RAP-cpp.exe> [--jobs N] [--spec TEST_SPEC] [-- extra Catch2 options]
+
+--spec selects tests as a Catch2 test spec would (e.g. "~[Explore]"); by default every test that isn't hidden.
+Tests tagged with any of --serial-tags (default [UDP], [Async] and [Explore]) are taken out of the shards and run
+afterwards in one process: they bind fixed localhost UDP ports (RrtTests 1234/4321, AsyncRrtTests 1235/4322,
+1250/4340+, 1251/4345-4346 and 1255/4350, LinkEncodingTests 1260/4360) or measure timings, so two of them must never run at once.
+
+Tests are handed to each process by name (Catch2's --input-file), so anything after "--" must be options, not a test spec.
+Every process runs with this directory as its working directory so they all find Config.txt. Each process's output is
+printed once it finishes; the exit code is non-zero if any of them failed.
+"""
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+
+def list_tests(exe, spec, cwd):
+    cmd = [exe, "--list-tests", "--verbosity", "quiet"] + ([spec] if spec else [])
+    result = subprocess.run(cmd, cwd=cwd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True, errors="replace")
+    if result.returncode != 0:
+        sys.exit(f"Listing tests failed ({result.returncode}):\n{result.stdout}")
+    return [line.strip() for line in result.stdout.splitlines() if line.strip()]
+
+
+def write_names(directory, name, tests):
+    path = os.path.join(directory, name)
+    with open(path, "w", encoding="utf-8") as f:
+        f.writelines(f"{test}\n" for test in tests)
+    return path
+
+
+def run(label, cmd, cwd):
+    start = time.monotonic()
+    result = subprocess.run(cmd, cwd=cwd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True, errors="replace")
+    return label, result.returncode, result.stdout, time.monotonic() - start
+
+
+def report(label, returncode, output, elapsed):
+    status = "ok" if returncode == 0 else f"FAILED ({returncode})"
+    print(f"===== {label}: {status} in {elapsed:.1f}s =====")
+    print(output, end="" if output.endswith("\n") else "\n")
+    return returncode == 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("exe", help="Path to the RAP-cpp test executable")
+    parser.add_argument("--jobs", "-j", type=int, default=os.cpu_count() or 1, help="Number of shards to run at once (default: number of cores)")
+    parser.add_argument("--spec", default="", help="Catch2 test spec selecting the tests to run (default: all but hidden tests)")
+    parser.add_argument("--serial-tags", default="[UDP],[Async],[Explore]", help="Catch2 test spec for the tests that must not run in parallel")
+    argv = sys.argv[1:]
+    split = argv.index("--") if "--" in argv else len(argv)
+    args = parser.parse_args(argv[:split])
+    extra_args = argv[split + 1:]
+
+    exe = os.path.abspath(args.exe)
+    cwd = os.path.dirname(os.path.abspath(__file__))
+    jobs = max(1, args.jobs)
+
+    selected = list_tests(exe, args.spec, cwd)
+    # Intersected by name: appending an exclusion to --spec would only constrain the last of its comma-separated alternatives
+    serial_names = set(list_tests(exe, args.serial_tags, cwd))
+    serial = [test for test in selected if test in serial_names]
+    parallel = [test for test in selected if test not in serial_names]
+
+    start = time.monotonic()
+    failed = 0
+    with tempfile.TemporaryDirectory() as names_dir:
+        if parallel:
+            names = write_names(names_dir, "parallel.txt", parallel)
+            shards = min(jobs, len(parallel))
+            with ThreadPoolExecutor(max_workers=shards) as pool:
+                futures = [pool.submit(run, f"shard {i + 1}/{shards}", [exe, "--input-file", names, "--shard-count", str(shards), "--shard-index", str(i)] + extra_args, cwd)
+                           for i in range(shards)]
+                failed += sum(not report(*future.result()) for future in futures)
+        if serial:
+            names = write_names(names_dir, "serial.txt", serial)
+            failed += not report(*run(f"serial ({len(serial)} tests)", [exe, "--input-file", names] + extra_args, cwd))
+
+    print(f"===== {len(parallel)} tests sharded, {len(serial)} serial, in {time.monotonic() - start:.1f}s; {failed} process(es) failed =====")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())